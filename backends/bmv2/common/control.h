@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef BACKENDS_BMV2_COMMON_CONTROL_H_
 #define BACKENDS_BMV2_COMMON_CONTROL_H_
 
+#include <sstream>
+
 #include "ir/ir.h"
 #include "lib/json.h"
 #include "controlFlowGraph.h"
@@ -433,21 +435,30 @@ class ControlConverter : public Inspector {
     convertTableEntries(table, result);
     return result;
     }
+    /// Const entries are written as text rather than as a tree of JsonObjects: large
+    /// tables can have many thousands of them, and no later pass edits them.
+    /// Only the const entries are written this way; the rest of the JSON is still
+    /// a tree, which later passes edit and which is only serialized at the end.
+    /// So the entries are held as a string in a JsonFragment until then, rather
+    /// than written straight to the output stream.
     void convertTableEntries(const IR::P4Table *table, Util::JsonObject *jsonTable) {
         auto entriesList = table->getEntries();
         if (entriesList == nullptr) return;
 
-        auto entries = mkArrayField(jsonTable, "entries");
+        std::stringstream entries;
+        Util::JsonWriter json(entries);
+        json.beginArray();
         int entryPriority = 1;  // default priority is defined by index position
         for (auto e : entriesList->entries) {
-            auto entry = new Util::JsonObject();
-            entry->emplace_non_null("source_info", e->sourceInfoJsonObj());
+            json.beginObject();
+            if (auto sourceInfo = e->sourceInfoJsonObj())
+                json.key("source_info").json(sourceInfo);
 
             auto keyset = e->getKeys();
-            auto matchKeys = mkArrayField(entry, "match_key");
+            json.key("match_key").beginArray();
             int keyIndex = 0;
             for (auto k : keyset->components) {
-                auto key = new Util::JsonObject();
+                json.beginObject();
                 auto tableKey = table->getKey()->keyElements.at(keyIndex);
                 auto keyWidth = tableKey->expression->type->width_bits();
                 auto k8 = ROUNDUP(keyWidth, 8);
@@ -456,16 +467,16 @@ class ControlConverter : public Inspector {
                 // represented in the BMv2 JSON file the same as a ternary
                 // field would be.
                 if (matchType == "optional") {
-                    key->emplace("match_type", "ternary");
+                    json.field("match_type", "ternary");
                 } else {
-                    key->emplace("match_type", matchType);
+                    json.field("match_type", matchType);
                 }
                 if (matchType == corelib.exactMatch.name) {
                     if (k->is<IR::Constant>())
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("key", stringRepr(k->to<IR::Constant>()->value, k8));
                     else if (k->is<IR::BoolLiteral>())
                         // booleans are converted to ints
-                        key->emplace("key",
+                        json.field("key",
                                 stringRepr(k->to<IR::BoolLiteral>()->value ? 1 : 0, k8));
                     else
                         ::error(ErrorType::ERR_UNSUPPORTED,
@@ -473,14 +484,14 @@ class ControlConverter : public Inspector {
                 } else if (matchType == corelib.ternaryMatch.name) {
                     if (k->is<IR::Mask>()) {
                         auto km = k->to<IR::Mask>();
-                        key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(km->right->to<IR::Constant>()->value, k8));
+                        json.field("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
+                        json.field("mask", stringRepr(km->right->to<IR::Constant>()->value, k8));
                     } else if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
+                        json.field("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("mask", stringRepr(Util::mask(keyWidth), k8));
                     } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("mask", stringRepr(0, k8));
+                        json.field("key", stringRepr(0, k8));
+                        json.field("mask", stringRepr(0, k8));
                     } else {
                         ::error(ErrorType::ERR_UNSUPPORTED,
                                 "%1%: unsupported ternary key expression", k);
@@ -488,7 +499,7 @@ class ControlConverter : public Inspector {
                 } else if (matchType == corelib.lpmMatch.name) {
                     if (k->is<IR::Mask>()) {
                         auto km = k->to<IR::Mask>();
-                        key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
+                        json.field("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
                         auto trailing_zeros = [](unsigned long n, unsigned long keyWidth)
                             { return n ? __builtin_ctzl(n) : static_cast<int>(keyWidth); };
                         auto count_ones = [](unsigned long n)
@@ -499,13 +510,13 @@ class ControlConverter : public Inspector {
                         if (len + count_ones(mask) != keyWidth)  // any remaining 0s in the prefix?
                             ::error(ErrorType::ERR_INVALID, "%1%: invalid mask for LPM key", k);
                         else
-                            key->emplace("prefix_length", keyWidth - len);
+                            json.field("prefix_length", keyWidth - len);
                     } else if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("prefix_length", keyWidth);
+                        json.field("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("prefix_length", keyWidth);
                     } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("prefix_length", 0);
+                        json.field("key", stringRepr(0, k8));
+                        json.field("prefix_length", 0);
                     } else {
                         ::error(ErrorType::ERR_UNSUPPORTED,
                                 "%1%: unsupported LPM key expression", k);
@@ -513,14 +524,14 @@ class ControlConverter : public Inspector {
                 } else if (matchType == "range") {
                     if (k->is<IR::Range>()) {
                         auto kr = k->to<IR::Range>();
-                        key->emplace("start", stringRepr(kr->left->to<IR::Constant>()->value, k8));
-                        key->emplace("end", stringRepr(kr->right->to<IR::Constant>()->value, k8));
+                        json.field("start", stringRepr(kr->left->to<IR::Constant>()->value, k8));
+                        json.field("end", stringRepr(kr->right->to<IR::Constant>()->value, k8));
                     } else if (k->is<IR::Constant>()) {
-                        key->emplace("start", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("end", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("start", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("end", stringRepr(k->to<IR::Constant>()->value, k8));
                     } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("start", stringRepr(0, k8));
-                        key->emplace("end", stringRepr((1 << keyWidth)-1, k8));  // 2^N -1
+                        json.field("start", stringRepr(0, k8));
+                        json.field("end", stringRepr((1 << keyWidth)-1, k8));  // 2^N -1
                     } else {
                         ::error(ErrorType::ERR_UNSUPPORTED,
                                 "%1% unsupported range key expression", k);
@@ -534,11 +545,11 @@ class ControlConverter : public Inspector {
                     // allow exact values or a DefaultExpression (_ or
                     // default), no &&& expression.
                     if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
+                        json.field("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                        json.field("mask", stringRepr(Util::mask(keyWidth), k8));
                     } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("mask", stringRepr(0, k8));
+                        json.field("key", stringRepr(0, k8));
+                        json.field("mask", stringRepr(0, k8));
                     } else {
                         ::error(ErrorType::ERR_UNSUPPORTED,
                                 "%1%: unsupported optional key expression", k);
@@ -547,11 +558,11 @@ class ControlConverter : public Inspector {
                     ::error(ErrorType::ERR_UNKNOWN,
                             "unknown key match type '%2%' for key %1%", k, matchType);
                 }
-                matchKeys->append(key);
+                json.endObject();
                 keyIndex++;
             }
+            json.endArray();
 
-            auto action = new Util::JsonObject();
             auto actionRef = e->getAction();
             if (!actionRef->is<IR::MethodCallExpression>())
                 ::error(ErrorType::ERR_INVALID, "Invalid action '%1%' in entries list.", actionRef);
@@ -562,12 +573,12 @@ class ControlConverter : public Inspector {
             unsigned id = get(ctxt->structure->ids, actionDecl, INVALID_ACTION_ID);
             BUG_CHECK(id != INVALID_ACTION_ID,
                       "Could not find id for %1%", actionDecl);
-            action->emplace("action_id", id);
-            auto actionData = mkArrayField(action, "action_data");
+            json.key("action_entry").beginObject().field("action_id", id);
+            json.key("action_data").beginArray();
             for (auto arg : *actionCall->arguments) {
-                actionData->append(stringRepr(arg->expression->to<IR::Constant>()->value, 0));
+                json.value(stringRepr(arg->expression->to<IR::Constant>()->value, 0));
             }
-            entry->emplace("action_entry", action);
+            json.endArray().endObject();
 
             auto priorityAnnotation = e->getAnnotation("priority");
             if (priorityAnnotation != nullptr) {
@@ -578,14 +589,16 @@ class ControlConverter : public Inspector {
                 if (!priValue->is<IR::Constant>())
                     ::error(ErrorType::ERR_INVALID, "Invalid priority value %1%; must be constant.",
                             priorityAnnotation->expr);
-                entry->emplace("priority", priValue->to<IR::Constant>()->value);
+                json.field("priority", priValue->to<IR::Constant>()->value);
             } else {
-                entry->emplace("priority", entryPriority);
+                json.field("priority", entryPriority);
             }
             entryPriority += 1;
 
-            entries->append(entry);
+            json.endObject();
         }
+        json.endArray();
+        jsonTable->emplace("entries", new Util::JsonFragment(entries.str()));
     }
     cstring getKeyMatchType(const IR::KeyElement *ke) {
         auto path = ke->matchType->path;
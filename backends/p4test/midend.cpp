@@ -109,7 +109,8 @@ MidEnd::MidEnd(CompilerOptions& options, std::ostream* outStream) {
         new P4::FlattenHeaderUnion(&refMap, &typeMap),
         new P4::ReplaceSelectRange(&refMap, &typeMap),
         new P4::Predication(&refMap),
-        new P4::MoveDeclarations(),  // more may have been introduced
+        // more may have been introduced
+        new ParallelForEachDeclaration([] { return new P4::MoveDeclarations(); }),
         new P4::ConstantFolding(&refMap, &typeMap),
         new P4::GlobalCopyPropagation(&refMap, &typeMap),
         new PassRepeated({
@@ -117,7 +118,8 @@ MidEnd::MidEnd(CompilerOptions& options, std::ostream* outStream) {
             new P4::ConstantFolding(&refMap, &typeMap),
         }),
         new P4::StrengthReduction(&refMap, &typeMap),
-        new P4::MoveDeclarations(),  // more may have been introduced
+        // more may have been introduced
+        new ParallelForEachDeclaration([] { return new P4::MoveDeclarations(); }),
         new P4::SimplifyControlFlow(&refMap, &typeMap),
         new P4::CompileTimeOperations(),
         new P4::TableHit(&refMap, &typeMap),
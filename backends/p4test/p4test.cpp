@@ -14,12 +14,15 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include "backends/p4test/version.h"
 #include "control-plane/p4RuntimeSerializer.h"
 #include "ir/ir.h"
+#include "ir/binary_loader.h"
 #include "ir/json_loader.h"
 #include "lib/log.h"
 #include "lib/error.h"
@@ -28,6 +31,7 @@ limitations under the License.
 #include "lib/crash.h"
 #include "lib/nullstream.h"
 #include "frontends/common/applyOptionsPragmas.h"
+#include "frontends/common/compilerServer.h"
 #include "frontends/common/parseInput.h"
 #include "frontends/p4/evaluator/evaluator.h"
 #include "frontends/p4/frontend.h"
@@ -39,6 +43,9 @@ class P4TestOptions : public CompilerOptions {
     bool parseOnly = false;
     bool validateOnly = false;
     bool loadIRFromJson = false;
+    bool loadIRFromBinary = false;
+    // Unix socket on which to serve compilation requests (see compilerServer.h)
+    cstring serverSocket = nullptr;
     P4TestOptions() {
         registerOption("--listMidendPasses", nullptr,
                 [this](const char*) {
@@ -66,6 +73,24 @@ class P4TestOptions : public CompilerOptions {
                            return true;
                        },
                        "read previously dumped json instead of P4 source code");
+        registerOption("--fromBinary", "file",
+                       [this](const char* arg) {
+                           loadIRFromBinary = true;
+                           file = arg;
+                           return true;
+                       },
+                       "read IR previously dumped with --toBinary instead of P4 source code");
+        registerOption("--server", "socket",
+                       [this](const char* arg) {
+                           serverSocket = arg;
+                           return true;
+                       },
+                       "Keep running and compile the programs sent to the Unix socket\n"
+                       "'socket' by 'p4test --connect socket <options> <file>', reusing\n"
+                       "the parsed P4 include files; the other options given with --server\n"
+                       "apply to the include files.  Programs are preprocessed as with\n"
+                       "--builtin-preprocessor, and the front-end still runs on the whole\n"
+                       "program for each of them");
      }
 };
 
@@ -83,17 +108,16 @@ static void log_dump(const IR::Node *node, const char *head) {
             std::cout << *node << std::endl; }
 }
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-    setup_signals();
-
+static int compile(int argc, char *const argv[]) {
     AutoCompileContext autoP4TestContext(new P4TestContext);
     auto& options = P4TestContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
     options.compilerVersion = P4TEST_VERSION_STRING;
 
     if (options.process(argc, argv) != nullptr) {
-            if (options.loadIRFromJson == false)
+            if (options.serverSocket)
+                    return P4::CompilerServer::serve(options, options.serverSocket, compile);
+            if (!options.loadIRFromJson && !options.loadIRFromBinary)
                     options.setInputFile();
     }
     if (::errorCount() > 0)
@@ -110,6 +134,16 @@ int main(int argc, char *const argv[]) {
                 error(ErrorType::ERR_INVALID, "%s is not a P4Program in json format", options.file);
         } else {
             error(ErrorType::ERR_IO, "Can't open %s", options.file); }
+    } else if (options.loadIRFromBinary) {
+        BinaryLoader loader(options.file);
+        if (loader.valid()) {
+            const IR::Node* node = nullptr;
+            loader >> node;
+            if (!node || !(program = node->to<IR::P4Program>()))
+                error(ErrorType::ERR_INVALID, "%s is not a P4Program in binary form",
+                      options.file);
+        } else {
+            error(ErrorType::ERR_IO, "Can't read binary IR from %s", options.file); }
     } else {
         program = P4::parseP4File(options);
 
@@ -161,6 +195,8 @@ int main(int argc, char *const argv[]) {
         if (program) {
             if (options.dumpJsonFile)
                 JSONGenerator(*openFile(options.dumpJsonFile, true), true) << program << std::endl;
+            if (options.dumpBinaryFile)
+                BinaryGenerator(*openFile(options.dumpBinaryFile, true), true).emit(program);
             if (options.debugJson) {
                 std::stringstream ss1, ss2;
                 JSONGenerator gen1(ss1), gen2(ss2);
@@ -188,3 +224,16 @@ int main(int argc, char *const argv[]) {
         std::cerr << "Done." << std::endl;
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+    setup_signals();
+
+    if (argc > 2 && strcmp(argv[1], "--connect") == 0) {
+        // compile with a server started with --server
+        std::vector<char *> args = { argv[0] };
+        args.insert(args.end(), argv + 3, argv + argc);
+        return P4::CompilerServer::request(argv[2], args.size(), args.data());
+    }
+    return compile(argc, argv);
+}
@@ -37,8 +37,8 @@ class AbstractSolver {
     /// A BUG occurs if the solver has no available solution. This can happen if the last call to
     /// @checkSat returned anything other than true, if there was no such previous call, or if the
     /// state in the solver has changed since the last such call (e.g., more assertions have been
-    /// made).
-    virtual const Model* getModel() const = 0;
+    /// made). Not const, as the solver may have to solve again to produce the model.
+    virtual const Model* getModel() = 0;
 
     /// Saves solver state to the given JSON generator.
     virtual void toJSON(JSONGenerator&) const = 0;
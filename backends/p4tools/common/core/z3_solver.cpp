@@ -9,7 +9,9 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <ostream>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -49,6 +51,31 @@ const char* toString(z3::model m) { return Z3_model_to_string(m.ctx(), m); }
 #define Z3_LOG(...)
 #endif  // NDEBUG
 
+namespace {
+
+/// Collects the variables of an expression, which are the nodes Z3Translator declares to Z3.
+class VariableCollector : public Inspector {
+    std::set<StateVariable>& vars;
+
+ public:
+    explicit VariableCollector(std::set<StateVariable>& vars) : vars(vars) {}
+
+    bool preorder(const IR::Member* member) override {
+        vars.emplace(member);
+        return false;
+    }
+
+    bool preorder(const IR::ConcolicVariable* var) override {
+        vars.emplace(var->concolicMember);
+        return false;
+    }
+};
+
+/// Determines whether two constraints are structurally equal.
+bool sameConstraint(const Constraint* a, const Constraint* b) { return a == b || a->equiv(*b); }
+
+}  // namespace
+
 /// Translates P4 expressions into Z3. Any variables encountered are declared to a Z3 instance.
 class Z3Translator : public virtual Inspector {
  public:
@@ -259,7 +286,8 @@ void Z3Solver::timeout(unsigned tm) {
     timeout_ = tm;
 }
 
-boost::optional<bool> Z3Solver::checkSat(const std::vector<const Constraint*>& asserts) {
+boost::optional<bool> Z3Solver::checkSatZ3(const std::vector<const Constraint*>& asserts) {
+    inZ3 = nullptr;
     if (isIncremental) {
         // Find common prefix with the previous invocation's list of assertions
         auto from = asserts.begin();
@@ -298,6 +326,123 @@ boost::optional<bool> Z3Solver::checkSat(const std::vector<const Constraint*>& a
     }
 }
 
+const std::vector<StateVariable>& Z3Solver::variables(const Constraint* constraint) {
+    auto it = constraintVars.find(constraint);
+    if (it != constraintVars.end()) {
+        return it->second;
+    }
+    std::set<StateVariable> vars;
+    VariableCollector collector(vars);
+    constraint->apply(collector);
+    return constraintVars[constraint] = std::vector<StateVariable>(vars.begin(), vars.end());
+}
+
+std::vector<std::vector<const Constraint*>> Z3Solver::slice(
+    const std::vector<const Constraint*>& asserts) {
+    // Union-find over the constraints; the root of each set is its first constraint.
+    std::vector<size_t> parent(asserts.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](size_t i) {
+        while (parent[i] != i) {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
+    };
+    std::map<StateVariable, size_t> firstUse;
+    for (size_t i = 0; i < asserts.size(); ++i) {
+        for (const auto& var : variables(asserts[i])) {
+            auto inserted = firstUse.emplace(var, i);
+            if (inserted.second) {
+                continue;
+            }
+            auto root1 = find(i);
+            auto root2 = find(inserted.first->second);
+            parent[std::max(root1, root2)] = std::min(root1, root2);
+        }
+    }
+
+    std::vector<std::vector<const Constraint*>> slices;
+    std::map<size_t, size_t> sliceOfRoot;
+    for (size_t i = 0; i < asserts.size(); ++i) {
+        auto inserted = sliceOfRoot.emplace(find(i), slices.size());
+        if (inserted.second) {
+            slices.emplace_back();
+        }
+        slices[inserted.first->second].push_back(asserts[i]);
+    }
+    return slices;
+}
+
+size_t Z3Solver::canonicalSlice(std::vector<const Constraint*>& constraints) {
+    std::sort(constraints.begin(), constraints.end(), [](const Constraint* a, const Constraint* b) {
+        auto hashA = a->structuralHash();
+        auto hashB = b->structuralHash();
+        return hashA != hashB ? hashA < hashB : a < b;
+    });
+    constraints.erase(std::unique(constraints.begin(), constraints.end(), sameConstraint),
+                      constraints.end());
+    size_t hash = constraints.size();
+    for (const auto* constraint : constraints) {
+        hash = IR::hash_combine(hash, constraint->structuralHash());
+    }
+    return hash;
+}
+
+Z3Solver::CachedQuery* Z3Solver::lookup(size_t hash,
+                                        const std::vector<const Constraint*>& constraints) {
+    auto range = queryCache.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto& cached = it->second.constraints;
+        if (std::equal(cached.begin(), cached.end(), constraints.begin(), constraints.end(),
+                       sameConstraint)) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+boost::optional<bool> Z3Solver::checkSat(const std::vector<const Constraint*>& asserts) {
+    lastSatisfiable = boost::none;
+    if (queryCache.size() >= MAX_CACHED_QUERIES) {
+        queryCache.clear();
+        constraintVars.clear();
+        inZ3 = nullptr;
+    }
+
+    std::vector<CachedQuery*> slices;
+    boost::optional<bool> result = true;
+    for (auto& constraints : slice(asserts)) {
+        auto canonical = constraints;
+        auto hash = canonicalSlice(canonical);
+        auto* cached = lookup(hash, canonical);
+        if (cached != nullptr) {
+            Z3_LOG("slice of %d assertions found in the cache", static_cast<int>(canonical.size()));
+            cacheHits++;
+        } else {
+            cacheMisses++;
+            auto sliceResult = checkSatZ3(constraints);
+            if (sliceResult == boost::none) {
+                // Other slices may still be unsatisfiable.
+                result = boost::none;
+                continue;
+            }
+            cached = &queryCache.emplace(hash, CachedQuery{canonical, *sliceResult})->second;
+            if (*sliceResult) {
+                inZ3 = cached;
+            }
+        }
+        if (!cached->satisfiable) {
+            return false;
+        }
+        slices.push_back(cached);
+    }
+    if (result == boost::none) {
+        return boost::none;
+    }
+    lastSatisfiable = slices;
+    return true;
+}
+
 void Z3Solver::asrt(const Constraint* assertion) {
     try {
         Z3Translator z3translator(this);
@@ -318,7 +463,7 @@ void Z3Solver::asrt(const Constraint* assertion) {
     }
 }
 
-const Model* Z3Solver::getModel() const {
+const Model* Z3Solver::getZ3Model() const {
     auto* result = new Model();
     // First, collect a map of all the declared variables we have encountered in the stack.
     std::map<unsigned int, StateVariable> declaredVars;
@@ -362,6 +507,28 @@ const Model* Z3Solver::getModel() const {
     return result;
 }
 
+const Model* Z3Solver::getModel() {
+    BUG_CHECK(lastSatisfiable != boost::none,
+              "Z3Solver: no model, the last query was not satisfiable");
+    // Read the model of the slice still in Z3 before solving any other slice.
+    if (inZ3 != nullptr && inZ3->model == nullptr) {
+        inZ3->model = getZ3Model();
+    }
+    auto* result = new Model();
+    for (auto* slice : *lastSatisfiable) {
+        if (slice->model == nullptr) {
+            auto sliceResult = checkSatZ3(slice->constraints);
+            BUG_CHECK(sliceResult != boost::none && *sliceResult,
+                      "Z3Solver: cached satisfiable query can not be solved again");
+            inZ3 = slice;
+            slice->model = getZ3Model();
+        }
+        // Slices have no variables in common, so their models do not overlap.
+        result->insert(slice->model->begin(), slice->model->end());
+    }
+    return result;
+}
+
 const Value* Z3Solver::toValue(const z3::expr& e, const IR::Type* type) {
     // Handle booleans.
     if (type->is<IR::Type::Boolean>()) {
@@ -447,6 +614,10 @@ Z3Solver::Z3Solver(bool isIncremental, boost::optional<std::istream&> inOpt)
     addZ3Pushes(chkIndex, assertions.size());
 }
 
+Z3Solver::~Z3Solver() {
+    LOG1("Z3Solver query cache: " << cacheHits << " hits, " << cacheMisses << " misses");
+}
+
 Z3Translator::Z3Translator(const gsl::not_null<Z3Solver*>& solver)
     : result(solver->z3context), solver(solver) {}
 
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <iosfwd>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/none.hpp>
@@ -34,7 +35,7 @@ class Z3Solver : public AbstractSolver {
     friend class Z3SolverAccessor;
 
  public:
-    virtual ~Z3Solver() = default;
+    virtual ~Z3Solver();
 
     explicit Z3Solver(bool isIncremental = true,
                       boost::optional<std::istream&> inOpt = boost::none);
@@ -45,9 +46,13 @@ class Z3Solver : public AbstractSolver {
 
     void timeout(unsigned tm) override;
 
+    /// Splits @a asserts into independent slices, sets of constraints which share no variables,
+    /// and checks each slice separately. The verdicts (and models) of the slices are cached, so
+    /// only the slices which changed since an earlier query are given to Z3.
     boost::optional<bool> checkSat(const std::vector<const Constraint*>& asserts) override;
 
-    const Model* getModel() const override;
+    /// @returns the model of the last satisfiable query, which combines the models of its slices.
+    const Model* getModel() override;
 
     void toJSON(JSONGenerator& /*json*/) const override;
 
@@ -63,6 +68,43 @@ class Z3Solver : public AbstractSolver {
     safe_vector<const Constraint*> getAssertions() const;
 
  private:
+    /// A solved slice of a query.
+    struct CachedQuery {
+        /// The constraints of the slice, in canonical order (see @ref canonicalSlice).
+        std::vector<const Constraint*> constraints;
+
+        /// Whether the constraints are satisfiable. Timeouts are not cached.
+        bool satisfiable;
+
+        /// A model of the constraints, if satisfiable. Only computed when requested.
+        const Model* model = nullptr;
+    };
+
+    /// At most this many slices are cached. The cache is emptied when it is full.
+    static constexpr size_t MAX_CACHED_QUERIES = 1 << 16;
+
+    /// Checks the satisfiability of @a asserts with Z3, reusing the common prefix with the
+    /// assertions of the previous Z3 invocation in incremental mode.
+    boost::optional<bool> checkSatZ3(const std::vector<const Constraint*>& asserts);
+
+    /// @returns the model of the last satisfiable Z3 invocation.
+    const Model* getZ3Model() const;
+
+    /// @returns the variables of @a constraint.
+    const std::vector<StateVariable>& variables(const Constraint* constraint);
+
+    /// Splits @a asserts into sets of constraints which share no variables. Each set keeps the
+    /// order of @a asserts, and sets are ordered by their first constraint.
+    std::vector<std::vector<const Constraint*>> slice(
+        const std::vector<const Constraint*>& asserts);
+
+    /// Sorts @a constraints by their structural hash and removes duplicates.
+    /// @returns the hash of the result.
+    static size_t canonicalSlice(std::vector<const Constraint*>& constraints);
+
+    /// @returns the cached query for the constraints of a canonical slice, or nullptr.
+    CachedQuery* lookup(size_t hash, const std::vector<const Constraint*>& constraints);
+
     /// Resets the internal state: pops all assertions from previous solver
     /// invocation, removes variable declarations.
     void reset();
@@ -131,6 +173,23 @@ class Z3Solver : public AbstractSolver {
 
     /// Stores the timeout, as last set by @ref timeout.
     boost::optional<unsigned> timeout_;
+
+    /// Solved slices, keyed by the hash of their canonical form.
+    std::unordered_multimap<size_t, CachedQuery> queryCache;
+
+    /// The variables of each constraint seen so far.
+    std::unordered_map<const Constraint*, std::vector<StateVariable>> constraintVars;
+
+    /// The slices of the last query, if it was satisfiable.
+    boost::optional<std::vector<CachedQuery*>> lastSatisfiable;
+
+    /// The slice whose assertions are currently in Z3, if it was satisfiable. Its model can be
+    /// read from Z3 without solving again.
+    CachedQuery* inZ3 = nullptr;
+
+    /// Statistics of the query cache.
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
 };
 
 }  // namespace P4Tools
@@ -2,10 +2,9 @@
 
 #include <algorithm>
 #include <cmath>
-#include <map>
 #include <ostream>
 #include <string>
-#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <boost/multiprecision/cpp_int.hpp>
@@ -16,10 +15,30 @@
 
 #include "backends/p4tools/common/lib/util.h"
 #include "backends/p4tools/common/lib/zombie.h"
+#include "ir/hash_cons.h"
+#include "lib/arena.h"
 #include "lib/safe_vector.h"
 
 namespace P4Tools {
 
+namespace {
+
+/// The interned literals and validity members. They are shared by parallel exploration threads,
+/// and by all the programs explored.
+IR::HashCons& interned() {
+    static auto* nodes = new IR::HashCons();
+    return *nodes;
+}
+
+/// @returns the single instance of the T equiv to T(@args).
+template <class T, class... Args>
+const T* intern(Args&&... args) {
+    Util::Arena::Scope permanent(nullptr);
+    return interned().get<T>(std::forward<Args>(args)...);
+}
+
+}  // namespace
+
 /* =============================================================================================
  *  Types
  * ============================================================================================= */
@@ -27,7 +46,7 @@ namespace P4Tools {
 const cstring IRUtils::Valid = "*valid";
 
 const IR::Type_Bits* IRUtils::getBitType(int size, bool isSigned) {
-    // Types are cached already.
+    // Types are cached already, and Type_Bits::get is safe to call from several threads.
     return IR::Type_Bits::get(size, isSigned);
 }
 
@@ -68,7 +87,8 @@ const StateVariable& IRUtils::getZombieConst(const IR::Type* type, int incarnati
 }
 
 StateVariable IRUtils::getHeaderValidity(const IR::Expression* headerRef) {
-    return new IR::Member(IR::Type::Boolean::get(), headerRef, Valid);
+    // Validity members are interned, so the same header always has the same variable.
+    return intern<IR::Member>(IR::Type::Boolean::get(), headerRef, Valid);
 }
 
 /* =============================================================================================
@@ -85,27 +105,13 @@ const IR::Constant* IRUtils::getConstant(const IR::Type* type, big_int v) {
     if (type->width_bits() > 16 || tb == nullptr) {
         return new IR::Constant(type, v);
     }
-    // Constants are interned. Keys in the intern map are pairs of types and values.
-    using key_t = std::tuple<int, bool, big_int>;
-    static std::map<key_t, const IR::Constant*> constants;
-
-    auto*& result = constants[{tb->width_bits(), tb->isSigned, v}];
-    if (result == nullptr) {
-        result = new IR::Constant(tb, v);
-    }
-
-    return result;
+    // Constants are interned.
+    return intern<IR::Constant>(tb, v);
 }
 
 const IR::BoolLiteral* IRUtils::getBoolLiteral(bool value) {
     // Boolean literals are interned.
-    static std::map<bool, const IR::BoolLiteral*> literals;
-
-    auto*& result = literals[value];
-    if (result == nullptr) {
-        result = new IR::BoolLiteral(IR::Type::Boolean::get(), value);
-    }
-    return result;
+    return intern<IR::BoolLiteral>(IR::Type::Boolean::get(), value);
 }
 
 const IR::TaintExpression* IRUtils::getTaintExpression(const IR::Type* type) {
@@ -118,17 +124,8 @@ const IR::TaintExpression* IRUtils::getTaintExpression(const IR::Type* type) {
     if (type->width_bits() > 16 || tb == nullptr) {
         return new IR::TaintExpression(type);
     }
-    // Taint expressions are interned. Keys in the intern map is the signedness and width of the
-    // type.
-    using key_t = std::tuple<int, bool>;
-    static std::map<key_t, const IR::TaintExpression*> taints;
-
-    auto*& result = taints[{tb->width_bits(), tb->isSigned}];
-    if (result == nullptr) {
-        result = new IR::TaintExpression(type);
-    }
-
-    return result;
+    // Taint expressions are interned.
+    return intern<IR::TaintExpression>(type);
 }
 
 const StateVariable& IRUtils::getConcolicMember(const IR::ConcolicVariable* var, int concolicId) {
@@ -4,6 +4,9 @@
 #include <chrono>  // NOLINT linter forbids using chrono, but we don't have alternatives
 #include <cstring>
 #include <memory>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include <stack>
 #include <unordered_map>
 
@@ -40,33 +43,32 @@ struct CounterEntry {
 struct RootCounter {
     /// The topmost counter.
     CounterEntry counter;
-    /// The most inner currently active counter.
-    CounterEntry* current;
     Clock::time_point start;
+#ifdef MULTITHREAD
+    /// Guards the counter tree, which is shared by all threads.
+    std::mutex lock;
+#endif  // MULTITHREAD
 
     static RootCounter& get() {
-        // TODO: not threadsafe currently. Instance of RootCounter could be thread_local:
-        //
-        // thread_local RootCounter root;
-        //
-        // however libgc cannot scan thread local data, which can lead to premature object
-        // garbage collection.
         static RootCounter root;
-        root.counter.duration = Clock::now() - root.start;
         return root;
     }
 
-    CounterEntry* getCurrent() const { return current; }
+    /// The most inner counter currently active on the running thread. Timers of threads other
+    /// than the main one start at the topmost counter. The counters themselves are reachable
+    /// from the static root, so libgc does not need to scan this thread-local pointer.
+    CounterEntry* getCurrent() { return current != nullptr ? current : &counter; }
 
     void setCurrent(CounterEntry* c) { current = c; }
 
  private:
-    RootCounter() : counter("") {
-        current = &counter;
-        start = Clock::now();
-    }
+    static thread_local CounterEntry* current;
+
+    RootCounter() : counter("") { start = Clock::now(); }
 };
 
+thread_local CounterEntry* RootCounter::current = nullptr;
+
 }  // namespace
 
 // RAII helper which manages lifetime of one timer invocation.
@@ -79,16 +81,28 @@ struct ScopedTimer::Ctx {
         start_time = Clock::now();
         // Push new active counter - the current active counter becomes the parent of this
         // counter, and this counter becomes the current active counter.
-        parent = RootCounter::get().getCurrent();
-        self = parent->open_subcounter(counter_name);
-        RootCounter::get().setCurrent(self);
+        auto& root = RootCounter::get();
+        parent = root.getCurrent();
+        {
+#ifdef MULTITHREAD
+            std::lock_guard<std::mutex> guard(root.lock);
+#endif  // MULTITHREAD
+            self = parent->open_subcounter(counter_name);
+        }
+        root.setCurrent(self);
     }
     ~Ctx() {
         // Close the current timer invocation, measure time and add it to the counter.
         auto duration = Clock::now() - start_time;
-        self->add(duration);
+        auto& root = RootCounter::get();
+        {
+#ifdef MULTITHREAD
+            std::lock_guard<std::mutex> guard(root.lock);
+#endif  // MULTITHREAD
+            self->add(duration);
+        }
         // Restore previous counter as current.
-        RootCounter::get().setCurrent(parent);
+        root.setCurrent(parent);
     }
 };
 
@@ -129,7 +143,12 @@ static void formatCounters(std::vector<TimerEntry>& out, CounterEntry& current,
 std::vector<TimerEntry> getTimers() {
     std::vector<TimerEntry> ret;
     std::string namePrefix = "";
-    formatCounters(ret, RootCounter::get().counter, namePrefix, 0);
+    auto& root = RootCounter::get();
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> guard(root.lock);
+#endif  // MULTITHREAD
+    root.counter.duration = Clock::now() - root.start;
+    formatCounters(ret, root.counter, namePrefix, 0);
     return ret;
 }
 
@@ -23,7 +23,7 @@ namespace P4Tools {
 
 boost::optional<uint32_t> TestgenUtils::currentSeed = boost::none;
 
-boost::random::mt19937 TestgenUtils::rng;
+thread_local boost::random::mt19937 TestgenUtils::rng;
 
 std::string TestgenUtils::getTimeStamp() {
     // get current time
@@ -47,6 +47,8 @@ void TestgenUtils::setRandomSeed(int seed) {
     rng.seed(seed);
 }
 
+void TestgenUtils::seedThread(uint32_t seed) { rng.seed(seed); }
+
 boost::optional<uint32_t> TestgenUtils::getCurrentSeed() { return currentSeed; }
 
 uint64_t TestgenUtils::getRandInt(uint64_t max) {
@@ -39,8 +39,9 @@ void printFeature(const std::string& label, int level, const std::string& fmt,
 /// General utility functions that are not present in the compiler framework.
 class TestgenUtils {
  private:
-    /// The random generator of this project. It is initialized with the input seed.
-    static boost::random::mt19937 rng;
+    /// The random generator of this project. It is initialized with the input seed. Each thread
+    /// has its own generator, see @ref seedThread.
+    static thread_local boost::random::mt19937 rng;
 
     /// Stores the state of the PRNG.
     static boost::optional<uint32_t> currentSeed;
@@ -55,6 +56,11 @@ class TestgenUtils {
     /// Uses boost's mersenne twister.
     static void setRandomSeed(int seed);
 
+    /// Reseed the random generator of the calling thread only. Used by parallel exploration to
+    /// make the random choices along a path independent of the thread exploring it. Has no
+    /// effect on the results of @ref getRandInt if no seed is set.
+    static void seedThread(uint32_t seed);
+
     /// @returns currentSeed.
     static boost::optional<uint32_t> getCurrentSeed();
 
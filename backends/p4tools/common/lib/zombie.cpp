@@ -1,6 +1,9 @@
 #include "backends/p4tools/common/lib/zombie.h"
 
 #include <map>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include <string>
 #include <utility>
 
@@ -49,6 +52,11 @@ const StateVariable* Zombie::mkZombie(const IR::Type* type, bool isConst, int in
 
     using key_t = std::pair<bool, int>;
     static std::map<key_t, const IR::Member*> incarnations;
+#ifdef MULTITHREAD
+    // Shared by parallel exploration threads.
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
+#endif  // MULTITHREAD
     const auto*& incarnationMember = incarnations[std::make_pair(isConst, incarnation)];
     if (incarnationMember == nullptr) {
         const IR::Expression* hdr = &zombieHdr;
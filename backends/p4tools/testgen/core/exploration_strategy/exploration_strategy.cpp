@@ -50,8 +50,13 @@ ExplorationStrategy::Branch::Branch(boost::optional<const Constraint*> c,
 }
 
 ExplorationStrategy::StepResult ExplorationStrategy::step(ExecutionState& state) {
+    return step(evaluator, state);
+}
+
+ExplorationStrategy::StepResult ExplorationStrategy::step(SmallStepEvaluator& stepEvaluator,
+                                                          ExecutionState& state) {
     ScopedTimer st("step");
-    StepResult successors = evaluator.step(state);
+    StepResult successors = stepEvaluator.step(state);
     // Assign branch ids to the branches. These integer branch ids are used by track-branches
     // and selected (input) branches features.
     if (successors->size() > 1) {
@@ -85,6 +85,10 @@ class ExplorationStrategy {
     /// Take one step in the program and return list of possible branches.
     StepResult step(ExecutionState& state);
 
+    /// Take one step in the program with @param stepEvaluator, which need not be the evaluator
+    /// of this strategy, and return list of possible branches.
+    static StepResult step(SmallStepEvaluator& stepEvaluator, ExecutionState& state);
+
     /// The current execution state.
     ExecutionState* executionState = nullptr;
 
@@ -0,0 +1,378 @@
+#include "backends/p4tools/testgen/core/exploration_strategy/parallel_stack.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <set>
+#ifdef MULTITHREAD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif  // MULTITHREAD
+#include <vector>
+
+#include <boost/none.hpp>
+
+#include "backends/p4tools/common/core/z3_solver.h"
+#include "backends/p4tools/common/lib/util.h"
+#include "ir/ir.h"
+#include "lib/arena.h"
+#include "lib/error.h"
+#include "lib/gc.h"
+#include "lib/hash.h"
+#include "lib/log.h"
+
+#include "backends/p4tools/testgen/core/small_step/small_step.h"
+#include "backends/p4tools/testgen/lib/exceptions.h"
+#include "backends/p4tools/testgen/options.h"
+
+namespace P4Tools {
+
+namespace P4Testgen {
+
+/// The exploration state shared by all workers.
+struct ParallelStack::Shared {
+    /// The branch decisions leading to a state.
+    using Path = std::vector<uint64_t>;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    /// The paths of the branches which are on a stack or being explored.
+    std::multiset<Path> pending;
+
+    /// The terminal states which have not been handed to the callback yet, by path.
+    std::map<Path, ExecutionState*> finished;
+
+    /// The number of branches on the stacks of the workers.
+    std::atomic<size_t> queued{0};
+
+    /// Set when exploration should stop.
+    std::atomic<bool> stop{false};
+
+    boost::optional<uint32_t> seed;
+
+#ifdef MULTITHREAD
+    /// Guards @ref pending and @ref finished.
+    std::mutex lock;
+
+    /// Notified when a branch is pushed, and when exploration is over.
+    std::condition_variable branchPushed;
+
+    /// Notified when a branch has been explored, and when exploration is over.
+    std::condition_variable branchExplored;
+#endif  // MULTITHREAD
+
+    /// Seeds the random generator of this thread from @param path, so that the random choices
+    /// made below it do not depend on the thread.
+    void reseed(const Path& path) const {
+        if (seed == boost::none) {
+            return;
+        }
+        Path key = path;
+        key.push_back(*seed);
+        TestgenUtils::seedThread(Util::Hash::murmur(key.data(), key.size() * sizeof(uint64_t)));
+    }
+
+    /// @returns the first finished terminal state if no path before it is left to explore, after
+    /// removing it from @ref finished; nullptr otherwise. Must be called with @ref lock held.
+    ExecutionState* takeFinished() {
+        if (finished.empty()) {
+            return nullptr;
+        }
+        // Pending paths are disjoint from the finished ones, and a pending path precedes all the
+        // paths below it.
+        auto first = finished.begin();
+        if (!pending.empty() && *pending.begin() < first->first) {
+            return nullptr;
+        }
+        auto* state = first->second;
+        finished.erase(first);
+        return state;
+    }
+
+    /// Stops the exploration and wakes up all the threads.
+    void halt() {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> guard(lock);
+#endif  // MULTITHREAD
+        stop = true;
+#ifdef MULTITHREAD
+        branchPushed.notify_all();
+        branchExplored.notify_all();
+#endif  // MULTITHREAD
+    }
+};
+
+class ParallelStack::Worker {
+ public:
+    /// The exception which stopped this worker, if any.
+    std::exception_ptr failure;
+
+    Worker(Shared& shared, const ProgramInfo& programInfo)
+        : shared(shared), evaluator(solver, programInfo) {
+        if (shared.seed != boost::none) {
+            solver.seed(*shared.seed);
+        }
+    }
+
+    /// Pushes an unexplored branch onto the stack of this worker.
+    void push(const Branch& branch) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> sharedGuard(shared.lock);
+        std::lock_guard<std::mutex> guard(lock);
+#endif  // MULTITHREAD
+        shared.pending.insert(branch.nextState->getSelectedBranches());
+        stack.push_back(branch);
+        shared.queued++;
+#ifdef MULTITHREAD
+        shared.branchPushed.notify_one();
+#endif  // MULTITHREAD
+    }
+
+    /// Explores a branch from the stack of this worker, or stolen from another worker, and records
+    /// the terminal state it leads to. @param index is the index of this worker in
+    /// Shared::workers. @returns false if there was no branch on any stack.
+    bool exploreNext(size_t index) {
+        auto branch = pop(/* oldest */ false);
+        for (size_t i = 1; !branch && i < shared.workers.size(); ++i) {
+            branch = shared.workers[(index + i) % shared.workers.size()]->pop(/* oldest */ true);
+        }
+        if (!branch) {
+            return false;
+        }
+        auto* terminal = explore(*branch);
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> guard(shared.lock);
+#endif  // MULTITHREAD
+        shared.pending.erase(shared.pending.find(branch->nextState->getSelectedBranches()));
+        if (terminal != nullptr) {
+            shared.finished.emplace(terminal->getSelectedBranches(), terminal);
+        }
+#ifdef MULTITHREAD
+        shared.branchExplored.notify_one();
+        if (shared.pending.empty()) {
+            shared.branchPushed.notify_all();
+        }
+#endif  // MULTITHREAD
+        return true;
+    }
+
+    /// Explores branches until no branch is left anywhere or exploration is stopped, sleeping
+    /// while other workers are exploring and no branch is left to steal.
+    void work(size_t index) {
+        try {
+            while (!shared.stop) {
+                if (exploreNext(index)) {
+                    continue;
+                }
+#ifdef MULTITHREAD
+                std::unique_lock<std::mutex> guard(shared.lock);
+                shared.branchPushed.wait(guard, [this] {
+                    return shared.queued > 0 || shared.pending.empty() || shared.stop;
+                });
+                if (shared.pending.empty()) {
+                    return;
+                }
+#else
+                return;
+#endif  // MULTITHREAD
+            }
+        } catch (...) {
+            failure = std::current_exception();
+            shared.halt();
+        }
+    }
+
+ private:
+    Shared& shared;
+
+    /// The solver of this worker, which checks the viability of branches.
+    Z3Solver solver;
+
+    SmallStepEvaluator evaluator;
+
+    /// Unexplored branches. The worker itself takes the newest branch; other workers steal the
+    /// oldest one, which has the largest subtree left to explore.
+    std::deque<Branch> stack;
+
+#ifdef MULTITHREAD
+    std::mutex lock;
+#endif  // MULTITHREAD
+
+    boost::optional<Branch> pop(bool oldest) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> guard(lock);
+#endif  // MULTITHREAD
+        if (stack.empty()) {
+            return boost::none;
+        }
+        shared.queued--;
+        if (oldest) {
+            auto branch = stack.front();
+            stack.pop_front();
+            return branch;
+        }
+        auto branch = stack.back();
+        stack.pop_back();
+        return branch;
+    }
+
+    /// @returns whether the path constraints of @param branch may be satisfiable. The solver is
+    /// only invoked if @param check is true.
+    bool viable(const Branch& branch, bool check) {
+        // Do not bother invoking the solver for a trivial case.
+        if (const auto* boolLiteral = branch.constraint->to<IR::BoolLiteral>()) {
+            return boolLiteral->value;
+        }
+        if (!check) {
+            return true;
+        }
+        auto solverResult = solver.checkSat(branch.nextState->getPathConstraint());
+        if (solverResult == boost::none) {
+            ::warning("Solver timed out");
+        }
+        return solverResult != boost::none && solverResult.get();
+    }
+
+    /// Follows @param branch to the end of the program, taking the first viable branch at each
+    /// step and pushing the other branches onto the stack. @returns the terminal state reached, or
+    /// nullptr if the path was abandoned.
+    ExecutionState* explore(const Branch& branch) {
+        // Like IncrementalStack, we check branches when we go back to them.
+        if (!viable(branch, true)) {
+            return nullptr;
+        }
+        shared.reseed(branch.nextState->getSelectedBranches());
+        ExecutionState* state = branch.nextState;
+        while (!shared.stop) {
+            try {
+                if (state->isTerminal()) {
+                    return state;
+                }
+                // To help reduce calls into the solver, only guarantee viability of the selected
+                // branch if more than one branch was produced.
+                StepResult successors = step(evaluator, *state);
+                bool guaranteeViability = successors->size() > 1;
+                state = nullptr;
+                size_t idx = 0;
+                for (; state == nullptr && idx < successors->size(); ++idx) {
+                    if (viable(successors->at(idx), guaranteeViability)) {
+                        state = successors->at(idx).nextState;
+                    }
+                }
+                // Push the remaining branches so that this worker takes them in order.
+                for (size_t rest = successors->size(); rest > idx; --rest) {
+                    push(successors->at(rest - 1));
+                }
+                if (state == nullptr) {
+                    return nullptr;
+                }
+            } catch (TestgenUnimplemented& e) {
+                // If permissive is not enable, we just throw the exception.
+                if (!TestgenOptions::get().permissive) {
+                    throw;
+                }
+                // Otherwise we abandon this path.
+                ::warning("Path encountered unimplemented feature. Message: %1%\n", e.what());
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+};
+
+bool ParallelStack::emit(const Shared& shared, const Callback& callback, ExecutionState* state) {
+    shared.reseed(state->getSelectedBranches());
+    executionState = state;
+    return handleTerminalState(callback, *state);
+}
+
+void ParallelStack::run(const Callback& callback) {
+    Shared shared;
+    shared.seed = seed;
+
+    unsigned nthreads = 1;
+#ifdef MULTITHREAD
+    nthreads = threads != 0 ? threads : std::thread::hardware_concurrency();
+    nthreads = std::max(nthreads, 1U);
+#endif  // MULTITHREAD
+    for (unsigned t = 0; t < nthreads; ++t) {
+        shared.workers.emplace_back(new Worker(shared, programInfo));
+    }
+    shared.workers.front()->push(Branch(executionState));
+
+    if (nthreads == 1) {
+        auto& worker = *shared.workers.front();
+        bool more = true;
+        while (!shared.stop && more) {
+            more = worker.exploreNext(0);
+            while (auto* state = shared.takeFinished()) {
+                if (emit(shared, callback, state)) {
+                    return;
+                }
+            }
+        }
+        return;
+    }
+
+#ifdef MULTITHREAD
+    LOG1("Exploring with " << nthreads << " threads");
+    gc_allow_threads();
+    auto* arena = Util::Arena::current();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < nthreads; ++t) {
+        workers.emplace_back([&shared, arena, t] {
+            gc_register_thread();
+            Util::Arena::Scope allocateIn(arena);
+            shared.workers[t]->work(t);
+            gc_unregister_thread();
+        });
+    }
+
+    // Hand the terminal states to the callback on this thread as they are found.
+    std::exception_ptr failure;
+    try {
+        std::unique_lock<std::mutex> guard(shared.lock);
+        while (!shared.stop) {
+            if (auto* state = shared.takeFinished()) {
+                guard.unlock();
+                bool done = emit(shared, callback, state);
+                guard.lock();
+                if (done) {
+                    break;
+                }
+                continue;
+            }
+            if (shared.pending.empty()) {
+                break;
+            }
+            shared.branchExplored.wait(guard);
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    shared.halt();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    for (auto& worker : shared.workers) {
+        if (worker->failure) {
+            std::rethrow_exception(worker->failure);
+        }
+    }
+#endif  // MULTITHREAD
+}
+
+ParallelStack::ParallelStack(AbstractSolver& solver, const ProgramInfo& programInfo,
+                             boost::optional<uint32_t> seed, unsigned threads)
+    : ExplorationStrategy(solver, programInfo, seed), seed(seed), threads(threads) {}
+
+}  // namespace P4Testgen
+
+}  // namespace P4Tools
@@ -0,0 +1,64 @@
+#ifndef TESTGEN_CORE_EXPLORATION_STRATEGY_PARALLEL_STACK_H_
+#define TESTGEN_CORE_EXPLORATION_STRATEGY_PARALLEL_STACK_H_
+
+#include <cstdint>
+
+#include <boost/optional/optional.hpp>
+
+#include "backends/p4tools/common/core/solver.h"
+
+#include "backends/p4tools/testgen/core/exploration_strategy/exploration_strategy.h"
+#include "backends/p4tools/testgen/core/program_info.h"
+#include "backends/p4tools/testgen/lib/execution_state.h"
+
+namespace P4Tools {
+
+namespace P4Testgen {
+
+/// Exhaustive depth-first exploration on several threads. Each worker thread has its own Z3
+/// solver and small-step evaluator, and a stack of unexplored branches. A worker keeps following
+/// the first viable branch of every step and pushes the others onto its stack; a worker whose
+/// stack is empty steals the oldest branch, the one closest to the start of the program, from the
+/// stack of another worker, or sleeps until a branch is pushed.
+///
+/// Terminal states are handed to the callback on the thread calling run(), ordered by the branch
+/// decisions taken along their path: each one as soon as all the paths before it are explored.
+/// Their path constraints are solved there, on the solver of the strategy, so the tests, their
+/// order and their models do not depend on the schedule of the threads. Random choices along a
+/// path are seeded from the path, for the same reason. Exploration stops when the callback returns
+/// true, e.g. after --max-tests tests.
+///
+/// The workers share the program and create IR nodes concurrently: node ids are atomic, and the
+/// shared types (e.g. from IRUtils::getBitType, which uses Type_Bits::get) are created under a
+/// lock in MULTITHREAD builds. Without MULTITHREAD this explores the program on a single worker.
+class ParallelStack : public ExplorationStrategy {
+ public:
+    /// Explores all paths of the P4 program, and invokes the given callback on each terminal
+    /// state in order, until the callback returns true.
+    void run(const Callback& callBack) override;
+
+    /// Constructor for this strategy. @param threads is the number of worker threads; 0 means
+    /// one per hardware thread.
+    ParallelStack(AbstractSolver& solver, const ProgramInfo& programInfo,
+                  boost::optional<uint32_t> seed, unsigned threads);
+
+ private:
+    class Worker;
+    struct Shared;
+
+    /// The seed of the exploration, if any.
+    boost::optional<uint32_t> seed;
+
+    /// The number of worker threads.
+    unsigned threads;
+
+    /// Solves terminal @param state and hands it to @param callback. @returns true if the
+    /// exploration should stop.
+    bool emit(const Shared& shared, const Callback& callback, ExecutionState* state);
+};
+
+}  // namespace P4Testgen
+
+}  // namespace P4Tools
+
+#endif /* TESTGEN_CORE_EXPLORATION_STRATEGY_PARALLEL_STACK_H_ */
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 
+#include "lib/error.h"
 #include "lib/exceptions.h"
 
 #include "backends/p4tools/testgen/lib/logging.h"
@@ -117,7 +118,8 @@ TestgenOptions::TestgenOptions()
             return true;
         },
         "Selects a specific exploration strategy for test generation. Options are: "
-        "randomAccessStack, linearEnumeration, maxCoverage. Defaults to incrementalStack.");
+        "randomAccessStack, linearEnumeration, maxCoverage, parallelStack. Defaults to "
+        "incrementalStack.");
 
     registerOption(
         "--linear-enumeration", "linearEnumeration",
@@ -127,6 +129,19 @@ TestgenOptions::TestgenOptions()
         },
         "Performs linear exploration of the program paths; expects max bound for vector size.");
 
+    registerOption(
+        "--threads", "threads",
+        [this](const char* arg) {
+            threads = std::atoi(arg);
+            if (threads < 0) {
+                ::error("Invalid number of threads: %1%", arg);
+                return false;
+            }
+            return true;
+        },
+        "Sets the number of threads of the parallelStack exploration strategy; defaults to 0, "
+        "one per hardware thread.");
+
     registerOption(
         "--print-traces", nullptr,
         [](const char*) {
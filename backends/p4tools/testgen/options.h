@@ -37,6 +37,10 @@ class TestgenOptions : public AbstractP4cToolOptions {
     /// by default.
     int linearEnumeration = 2;
 
+    /// Number of worker threads of the parallelStack exploration strategy. Defaults to 0, which
+    /// uses one thread per hardware thread.
+    int threads = 0;
+
     /// @returns the singleton instance of this class.
     static TestgenOptions& get();
 
@@ -61,6 +61,45 @@ p4tools_add_tests(
   TARGET "bmv2" ARCH "v1model" VALIDATE_PROTOBUF TEST_ARGS "-I${P4C_BINARY_DIR}/p4include --test-backend PROTOBUF ${EXTRA_OPTS} "
 )
 
+# The parallelStack exploration strategy must generate the same tests, in the same order, with
+# one thread and with several threads.
+macro(p4tools_add_parallel_stack_test p4test)
+  get_filename_component(__name ${p4test} NAME)
+  string(REGEX REPLACE ".p4" "" __aliasname ${__name})
+  set(__tag "testgen-p4c-bmv2-parallel-stack")
+  p4c_test_set_name(__testname ${__tag} ${__name})
+  set(__testfile "${P4TESTGEN_DIR}/${__tag}/${__name}.test")
+  set(__testfolder "${P4TESTGEN_DIR}/${__tag}/${__aliasname}.out")
+  file(WRITE ${__testfile} "#! /usr/bin/env bash\n")
+  file(APPEND ${__testfile} "# Generated file, modify with care\n\n")
+  file(APPEND ${__testfile} "set -e\n")
+  file(APPEND ${__testfile} "cd ${P4TOOLS_BINARY_DIR}\n")
+  foreach(__threads 1 4)
+    file(APPEND ${__testfile} "rm -rf ${__testfolder}/threads${__threads}\n")
+    file(
+      APPEND ${__testfile} "${P4TESTGEN_DRIVER} --target bmv2 --arch v1model --std p4-16 "
+      "-I${P4C_BINARY_DIR}/p4include --test-backend STF --seed 1000 --max-tests 10 "
+      "--exploration-strategy parallelStack --threads ${__threads} "
+      "--out-dir ${__testfolder}/threads${__threads} ${p4test}\n"
+    )
+  endforeach()
+  file(APPEND ${__testfile} "diff -r ${__testfolder}/threads1 ${__testfolder}/threads4\n")
+  execute_process(COMMAND chmod +x ${__testfile})
+  add_test(
+    NAME ${__testname}
+    COMMAND ${__tag}/${__name}.test
+    WORKING_DIRECTORY ${P4TESTGEN_DIR}
+  )
+  set_tests_properties(${__testname} PROPERTIES LABELS ${__tag} TIMEOUT 300)
+endmacro(p4tools_add_parallel_stack_test)
+
+foreach(
+  p4test
+  bmv2_hash_1.p4 bmv2_hit_miss_gw.p4 bmv2_parse_1.p4 bmv2_random_extern.p4
+)
+  p4tools_add_parallel_stack_test(${CMAKE_CURRENT_LIST_DIR}/p4-programs/${p4test})
+endforeach()
+
 include(${CMAKE_CURRENT_LIST_DIR}/BMV2Xfail.cmake)
 include(${CMAKE_CURRENT_LIST_DIR}/BMV2PTFXfail.cmake)
 include(${CMAKE_CURRENT_LIST_DIR}/BMV2ProtobufXfail.cmake)
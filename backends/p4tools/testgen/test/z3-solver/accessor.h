@@ -33,6 +33,9 @@ class Z3SolverAccessor {
     /// Gets checkpoints that have been made. Used by GTests only.
     std::vector<size_t>& getCheckpoints() { return solver->checkpoints; }
 
+    /// Gets the number of query slices answered from the cache. Used by GTests only.
+    size_t getCacheHits() { return solver->cacheHits; }
+
  private:
     /// Pointer to a solver.
     gsl::not_null<Z3Solver*> solver;
@@ -8,6 +8,7 @@
 
 #include "backends/p4tools/common/core/z3_solver.h"
 #include "backends/p4tools/common/lib/formulae.h"
+#include "backends/p4tools/common/lib/ir.h"
 #include "backends/p4tools/common/lib/model.h"
 #include "gsl/gsl-lite.hpp"
 #include "gtest/gtest-message.h"
@@ -25,6 +26,7 @@
 
 namespace Test {
 
+using P4Tools::IRUtils;
 using P4Tools::Model;
 using P4Tools::StateVariable;
 using P4Tools::Z3Solver;
@@ -202,6 +204,43 @@ TEST_F(Z3SolverTest, Assertion2Model) {
     ASSERT_TRUE((intA1 + intAddToA) % 16 < intB1);
 }
 
+/// Test that independent constraints are solved separately and that solved slices are cached.
+TEST_F(Z3SolverTest, QueryCache) {
+    const auto* type = IRUtils::getBitType(8);
+    const auto* varA = new IR::Member(type, new IR::PathExpression("h"), "a");
+    const auto* varB = new IR::Member(type, new IR::PathExpression("h"), "b");
+    auto equals = [type](const IR::Member* var, int value) {
+        return new IR::Equ(IR::Type::Boolean::get(), var, new IR::Constant(type, value));
+    };
+    const auto* aIs1 = equals(varA, 1);
+    const auto* bIs2 = equals(varB, 2);
+    const auto* bIs3 = equals(varB, 3);
+
+    Z3Solver solver;
+    Z3SolverAccessor solverAccessor(&solver);
+
+    // The model combines the models of both slices.
+    ASSERT_EQ(solver.checkSat({aIs1, bIs2}), true);
+    Model model = *solver.getModel();
+    ASSERT_EQ(model.size(), 2u);
+    EXPECT_EQ(model.at(varA)->checkedTo<IR::Constant>()->value, 1);
+    EXPECT_EQ(model.at(varB)->checkedTo<IR::Constant>()->value, 2);
+    EXPECT_EQ(solverAccessor.getCacheHits(), 0u);
+
+    // Only the slices of b are given to Z3.
+    ASSERT_EQ(solver.checkSat({aIs1, bIs2, bIs3}), false);
+    EXPECT_THROW(solver.getModel(), Util::CompilerBug);
+    ASSERT_EQ(solver.checkSat({aIs1, bIs3}), true);
+    model = *solver.getModel();
+    EXPECT_EQ(model.at(varA)->checkedTo<IR::Constant>()->value, 1);
+    EXPECT_EQ(model.at(varB)->checkedTo<IR::Constant>()->value, 3);
+    EXPECT_EQ(solverAccessor.getCacheHits(), 2u);
+
+    // Structurally equal constraints hit the cache as well.
+    ASSERT_EQ(solver.checkSat({equals(varA, 1), bIs3, bIs3}), true);
+    EXPECT_EQ(solverAccessor.getCacheHits(), 4u);
+}
+
 }  // anonymous namespace
 
 }  // namespace Test
@@ -21,6 +21,7 @@
 #include "backends/p4tools/testgen/core/exploration_strategy/incremental_max_coverage_stack.h"
 #include "backends/p4tools/testgen/core/exploration_strategy/incremental_stack.h"
 #include "backends/p4tools/testgen/core/exploration_strategy/linear_enumeration.h"
+#include "backends/p4tools/testgen/core/exploration_strategy/parallel_stack.h"
 #include "backends/p4tools/testgen/core/exploration_strategy/random_access_stack.h"
 #include "backends/p4tools/testgen/core/exploration_strategy/selected_branches.h"
 #include "backends/p4tools/testgen/core/target.h"
@@ -97,6 +98,9 @@ int Testgen::mainImpl(const IR::P4Program* program) {
         if (explorationStrategy.compare("maxCoverage") == 0) {
             return new IncrementalMaxCoverageStack(solver, *programInfo, seed);
         }
+        if (explorationStrategy.compare("parallelStack") == 0) {
+            return new ParallelStack(solver, *programInfo, seed, TestgenOptions::get().threads);
+        }
         if (!TestgenOptions::get().selectedBranches.empty()) {
             std::string selectedBranchesStr = TestgenOptions::get().selectedBranches;
             return new SelectedBranches(solver, *programInfo, seed, selectedBranchesStr);
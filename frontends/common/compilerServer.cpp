@@ -0,0 +1,299 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "compilerServer.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frontends/parsers/parserDriver.h"
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+constexpr int streamCount = 3;  // stdin, stdout and stderr of the client
+
+bool readAll(int fd, void *data, size_t size) {
+    auto *p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n; }
+    return true;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+    auto *p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n; }
+    return true;
+}
+
+bool socketAddress(const char *path, sockaddr_un &addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        ::error(ErrorType::ERR_INVALID, "%1%: socket path is too long", path);
+        return false; }
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+/// Whether the process at the other end of @connection runs as the same user as the server
+bool sameUser(int connection) {
+#ifdef SO_PEERCRED
+    ucred peer;
+    socklen_t size = sizeof(peer);
+    return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &size) == 0 &&
+           peer.uid == geteuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(connection, &uid, &gid) == 0 && uid == geteuid();
+#endif  // SO_PEERCRED
+}
+
+void reapRequests(int) {
+    int saved = errno;
+    while (waitpid(-1, nullptr, WNOHANG) > 0) {}
+    errno = saved;
+}
+
+/// The .p4 files in directory @dir
+std::vector<std::string> p4Files(const std::string &dir) {
+    std::vector<std::string> files;
+    if (auto *d = opendir(dir.c_str())) {
+        while (auto *entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, ".p4") == 0)
+                files.push_back(name); }
+        closedir(d); }
+    return files;
+}
+
+}  // namespace
+
+void CompilerServer::preload(ParserOptions &options) {
+    if (options.isv1()) return;
+    std::vector<std::string> includes = { "#include <core.p4>\n" };
+    for (auto &dir : { std::string(p4includePath), std::string(p4includePath) + "/bmv2" }) {
+        for (auto &arch : p4Files(dir)) {
+            if (arch == "core.p4") continue;
+            // programs may or may not include core.p4 themselves
+            includes.push_back("#include <core.p4>\n#include <" + arch + ">\n");
+            includes.push_back("#include <" + arch + ">\n"); } }
+
+    cstring file = options.file;
+    for (auto &source : includes) {
+        char name[] = "/tmp/p4c-serverXXXXXX.p4";
+        int fd = mkstemps(name, 3);
+        if (fd < 0) {
+            ::warning(ErrorType::WARN_FAILED, "Cannot create %1%; not preloading headers", name);
+            break; }
+        bool written = writeAll(fd, source.data(), source.size());
+        close(fd);
+        auto errors = ::errorCount();
+        options.file = name;
+        FILE *in = written ? options.preprocess() : nullptr;
+        std::string text;
+        if (in) {
+            char buffer[4096];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+                text.append(buffer, n);
+            options.closeInput(in); }
+        unlink(name);
+        if (::errorCount() == errors && !text.empty() &&
+            P4ParserDriver::preloadHeaders(text, name))
+            LOG2("Preloaded " << source);
+        else
+            LOG1("Could not preload " << source); }
+    options.file = file;
+}
+
+int CompilerServer::serve(ParserOptions &options, const char *socketPath, Compile compile) {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) return 1;
+    options.builtinPreprocessor = true;
+    preload(options);
+
+    // Requests run the compiler with the rights of the server, so only its
+    // user may connect: the socket is created and kept private, and the
+    // credentials of each peer are checked.
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(addr.sun_path);
+    mode_t mask = umask(0177);
+    bool bound = fd >= 0 && bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || chmod(addr.sun_path, 0600) != 0 || listen(fd, SOMAXCONN) != 0) {
+        ::error(ErrorType::ERR_IO, "%1%: cannot listen on socket: %2%",
+                socketPath, strerror(errno));
+        return 1; }
+    LOG1("Compiler server listening on " << socketPath);
+
+    // reap the processes handling requests as soon as they are done
+    struct sigaction reap = {};
+    reap.sa_handler = reapRequests;
+    sigemptyset(&reap.sa_mask);
+    reap.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &reap, nullptr);
+
+    while (true) {
+        int connection = accept(fd, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) continue;
+            ::error(ErrorType::ERR_IO, "%1%: accept failed: %2%", socketPath, strerror(errno));
+            return 1; }
+        if (!sameUser(connection)) {
+            LOG1("Rejected a request from another user");
+            close(connection);
+            continue; }
+        pid_t pid = fork();
+        if (pid == 0) {
+            // handle() waits for the compilation itself
+            signal(SIGCHLD, SIG_DFL);
+            close(fd);
+            handle(connection, compile); }
+        if (pid < 0)
+            std::cerr << "Cannot fork compiler server: " << strerror(errno) << std::endl;
+        close(connection); }
+}
+
+void CompilerServer::handle(int connection, Compile compile) {
+    // The request is the size of the payload, sent with the client's standard
+    // streams, followed by the payload: the working directory and the command
+    // line, each terminated by a nul character.
+    uint32_t size = 0;
+    int streams[streamCount];
+    iovec iov = { &size, sizeof(size) };
+    char control[CMSG_SPACE(sizeof(streams))];
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto *cmsg = CMSG_FIRSTHDR(&msg);
+    std::string payload;
+    if (recvmsg(connection, &msg, MSG_WAITALL) != sizeof(size) || !cmsg ||
+        cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(streams)))
+        _exit(1);
+    memcpy(streams, CMSG_DATA(cmsg), sizeof(streams));
+    payload.resize(size);
+    if (!readAll(connection, &payload[0], size) || payload.empty() || payload.back() != '\0')
+        _exit(1);
+
+    std::vector<char *> argv;
+    for (size_t pos = 0; pos < payload.size(); pos += strlen(&payload[pos]) + 1)
+        argv.push_back(&payload[pos]);
+    const char *cwd = argv.front();
+    argv.erase(argv.begin());
+    if (argv.empty())
+        _exit(1);
+    // as for the include files, rather than running cpp for each request
+    static char builtinPreprocessor[] = "--builtin-preprocessor";
+    argv.insert(argv.begin() + 1, builtinPreprocessor);
+    int argc = argv.size();
+    argv.push_back(nullptr);
+
+    // Compile in a separate process, so that its exit status can be reported
+    // however it terminates.
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(connection);
+        for (int i = 0; i < streamCount; ++i) {
+            dup2(streams[i], i);
+            close(streams[i]); }
+        if (chdir(cwd) != 0) {
+            std::cerr << cwd << ": " << strerror(errno) << std::endl;
+            _exit(1); }
+        exit(compile(argc, argv.data())); }
+    for (int i = 0; i < streamCount; ++i)
+        close(streams[i]);
+    int32_t status = 1;
+    int wstatus;
+    if (pid > 0 && waitpid(pid, &wstatus, 0) == pid) {
+        if (WIFEXITED(wstatus))
+            status = WEXITSTATUS(wstatus);
+        else if (WIFSIGNALED(wstatus))
+            status = 128 + WTERMSIG(wstatus); }
+    writeAll(connection, &status, sizeof(status));
+    _exit(0);
+}
+
+int CompilerServer::request(const char *socketPath, int argc, char *const argv[]) {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) return 1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::cerr << socketPath << ": cannot connect to compiler server: "
+                  << strerror(errno) << std::endl;
+        return 1; }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        std::cerr << "Cannot get the current directory: " << strerror(errno) << std::endl;
+        return 1; }
+    std::string payload(cwd, strlen(cwd) + 1);
+    for (int i = 0; i < argc; ++i)
+        payload.append(argv[i], strlen(argv[i]) + 1);
+
+    uint32_t size = payload.size();
+    int streams[streamCount] = { 0, 1, 2 };
+    iovec iov = { &size, sizeof(size) };
+    char control[CMSG_SPACE(sizeof(streams))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(streams));
+    memcpy(CMSG_DATA(cmsg), streams, sizeof(streams));
+
+    int32_t status = 1;
+    if (sendmsg(fd, &msg, 0) != sizeof(size) || !writeAll(fd, payload.data(), payload.size()) ||
+        !readAll(fd, &status, sizeof(status))) {
+        std::cerr << socketPath << ": compiler server request failed" << std::endl;
+        status = 1; }
+    close(fd);
+    return status;
+}
+
+}  // namespace P4
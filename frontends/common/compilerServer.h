@@ -0,0 +1,69 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _FRONTENDS_COMMON_COMPILERSERVER_H_
+#define _FRONTENDS_COMMON_COMPILERSERVER_H_
+
+#include <functional>
+
+#include "parser_options.h"
+
+namespace P4 {
+
+/**
+ * A compiler which stays resident and compiles the programs it is sent on a
+ * Unix socket, to save the startup cost and the parsing of the P4 include
+ * files in every compilation (e.g. in test suites compiling many small
+ * programs).
+ *
+ * The server preprocesses and parses core.p4 and the architecture files
+ * found in the include path once (see P4ParserDriver::preloadHeaders).
+ * Each request is compiled in a process forked from the server, which
+ * starts from that state and gets a fresh compilation context, so nothing
+ * leaks from one compilation to the next.  A request carries the command
+ * line, working directory and standard streams of the client, which exits
+ * with the status of the compilation.  Requests are compiled with
+ * --builtin-preprocessor, so that they do not start cpp either (unless
+ * their preprocessor options need it).
+ *
+ * Only the parsing of the include files is shared: the front-end, including
+ * CreateBuiltins, still runs on the whole program of every request.  Only
+ * p4test offers the server (--server and --connect).
+ */
+class CompilerServer {
+ public:
+    /// Runs a compilation, like the main function of a compiler.
+    using Compile = std::function<int(int argc, char *const argv[])>;
+
+    /// Preload the include files with @options and serve the requests of the
+    /// same user on the Unix socket @socket, running each of them with @compile
+    /// and --builtin-preprocessor added after the program name.
+    /// Only returns on failure.
+    static int serve(ParserOptions &options, const char *socket, Compile compile);
+
+    /// Send the command line @argv to the server listening on @socket and
+    /// wait for the compilation to finish.
+    /// @returns the exit status of the compilation.
+    static int request(const char *socket, int argc, char *const argv[]);
+
+ private:
+    static void preload(ParserOptions &options);
+    static void handle(int connection, Compile compile);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_COMPILERSERVER_H_ */
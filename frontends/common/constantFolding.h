@@ -168,6 +168,8 @@ class ConstantFolding : public PassManager {
             passes.push_back(new ClearTypeMap(typeMap));
         setName("ConstantFolding");
     }
+    bool rerun_is_noop() const override { return true; }
+    bool rerun_needed_for(const IR::Node *n) const override { return !isGroupingNode(n); }
 };
 
 }  // namespace P4
@@ -50,6 +50,27 @@ CompilerOptions::CompilerOptions() : ParserOptions() {
         },
         "Exclude passes from midend passes whose name is equal\n"
         "to one of `passX' strings.\n");
+    registerOption(
+        "--frontend-cache", "dir",
+        [this](const char* arg) {
+            frontendCacheDir = arg;
+            return true;
+        },
+        "Cache the front-end output in the specified directory, and reuse it\n"
+        "when the same program is compiled again.  An entry is only reused for\n"
+        "a byte-identical program: any edit, even to whitespace or comments,\n"
+        "runs the whole front-end again.  Front-end warnings are reported again\n"
+        "when a cached result is used, but front-end debug hooks do not run on\n"
+        "it.  The cache is not used with --top4 or --pp.\n");
+    registerOption(
+        "--incremental-maps", nullptr,
+        [this](const char*) {
+            incrementalMaps = true;
+            return true;
+        },
+        "In the front-end, resolve references and infer types again only for\n"
+        "the top-level declarations which changed since the last time, and\n"
+        "for the declarations which refer to them.\n");
     registerOption(
         "--toJSON", "file",
         [this](const char* arg) {
@@ -57,6 +78,13 @@ CompilerOptions::CompilerOptions() : ParserOptions() {
             return true;
         },
         "Dump the compiler IR after the midend as JSON in the specified file.");
+    registerOption(
+        "--toBinary", "file",
+        [this](const char* arg) {
+            dumpBinaryFile = arg;
+            return true;
+        },
+        "Dump the compiler IR after the midend in binary form in the specified file.");
     registerOption(
         "--ndebug", nullptr,
         [this](const char*) {
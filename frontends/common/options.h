@@ -53,6 +53,8 @@ class CompilerOptions : public ParserOptions {
     std::vector<cstring> passesToExcludeBackend;
     // Dump a JSON representation of the IR in the file.
     cstring dumpJsonFile = nullptr;
+    // Dump a binary representation of the IR in the file.
+    cstring dumpBinaryFile = nullptr;
     // Dump and undump the IR tree.
     bool debugJson = false;
     // if this flag is true, compile program in non-debug mode.
@@ -77,6 +79,10 @@ class CompilerOptions : public ParserOptions {
     cstring arch = nullptr;
     // If true, unroll all parser loops inside the midend.
     bool loopsUnrolling = false;
+    // Directory where front-end results are cached across compilations.
+    cstring frontendCacheDir = nullptr;
+    // If true, the front-end updates its reference and type maps incrementally.
+    bool incrementalMaps = false;
 
     virtual bool enable_intrinsic_metadata_fix();
 };
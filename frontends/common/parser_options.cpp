@@ -22,8 +22,11 @@ limitations under the License.
 #include <regex>
 #include <unordered_set>
 
+#include "frontends/common/preprocessor.h"
 #include "frontends/p4/toP4/toP4.h"
 #include "ir/json_generator.h"
+#include "ir/pass_profile.h"
+#include "lib/arena.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
 #include "lib/log.h"
@@ -176,6 +179,14 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "Skip preprocess, assume input file is already preprocessed.");
+    registerOption(
+        "--builtin-preprocessor", nullptr,
+        [this](const char* ) {
+            builtinPreprocessor = true;
+            return true;
+        },
+        "Preprocess in the compiler instead of running cpp (only -I, -D and -U\n"
+        "are supported: with other preprocessor options cpp is still used).");
     registerOption(
         "--disable-annotations", "annotations",
         [this](const char* arg) {
@@ -274,6 +285,24 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "[Compiler debugging] Folder where P4 programs are dumped\n");
+    registerOption(
+        "--pass-profile", "file",
+        [](const char* arg) {
+            PassProfile::enable(arg);
+            return true;
+        },
+        "[Compiler debugging] Write the time, number of nodes visited and cloned,\n"
+        "bytes allocated and iterations of every pass to 'file' as a\n"
+        "Chrome trace-event JSON file (viewable in chrome://tracing)\n");
+    registerOption(
+        "--arena", nullptr,
+        [](const char*) {
+            Util::Arena::enable();
+            return true;
+        },
+        "Allocate IR nodes and strings created from now on in bump arenas\n"
+        "which are only freed on exit; faster than the garbage collector,\n"
+        "at the cost of never reusing memory\n");
     registerOption(
         "--parser-inline-opt", nullptr,
         [this](const char*) {
@@ -396,14 +425,23 @@ FILE* ParserOptions::preprocess() {
         file = "<stdin>";
         in = stdin;
     } else {
+        if (file == nullptr)
+            file = "";
+        if (builtinPreprocessor) {
+            auto errors = ::errorCount();
+            in = preprocessBuiltin();
+            if (::errorCount() > errors)
+                return nullptr;
+        }
+    }
+
+    if (in == nullptr) {
 #ifdef __clang__
         std::string cmd("cc -E -x c -Wno-comment");
 #else
         std::string cmd("cpp");
 #endif
 
-        if (file == nullptr)
-            file = "";
         if (file.find(' '))
             file = cstring("\"") + file + "\"";
         cmd +=
@@ -421,6 +459,7 @@ FILE* ParserOptions::preprocess() {
             return nullptr;
         }
         close_input = true;
+        close_memory_input = false;
     }
 
     if (doNotCompile) {
@@ -436,8 +475,29 @@ FILE* ParserOptions::preprocess() {
     return in;
 }
 
+FILE* ParserOptions::preprocessBuiltin() {
+    P4::Preprocessor preprocessor;
+    if (!preprocessor.addOptions(preprocessor_options + getIncludePath())) {
+        LOG1("Preprocessor options" << preprocessor_options << " need cpp");
+        return nullptr;
+    }
+    preprocessedText.clear();
+    if (!preprocessor.process(file, preprocessedText))
+        return nullptr;
+    FILE* in = fmemopen(&preprocessedText[0], preprocessedText.size(), "r");
+    if (in == nullptr) {
+        ::error(ErrorType::ERR_IO, "Error reading preprocessed program");
+        return nullptr;
+    }
+    close_input = false;
+    close_memory_input = true;
+    return in;
+}
+
 void ParserOptions::closeInput(FILE* inputStream) const {
-    if (close_input) {
+    if (close_memory_input) {
+        fclose(inputStream);
+    } else if (close_input) {
         int exitCode = pclose(inputStream);
         if (WIFEXITED(exitCode) && WEXITSTATUS(exitCode) == 4)
             ::error(ErrorType::ERR_IO, "input file %s does not exist", file);
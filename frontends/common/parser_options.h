@@ -38,6 +38,9 @@ extern const char* p4_14includePath;
 // Each back-end should subclass this file.
 class ParserOptions : public Util::Options {
     bool close_input = false;
+    bool close_memory_input = false;
+    // output of the built-in preprocessor, read by the stream preprocess returns
+    std::string preprocessedText;
     static const char* defaultMessage;
 
     // annotation names that are to be ignored by the compiler
@@ -68,6 +71,8 @@ class ParserOptions : public Util::Options {
     cstring compilerVersion;
     // if true skip preprocess
     bool doNotPreprocess = false;
+    // if true preprocess with P4::Preprocessor instead of running cpp
+    bool builtinPreprocessor = false;
     // substrings matched against pass names
     std::vector<cstring> top4;
     // debugging dumps of programs written in this folder
@@ -80,6 +85,9 @@ class ParserOptions : public Util::Options {
     const char *getIncludePath() override;
     // Returns the output of the preprocessor.
     FILE* preprocess();
+    // Returns the output of the built-in preprocessor, or nullptr if
+    // the preprocessor options need cpp or if errors were reported.
+    FILE* preprocessBuiltin();
     // Closes the input stream returned by preprocess.
     void closeInput(FILE* input) const;
     // True if we are compiling a P4 v1.0 or v1.1 program
@@ -0,0 +1,889 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "preprocessor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <sstream>
+
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+/// Bound on the nesting of #include, as in cpp.
+static const unsigned maxIncludeDepth = 200;
+
+bool isIdentifierStart(char c) { return isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+bool isIdentifierChar(char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+bool isHorizontalSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+/// @returns true if characters @a and @b would be read as part of the same
+/// token if no space separated them.
+bool wouldPaste(char a, char b) {
+    if (isIdentifierChar(a) || a == '.')
+        return isIdentifierChar(b) || b == '.';
+    static const char* pairs[] = { "++", "--", "->", "+=", "-=", "*=", "/=", "%=", "<=", ">=",
+                                   "==", "!=", "&=", "|=", "^=", "&&", "||", "<<", ">>", "##",
+                                   "::", "//", "/*" };
+    for (auto pair : pairs)
+        if (a == pair[0] && b == pair[1]) return true;
+    return false;
+}
+
+/**
+ * Scans the token which starts at @p: @returns its kind and sets @end past it.
+ * Comments, white space and escaped newlines are Space tokens.
+ */
+Preprocessor::Token::Kind scan(const char* p, const char* limit, const char*& end);
+unsigned splice(std::string& text);
+
+}  // namespace
+
+/// A file being preprocessed.
+struct Preprocessor::Source {
+    std::string name;   // as shown in line markers
+    std::string dir;    // searched first by #include "..."
+    std::string text;
+    size_t pos = 0;
+    unsigned line = 1;
+    std::vector<Conditional> conditionals;
+
+    bool skipping() const { return !conditionals.empty() && !conditionals.back().active; }
+    const char* begin() const { return text.data() + pos; }
+    const char* limit() const { return text.data() + text.size(); }
+    bool atEnd() const { return pos >= text.size(); }
+    /// @returns true if the line starting at pos is a directive.
+    bool atDirective() const {
+        size_t p = pos;
+        while (p < text.size() && isHorizontalSpace(text[p])) ++p;
+        return p < text.size() && text[p] == '#'; }
+};
+
+/**
+ * The tokens being expanded: those produced by earlier expansions, which are
+ * read first, then those of the rest of the current line of @source, if any.
+ * Macro arguments can span several lines, but never include a directive.
+ */
+class Preprocessor::Expansion {
+    bool atLineStart = false;
+
+ public:
+    std::deque<Token> pending;
+    Source* source;
+    /// Newlines of the source read as part of macro invocations, which are
+    /// written at the end of the line to keep the line numbers right.
+    unsigned newlines = 0;
+
+    explicit Expansion(Source* source) : source(source) {}
+    bool next(Token& token) {
+        if (!pending.empty()) {
+            token = std::move(pending.front());
+            pending.pop_front();
+            return true; }
+        if (source == nullptr || source->atEnd() || (atLineStart && source->atDirective())) {
+            token = Token();
+            return false; }
+        const char* end;
+        auto kind = scan(source->begin(), source->limit(), end);
+        token = Token(kind, std::string(source->begin(), end));
+        source->pos += end - source->begin();
+        atLineStart = kind == Token::Newline;
+        if (kind == Token::Newline) {
+            source->line++;
+        } else if (kind == Token::Space && token.text[0] == '\\') {
+            // An escaped newline joins two lines.
+            source->line++;
+            newlines++;
+            token.text = " ";
+        } else if (kind == Token::Space) {
+            source->line += std::count(token.text.begin(), token.text.end(), '\n');
+        } else if (kind == Token::String) {
+            auto lines = splice(token.text);
+            source->line += lines;
+            newlines += lines; }
+        return true; }
+};
+
+namespace {
+
+Preprocessor::Token::Kind scan(const char* p, const char* limit, const char*& end) {
+    using Token = Preprocessor::Token;
+    const char* start = p;
+    char c = *p++;
+    if (c == '\n') {
+        end = p;
+        return Token::Newline; }
+    if (isHorizontalSpace(c)) {
+        while (p < limit && isHorizontalSpace(*p)) ++p;
+        end = p;
+        return Token::Space; }
+    if (c == '\\' && p < limit && (*p == '\n' || (*p == '\r' && p + 1 < limit && p[1] == '\n'))) {
+        end = p + (*p == '\r' ? 2 : 1);
+        return Token::Space; }
+    if (c == '/' && p < limit && *p == '/') {
+        while (p < limit && *p != '\n') ++p;
+        end = p;
+        return Token::Space; }
+    if (c == '/' && p < limit && *p == '*') {
+        p++;
+        while (p < limit && !(*p == '*' && p + 1 < limit && p[1] == '/')) ++p;
+        end = std::min(p + 2, limit);
+        return Token::Space; }
+    if (isIdentifierStart(c)) {
+        while (p < limit && isIdentifierChar(*p)) ++p;
+        end = p;
+        return Token::Identifier; }
+    if (isdigit(static_cast<unsigned char>(c)) ||
+        (c == '.' && p < limit && isdigit(static_cast<unsigned char>(*p)))) {
+        // A preprocessing number, which includes P4 constants such as 8w0xFF.
+        while (p < limit) {
+            if ((*p == '+' || *p == '-') && strchr("eEpP", p[-1])) ++p;
+            else if (isIdentifierChar(*p) || *p == '.') ++p;
+            else
+                break; }
+        end = p;
+        return Token::Number; }
+    if (c == '"') {
+        // An escaped newline continues the string.
+        while (p < limit && *p != '"' && *p != '\n') {
+            if (*p == '\\' && p + 1 < limit) ++p;
+            ++p; }
+        end = p < limit && *p == '"' ? p + 1 : p;
+        return Token::String; }
+    if (c == '#' && p < limit && *p == '#') {
+        end = p + 1;
+        return Token::Punctuation; }
+    if (c == '.' && p + 1 < limit && p[0] == '.' && p[1] == '.') {
+        end = p + 2;
+        return Token::Punctuation; }
+    end = start + 1;
+    return Token::Punctuation;
+}
+
+/// Splits @text into tokens, dropping white space and comments.
+std::vector<Preprocessor::Token> tokenize(const std::string& text) {
+    std::vector<Preprocessor::Token> tokens;
+    const char* p = text.data();
+    const char* limit = p + text.size();
+    bool space = false;
+    while (p < limit) {
+        const char* end;
+        auto kind = scan(p, limit, end);
+        if (kind == Preprocessor::Token::Space || kind == Preprocessor::Token::Newline) {
+            space = true;
+        } else {
+            tokens.emplace_back(kind, std::string(p, end));
+            tokens.back().space = space;
+            space = false; }
+        p = end; }
+    return tokens;
+}
+
+/// Removes the escaped newlines from @text.  @returns how many there were.
+unsigned splice(std::string& text) {
+    unsigned lines = 0;
+    size_t pos;
+    while ((pos = text.find("\\\n")) != std::string::npos) {
+        text.erase(pos, 2);
+        lines++; }
+    return lines;
+}
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+    if (dir.empty() || name[0] == '/') return name;
+    if (dir.back() == '/') return dir + name;
+    return dir + "/" + name;
+}
+
+std::string dirName(const std::string& path) {
+    auto slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+bool readFile(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return !file.bad();
+}
+
+std::string stringify(const std::vector<Preprocessor::Token>& tokens) {
+    std::string result = "\"";
+    for (auto& token : tokens) {
+        if (token.space && &token != &tokens.front())
+            result += ' ';
+        if (token.kind != Preprocessor::Token::String) {
+            result += token.text;
+            continue; }
+        for (char c : token.text) {
+            if (c == '"' || c == '\\') result += '\\';
+            result += c; } }
+    return result + "\"";
+}
+
+using HideSet = std::vector<const Preprocessor::Macro*>;
+
+HideSet hideSetUnion(HideSet a, const HideSet& b) {
+    for (auto macro : b)
+        if (std::find(a.begin(), a.end(), macro) == a.end())
+            a.push_back(macro);
+    return a;
+}
+
+/// Evaluates the expression of a #if, in which macros have been expanded.
+class ExpressionParser {
+    const std::vector<Preprocessor::Token>& tokens;
+    size_t pos = 0;
+
+    /// @returns the operator at pos, made of one or two punctuation tokens.
+    std::string peek() const {
+        if (pos >= tokens.size() || tokens[pos].kind != Preprocessor::Token::Punctuation)
+            return std::string();
+        std::string op = tokens[pos].text;
+        if (pos + 1 < tokens.size() && !tokens[pos + 1].space &&
+            tokens[pos + 1].kind == Preprocessor::Token::Punctuation) {
+            static const char* pairs[] = { "||", "&&", "==", "!=", "<=", ">=", "<<", ">>" };
+            std::string two = op + tokens[pos + 1].text;
+            for (auto pair : pairs)
+                if (two == pair) return two; }
+        return op; }
+    bool accept(const char* op) {
+        if (peek() != op) return false;
+        pos += strlen(op);
+        return true; }
+    void expect(const char* op) {
+        if (!accept(op)) throw std::runtime_error(std::string("expected '") + op + "'"); }
+
+    int64_t primary() {
+        if (pos >= tokens.size())
+            throw std::runtime_error("missing operand");
+        if (accept("(")) {
+            auto value = conditional();
+            expect(")");
+            return value; }
+        if (accept("!")) return !primary();
+        if (accept("~")) return ~primary();
+        if (accept("-")) return -primary();
+        if (accept("+")) return primary();
+        auto& token = tokens[pos++];
+        if (token.kind == Preprocessor::Token::Identifier)
+            return 0;  // not a macro
+        if (token.kind != Preprocessor::Token::Number)
+            throw std::runtime_error("unexpected '" + token.text + "'");
+        std::string digits = token.text;
+        while (!digits.empty() && strchr("uUlL", digits.back())) digits.pop_back();
+        char* end;
+        auto value = strtoull(digits.c_str(), &end, 0);
+        if (*end)
+            throw std::runtime_error("invalid integer " + token.text);
+        return static_cast<int64_t>(value); }
+
+    int64_t binary(int level) {
+        // Operators from the lowest to the highest precedence.
+        static const std::vector<std::vector<const char*>> levels = {
+            { "||" }, { "&&" }, { "|" }, { "^" }, { "&" }, { "==", "!=" },
+            { "<", ">", "<=", ">=" }, { "<<", ">>" }, { "+", "-" }, { "*", "/", "%" } };
+        if (level == static_cast<int>(levels.size()))
+            return primary();
+        auto left = binary(level + 1);
+        while (true) {
+            auto op = peek();
+            if (std::find_if(levels[level].begin(), levels[level].end(),
+                    [&op](const char* o) { return op == o; }) == levels[level].end())
+                return left;
+            pos += op.size();
+            auto right = binary(level + 1);
+            if (op == "||") left = left || right;
+            else if (op == "&&") left = left && right;
+            else if (op == "|") left |= right;
+            else if (op == "^") left ^= right;
+            else if (op == "&") left &= right;
+            else if (op == "==") left = left == right;
+            else if (op == "!=") left = left != right;
+            else if (op == "<") left = left < right;
+            else if (op == ">") left = left > right;
+            else if (op == "<=") left = left <= right;
+            else if (op == ">=") left = left >= right;
+            else if (op == "<<") left <<= right;
+            else if (op == ">>") left >>= right;
+            else if (op == "+") left += right;
+            else if (op == "-") left -= right;
+            else if (op == "*") left *= right;
+            else if (right == 0) throw std::runtime_error("division by zero");
+            else if (op == "/") left /= right;
+            else
+                left %= right; } }
+
+    int64_t conditional() {
+        auto condition = binary(0);
+        if (!accept("?")) return condition;
+        auto ifTrue = conditional();
+        expect(":");
+        auto ifFalse = conditional();
+        return condition ? ifTrue : ifFalse; }
+
+ public:
+    explicit ExpressionParser(const std::vector<Preprocessor::Token>& tokens) : tokens(tokens) {}
+    int64_t evaluate() {
+        auto value = conditional();
+        if (pos < tokens.size())
+            throw std::runtime_error("unexpected '" + tokens[pos].text + "'");
+        return value; }
+};
+
+}  // namespace
+
+int Preprocessor::Macro::param(const Token& token) const {
+    if (token.kind != Token::Identifier) return -1;
+    auto it = std::find(params.begin(), params.end(), token.text);
+    return it == params.end() ? -1 : it - params.begin();
+}
+
+Preprocessor::Preprocessor() {
+    // The macros cpp defines with -undef -x assembler-with-cpp.
+    define("__STDC__");
+    define("__STDC_HOSTED__");
+    define("__ASSEMBLER__");
+}
+
+void Preprocessor::addIncludePath(cstring dir) {
+    includePaths.push_back(dir.c_str());
+}
+
+void Preprocessor::define(cstring definition) {
+    std::string text = definition.c_str();
+    auto equals = text.find('=');
+    if (equals == std::string::npos)
+        text += " 1";
+    else
+        text[equals] = ' ';
+    define(nullptr, 0, tokenize(text));
+}
+
+void Preprocessor::undefine(cstring name) {
+    macros.erase(name.c_str());
+}
+
+bool Preprocessor::addOptions(cstring options) {
+    std::vector<std::string> words;
+    std::string word;
+    bool quoted = false, inWord = false;
+    for (const char* p = options.c_str(); p && *p; ++p) {
+        if (*p == '"') {
+            quoted = !quoted;
+            inWord = true;
+        } else if (isspace(static_cast<unsigned char>(*p)) && !quoted) {
+            if (inWord) words.push_back(word);
+            word.clear();
+            inWord = false;
+        } else {
+            word += *p;
+            inWord = true; } }
+    if (inWord) words.push_back(word);
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        auto option = words[i].substr(0, 2);
+        if (option != "-I" && option != "-D" && option != "-U")
+            return false;
+        auto arg = words[i].substr(2);
+        if (arg.empty()) {
+            if (++i == words.size()) return false;
+            arg = words[i]; }
+        if (option == "-I")
+            addIncludePath(arg);
+        else if (option == "-D")
+            define(arg);
+        else
+            undefine(arg); }
+    return true;
+}
+
+void Preprocessor::error(const Source& source, unsigned line, const std::string& message) {
+    ::error(ErrorType::ERR_INVALID, "%1%:%2%: %3%", cstring(source.name), line,
+            cstring(message));
+}
+
+bool Preprocessor::process(cstring file, std::string& out) {
+    auto errors = ::errorCount();
+    Source source;
+    source.name = file.c_str();
+    source.dir = dirName(source.name);
+    if (!readFile(source.name, source.text)) {
+        ::error(ErrorType::ERR_IO, "%1%: No such file or directory.", file);
+        return false; }
+    LOG1("Preprocessing " << file);
+    out += "# 1 \"" + source.name + "\"\n";
+    processFile(source, out);
+    return ::errorCount() == errors;
+}
+
+bool Preprocessor::include(Source& from, unsigned line, const std::string& name, bool angled,
+                           std::string& out) {
+    if (depth >= maxIncludeDepth) {
+        error(from, line, "#include nested too deeply");
+        return false; }
+    Source source;
+    bool found = false;
+    if (name[0] == '/') {
+        source.name = name;
+        found = readFile(name, source.text);
+    } else {
+        if (!angled) {
+            source.name = joinPath(from.dir, name);
+            found = readFile(source.name, source.text); }
+        for (auto it = includePaths.begin(); !found && it != includePaths.end(); ++it) {
+            source.name = joinPath(*it, name);
+            found = readFile(source.name, source.text); } }
+    if (!found) {
+        error(from, line, name + ": No such file or directory");
+        return false; }
+    if (onceOnly.count(source.name))
+        return false;
+    source.dir = dirName(source.name);
+    LOG3("Including " << source.name);
+    out += "# 1 \"" + source.name + "\" 1\n";
+    ++depth;
+    processFile(source, out);
+    --depth;
+    out += "# " + std::to_string(from.line) + " \"" + from.name + "\" 2\n";
+    return true;
+}
+
+void Preprocessor::processFile(Source& source, std::string& out) {
+    auto* saved = current;
+    current = &source;
+    while (!source.atEnd()) {
+        if (source.atDirective())
+            directive(source, out);
+        else if (source.skipping())
+            skipLine(source, out);
+        else
+            text(source, out); }
+    if (!source.conditionals.empty())
+        error(source, source.conditionals.back().line, "unterminated conditional directive");
+    current = saved;
+}
+
+void Preprocessor::skipLine(Source& source, std::string& out) {
+    while (!source.atEnd()) {
+        const char* end;
+        auto kind = scan(source.begin(), source.limit(), end);
+        if (kind == Token::Space) {
+            auto lines = std::count(source.begin(), end, '\n');
+            source.line += lines;
+            out.append(lines, '\n'); }
+        source.pos += end - source.begin();
+        if (kind == Token::Newline) {
+            source.line++;
+            out += '\n';
+            return; } }
+}
+
+void Preprocessor::directive(Source& source, std::string& out) {
+    // Read the whole directive, replacing comments with spaces.
+    unsigned line = source.line;
+    size_t start = source.pos;
+    std::string text;
+    unsigned lines = 0;
+    while (!source.atEnd()) {
+        const char* end;
+        auto kind = scan(source.begin(), source.limit(), end);
+        if (kind == Token::Space) {
+            lines += std::count(source.begin(), end, '\n');
+            text += ' ';
+        } else if (kind != Token::Newline) {
+            text.append(source.begin(), end); }
+        source.pos += end - source.begin();
+        if (kind == Token::Newline) {
+            lines++;
+            break; } }
+    source.line += lines;
+    auto tokens = tokenize(text.substr(text.find('#') + 1));
+    std::string name = tokens.empty() ? std::string() : tokens.front().text;
+    bool lineMarker = !tokens.empty() && tokens.front().kind == Token::Number;
+    if (!tokens.empty())
+        tokens.erase(tokens.begin());
+    auto skipping = source.skipping();
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        bool value = false;
+        if (!skipping) {
+            if (name == "if") {
+                value = evaluate(source, line, tokens);
+            } else if (tokens.empty() || tokens.front().kind != Token::Identifier) {
+                error(source, line, "no macro name given in #" + name + " directive");
+            } else {
+                value = macros.count(tokens.front().text) == (name == "ifdef" ? 1 : 0); } }
+        source.conditionals.push_back({ line, !skipping, value, value, false });
+    } else if (name == "elif" || name == "else") {
+        if (source.conditionals.empty()) {
+            error(source, line, "#" + name + " without #if");
+        } else {
+            auto& conditional = source.conditionals.back();
+            if (conditional.sawElse)
+                error(source, line, "#" + name + " after #else");
+            if (name == "else") {
+                conditional.active = conditional.parentActive && !conditional.taken;
+                conditional.sawElse = true;
+            } else {
+                conditional.active = conditional.parentActive && !conditional.taken &&
+                                     evaluate(source, line, tokens); }
+            conditional.taken |= conditional.active; }
+    } else if (name == "endif") {
+        if (source.conditionals.empty())
+            error(source, line, "#endif without #if");
+        else
+            source.conditionals.pop_back();
+    } else if (skipping) {
+        // Other directives are ignored in skipped blocks.
+    } else if (name == "include") {
+        auto spec = text.substr(text.find("include") + 7);
+        spec.erase(0, spec.find_first_not_of(' '));
+        if (spec.empty() || (spec[0] != '"' && spec[0] != '<')) {
+            // #include MACRO
+            spec.clear();
+            for (auto& token : expandAll(tokens))
+                spec += (token.space && !spec.empty() ? " " : "") + token.text; }
+        char close = !spec.empty() && spec[0] == '<' ? '>' : '"';
+        auto end = spec.empty() ? std::string::npos : spec.find(close, 1);
+        if (end == std::string::npos || end == 1)
+            error(source, line, "#include expects \"FILENAME\" or <FILENAME>");
+        else if (include(source, line, spec.substr(1, end - 1), close == '>', out))
+            return;
+    } else if (name == "define") {
+        define(&source, line, tokens);
+    } else if (name == "undef") {
+        if (tokens.empty() || tokens.front().kind != Token::Identifier)
+            error(source, line, "no macro name given in #undef directive");
+        else
+            macros.erase(tokens.front().text);
+    } else if (name == "line" || lineMarker) {
+        // #line or a line marker: # 12 "file"
+        if (lineMarker)
+            tokens.insert(tokens.begin(), Token(Token::Number, name));
+        tokens = expandAll(tokens);
+        if (tokens.empty() || tokens.front().kind != Token::Number) {
+            error(source, line, "#line directive requires a line number");
+        } else {
+            source.line = strtoul(tokens.front().text.c_str(), nullptr, 10);
+            if (tokens.size() > 1 && tokens[1].kind == Token::String)
+                source.name = tokens[1].text.substr(1, tokens[1].text.size() - 2);
+            out += "# " + std::to_string(source.line) + " \"" + source.name + "\"\n";
+            return; }
+    } else if (name == "error" || name == "warning") {
+        auto message = text.substr(text.find(name) + name.size());
+        message.erase(0, message.find_first_not_of(' '));
+        if (name == "error")
+            error(source, line, "#error " + message);
+        else
+            ::warning(ErrorType::WARN_FAILED, "%1%:%2%: #warning %3%", cstring(source.name),
+                      line, cstring(message));
+    } else if (name == "pragma") {
+        if (tokens.size() == 1 && tokens.front().text == "once")
+            onceOnly.insert(source.name);
+    } else if (!name.empty()) {
+        // Not a directive: cpp -x assembler-with-cpp passes the line through.
+        out.append(source.text, start, source.pos - start);
+        return; }
+    out.append(lines, '\n');
+}
+
+void Preprocessor::define(Source* source, unsigned line, const std::vector<Token>& tokens) {
+    auto fail = [&](const std::string& message) {
+        if (source)
+            error(*source, line, message);
+        else
+            ::error(ErrorType::ERR_INVALID, "-D: %1%", cstring(message)); };
+    if (tokens.empty() || tokens.front().kind != Token::Identifier) {
+        fail("macro names must be identifiers");
+        return; }
+    Macro macro;
+    size_t i = 1;
+    if (i < tokens.size() && tokens[i].is("(") && !tokens[i].space) {
+        macro.functionLike = true;
+        for (++i; i < tokens.size() && !tokens[i].is(")"); ++i) {
+            if (!macro.params.empty()) {
+                if (!tokens[i].is(",") || ++i == tokens.size()) break; }
+            if (tokens[i].is("...")) {
+                macro.variadic = true;
+                macro.params.push_back("__VA_ARGS__");
+            } else if (tokens[i].kind == Token::Identifier && !macro.variadic) {
+                macro.params.push_back(tokens[i].text);
+            } else {
+                break; } }
+        if (i == tokens.size() || !tokens[i].is(")")) {
+            fail("invalid parameter list for macro " + tokens.front().text);
+            return; }
+        ++i; }
+    macro.body.assign(tokens.begin() + i, tokens.end());
+    if (!macro.body.empty())
+        macro.body.front().space = false;
+    macros[tokens.front().text] = std::move(macro);
+}
+
+bool Preprocessor::evaluate(Source& source, unsigned line, std::vector<Token> tokens) {
+    // Replace defined X and defined(X) before expanding macros.
+    std::vector<Token> replaced;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].kind != Token::Identifier || tokens[i].text != "defined") {
+            replaced.push_back(tokens[i]);
+            continue; }
+        bool parenthesized = i + 1 < tokens.size() && tokens[i + 1].is("(");
+        size_t name = i + (parenthesized ? 2 : 1);
+        if (name >= tokens.size() || tokens[name].kind != Token::Identifier ||
+            (parenthesized && (name + 1 >= tokens.size() || !tokens[name + 1].is(")")))) {
+            error(source, line, "operator \"defined\" requires an identifier");
+            return false; }
+        replaced.emplace_back(Token::Number, macros.count(tokens[name].text) ? "1" : "0");
+        i = name + (parenthesized ? 1 : 0); }
+    tokens = expandAll(std::move(replaced));
+    if (tokens.empty()) {
+        error(source, line, "#if with no expression");
+        return false; }
+    try {
+        return ExpressionParser(tokens).evaluate() != 0;
+    } catch (std::runtime_error& e) {
+        error(source, line, std::string("invalid #if expression: ") + e.what());
+        return false; }
+}
+
+void Preprocessor::text(Source& source, std::string& out) {
+    Expansion in(&source);
+    bool expanded = false;  // the last token written was produced by a macro
+    auto newline = [&]() {
+        out += '\n';
+        out.append(in.newlines, '\n');
+        in.newlines = 0;
+        return in.pending.empty(); };
+
+    while (true) {
+        if (!in.pending.empty()) {
+            Token token = std::move(in.pending.front());
+            in.pending.pop_front();
+            if (token.kind == Token::Identifier && expandMacro(in, token)) {
+                expanded = true;
+                continue; }
+            if (token.kind == Token::Newline) {
+                expanded = false;
+                if (newline()) return;
+                continue; }
+            if (token.kind == Token::Space) {
+                out += token.text;
+                expanded = false;
+                continue; }
+            if (token.space || (token.guard && !out.empty() &&
+                                wouldPaste(out.back(), token.text.front())))
+                out += ' ';
+            out += token.text;
+            expanded = true;
+            continue; }
+
+        // Copy the source until a macro is found.
+        if (source.atEnd()) {
+            if (in.newlines) newline();
+            return; }
+        const char* begin = source.begin();
+        const char* end;
+        auto kind = scan(begin, source.limit(), end);
+        source.pos += end - begin;
+        switch (kind) {
+            case Token::Newline:
+                source.line++;
+                if (newline()) return;
+                break;
+            case Token::Space:
+                if (*begin == '\\') {
+                    source.line++;
+                    in.newlines++;
+                } else {
+                    source.line += std::count(begin, end, '\n');
+                    out.append(begin, end); }
+                expanded = false;
+                break;
+            case Token::Identifier: {
+                Token name(kind, std::string(begin, end));
+                if (expandMacro(in, name)) {
+                    expanded = true;
+                    break; } }
+                // fall through
+            default:
+                if (expanded && !out.empty() && wouldPaste(out.back(), *begin))
+                    out += ' ';
+                if (kind == Token::String && std::find(begin, end, '\n') != end) {
+                    std::string string(begin, end);
+                    auto lines = splice(string);
+                    source.line += lines;
+                    in.newlines += lines;
+                    out += string;
+                } else {
+                    out.append(begin, end); }
+                expanded = false; } }
+}
+
+bool Preprocessor::expandMacro(Expansion& in, const Token& name) {
+    auto it = macros.find(name.text);
+    std::vector<Token> result;
+    if (it == macros.end()) {
+        if (name.text == "__LINE__" && current)
+            result.emplace_back(Token::Number, std::to_string(current->line));
+        else if (name.text == "__FILE__" && current)
+            result.emplace_back(Token::String, "\"" + current->name + "\"");
+        else
+            return false;
+    } else {
+        const Macro& macro = it->second;
+        if (std::find(name.hideSet.begin(), name.hideSet.end(), &macro) != name.hideSet.end())
+            return false;
+        if (!macro.functionLike) {
+            substitute(macro, {}, hideSetUnion(name.hideSet, { &macro }), result);
+        } else {
+            // Only a name followed by ( is an invocation.
+            std::vector<Token> skipped;
+            Token token;
+            while (in.next(token) && (token.kind == Token::Space || token.kind == Token::Newline))
+                skipped.push_back(token);
+            if (!token.is("(")) {
+                if (token.kind != Token::End)
+                    skipped.push_back(std::move(token));
+                in.pending.insert(in.pending.begin(), skipped.begin(), skipped.end());
+                return false; }
+            for (auto& space : skipped)
+                in.newlines += space.kind == Token::Newline ? 1 :
+                               std::count(space.text.begin(), space.text.end(), '\n');
+
+            std::vector<std::vector<Token>> args(1);
+            unsigned nesting = 0;
+            bool space = false;
+            while (true) {
+                if (!in.next(token)) {
+                    if (current)
+                        error(*current, current->line,
+                              "unterminated argument list invoking macro " + name.text);
+                    return true; }
+                if (token.kind == Token::Space || token.kind == Token::Newline) {
+                    in.newlines += token.kind == Token::Newline ? 1 :
+                                   std::count(token.text.begin(), token.text.end(), '\n');
+                    space = true;
+                    continue; }
+                if (token.is("(")) {
+                    ++nesting;
+                } else if (token.is(")")) {
+                    if (nesting == 0) break;
+                    --nesting;
+                } else if (token.is(",") && nesting == 0 &&
+                           !(macro.variadic && args.size() == macro.params.size())) {
+                    args.emplace_back();
+                    space = false;
+                    continue; }
+                token.space = space;
+                space = false;
+                args.back().push_back(std::move(token)); }
+            if (macro.params.empty() && args.size() == 1 && args[0].empty())
+                args.clear();
+            if (macro.variadic && args.size() + 1 == macro.params.size())
+                args.emplace_back();
+            if (args.size() != macro.params.size()) {
+                if (current)
+                    error(*current, current->line, "macro " + name.text + " passed " +
+                          std::to_string(args.size()) + " arguments, but takes " +
+                          std::to_string(macro.params.size()));
+                return true; }
+            std::vector<const Macro*> hideSet;
+            for (auto m : name.hideSet)
+                if (std::find(token.hideSet.begin(), token.hideSet.end(), m) !=
+                    token.hideSet.end())
+                    hideSet.push_back(m);
+            hideSet.push_back(&macro);
+            substitute(macro, args, hideSet, result); } }
+
+    if (!result.empty()) {
+        result.front().space = name.space;
+        result.front().guard = true; }
+    in.pending.insert(in.pending.begin(), result.begin(), result.end());
+    return true;
+}
+
+std::vector<Preprocessor::Token> Preprocessor::expandAll(std::vector<Token> tokens) {
+    Expansion in(nullptr);
+    in.pending.assign(tokens.begin(), tokens.end());
+    std::vector<Token> result;
+    Token token;
+    while (in.next(token))
+        if (token.kind != Token::Identifier || !expandMacro(in, token))
+            result.push_back(std::move(token));
+    return result;
+}
+
+void Preprocessor::substitute(const Macro& macro, const std::vector<std::vector<Token>>& args,
+                              const std::vector<const Macro*>& hideSet,
+                              std::vector<Token>& result) {
+    auto& body = macro.body;
+    size_t start = result.size();
+    bool placemarker = false;  // an empty argument was pasted
+    for (size_t i = 0; i < body.size(); ++i) {
+        auto& token = body[i];
+        int param = macro.param(token);
+        if (token.is("#") && macro.functionLike && i + 1 < body.size() &&
+            macro.param(body[i + 1]) >= 0) {
+            result.emplace_back(Token::String, stringify(args[macro.param(body[++i])]));
+            result.back().space = token.space;
+            placemarker = false;
+        } else if (token.is("##") && i + 1 < body.size()) {
+            auto& next = body[++i];
+            int rhsParam = macro.param(next);
+            std::vector<Token> rhs;
+            if (rhsParam >= 0)
+                rhs = args[rhsParam];
+            else
+                rhs.push_back(next);
+            if (rhsParam >= 0 && rhs.empty() && macro.variadic &&
+                rhsParam + 1 == static_cast<int>(macro.params.size()) &&
+                result.size() > start && result.back().is(",")) {
+                // The GNU , ## __VA_ARGS__ extension.
+                result.pop_back();
+            } else if (placemarker || result.size() == start) {
+                result.insert(result.end(), rhs.begin(), rhs.end());
+            } else if (!rhs.empty()) {
+                auto& lhs = result.back();
+                lhs.text += rhs.front().text;
+                const char* end;
+                lhs.kind = scan(lhs.text.data(), lhs.text.data() + lhs.text.size(), end);
+                result.insert(result.end(), rhs.begin() + 1, rhs.end()); }
+            placemarker = placemarker && rhs.empty();
+        } else if (param >= 0) {
+            bool pasted = i + 1 < body.size() && body[i + 1].is("##");
+            auto arg = pasted ? args[param] : expandAll(args[param]);
+            if (!arg.empty())
+                arg.front().space = token.space;
+            result.insert(result.end(), arg.begin(), arg.end());
+            placemarker = pasted && arg.empty();
+        } else {
+            result.push_back(token);
+            placemarker = false; } }
+    for (size_t i = start; i < result.size(); ++i)
+        result[i].hideSet = hideSetUnion(result[i].hideSet, hideSet);
+}
+
+}  // namespace P4
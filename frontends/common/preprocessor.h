@@ -0,0 +1,125 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _FRONTENDS_COMMON_PREPROCESSOR_H_
+#define _FRONTENDS_COMMON_PREPROCESSOR_H_
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/cstring.h"
+
+namespace P4 {
+
+/**
+ * A preprocessor for the part of the C preprocessor language used by P4
+ * programs, which runs in the compiler instead of in a cpp process.
+ *
+ * It handles #include "file" and <file>, object-like and function-like
+ * (including variadic) macros with # and ##, #undef, #if, #ifdef, #ifndef,
+ * #elif, #else and #endif with defined() and integer expressions, #line,
+ * #error, #warning and #pragma once.  Like `cpp -C -undef -nostdinc -x
+ * assembler-with-cpp`, which ParserOptions runs otherwise, it keeps comments,
+ * does not treat ' as a quote, passes unknown directives through, and marks
+ * the start and end of each included file with a line marker, so that the
+ * output can be parsed the same way.
+ */
+class Preprocessor {
+ public:
+    struct Macro;
+    struct Token {
+        enum Kind { Identifier, Number, String, Punctuation, Space, Newline, End };
+        Kind kind = End;
+        std::string text;
+        /// True if preceded by white space.
+        bool space = false;
+        /// True for the first token of an expansion, which is separated from the
+        /// previous token if they would otherwise form a single token.
+        bool guard = false;
+        /// The macros whose expansions produced this token, which are not
+        /// expanded again (Prosser's algorithm).
+        std::vector<const Macro*> hideSet;
+
+        Token() = default;
+        Token(Kind kind, std::string text) : kind(kind), text(std::move(text)) {}
+        bool is(const char* punctuation) const {
+            return kind == Punctuation && text == punctuation; }
+    };
+    struct Macro {
+        bool functionLike = false;
+        bool variadic = false;
+        std::vector<std::string> params;
+        std::vector<Token> body;
+        int param(const Token& token) const;
+    };
+
+ private:
+    struct Source;
+    class Expansion;
+
+    /// State of a conditional directive.
+    struct Conditional {
+        unsigned line;
+        bool parentActive;
+        bool active;   // the current branch is included
+        bool taken;    // a branch has been included
+        bool sawElse;
+    };
+
+    std::unordered_map<std::string, Macro> macros;
+    std::vector<std::string> includePaths;
+    std::set<std::string> onceOnly;
+    Source* current = nullptr;
+    unsigned depth = 0;
+
+    void error(const Source& source, unsigned line, const std::string& message);
+    bool include(Source& from, unsigned line, const std::string& name, bool angled,
+                 std::string& out);
+    void processFile(Source& source, std::string& out);
+    void directive(Source& source, std::string& out);
+    void skipLine(Source& source, std::string& out);
+    void text(Source& source, std::string& out);
+    void define(Source* source, unsigned line, const std::vector<Token>& tokens);
+    bool evaluate(Source& source, unsigned line, std::vector<Token> tokens);
+
+    bool expandMacro(Expansion& in, const Token& name);
+    std::vector<Token> expandAll(std::vector<Token> tokens);
+    void substitute(const Macro& macro, const std::vector<std::vector<Token>>& args,
+                    const std::vector<const Macro*>& hideSet, std::vector<Token>& result);
+
+ public:
+    Preprocessor();
+    /// Adds @dir to the directories searched by #include.
+    void addIncludePath(cstring dir);
+    /// Defines a macro like cpp's -D: @definition is NAME, NAME=body or
+    /// NAME(params)=body.
+    void define(cstring definition);
+    /// Removes the definition of macro @name, like cpp's -U.
+    void undefine(cstring name);
+    /// Applies the cpp command line options in @options.
+    /// @returns false if it contains options other than -I, -D and -U, which
+    /// are not supported.
+    bool addOptions(cstring options);
+    /// Preprocesses @file, appending the result to @out.
+    /// @returns false if errors were reported.
+    bool process(cstring file, std::string& out);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_PREPROCESSOR_H_ */
@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _FRONTENDS_COMMON_PROGRAMMAP_H_
 #define _FRONTENDS_COMMON_PROGRAMMAP_H_
 
+#include <vector>
+
 #include "ir/ir.h"
 
 namespace P4 {
@@ -28,10 +30,38 @@ class ProgramMap : public IHasDbPrint {
  protected:
     const IR::P4Program* program = nullptr;
     cstring mapKind;
+    // If true the map is updated, rather than recomputed, when only some of
+    // the top-level objects of the program change.
+    bool incremental = false;
     explicit ProgramMap(cstring kind) : mapKind(kind) {}
     virtual ~ProgramMap() {}
 
+    // Computes the positions of the top-level objects of 'to' which are not
+    // the same as in 'from'; as IR nodes are never modified in place, all
+    // other objects are unchanged.  Returns false if the objects of the two
+    // programs do not correspond one to one.
+    static bool changedObjects(const IR::P4Program* from, const IR::P4Program* to,
+                               std::vector<size_t> &changed) {
+        if (from == nullptr || to == nullptr || from->objects.size() != to->objects.size())
+            return false;
+        for (size_t i = 0; i < to->objects.size(); ++i) {
+            auto before = from->objects.at(i), after = to->objects.at(i);
+            if (before == after)
+                continue;
+            if (before->node_type_name() != after->node_type_name())
+                return false;
+            auto beforeDecl = before->to<IR::IDeclaration>();
+            auto afterDecl = after->to<IR::IDeclaration>();
+            if (beforeDecl && afterDecl && beforeDecl->getName() != afterDecl->getName())
+                return false;
+            changed.push_back(i); }
+        LOG2(changed.size() << " of " << to->objects.size() << " objects changed");
+        return true;
+    }
+
  public:
+    void setIncremental(bool incremental) { this->incremental = incremental; }
+    bool isIncremental() const { return incremental; }
     // Check if map is up-to-date for the specified node; return true if it is
     bool checkMap(const IR::Node* node) const {
         if (node == program) {
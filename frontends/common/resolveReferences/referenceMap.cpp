@@ -32,10 +32,108 @@ void ReferenceMap::clear() {
     usedNames.clear();
     used.clear();
     thisToDeclaration.clear();
+    objectReferences.clear();
+    resolutions.clear();
+    current = nullptr;
+    endUpdate();
     for (auto &reserved : P4::reservedWords)
         usedNames.insert({reserved, 0});
 }
 
+void ReferenceMap::beginObject(const IR::Node* object) {
+    current = &objectReferences[object];
+    *current = ObjectReferences();
+}
+
+void ReferenceMap::forget(const IR::Node* object) {
+    auto it = objectReferences.find(object);
+    if (it == objectReferences.end())
+        return;
+    auto lastResolution = [this](const IR::Node* node) {
+        auto count = resolutions.find(node);
+        if (count == resolutions.end() || --count->second > 0)
+            return false;
+        resolutions.erase(count);
+        return true; };
+    for (auto path : it->second.paths) {
+        if (!lastResolution(path))
+            continue;  // also in an object which is kept
+        auto decl = pathToDeclaration.find(path);
+        if (decl == pathToDeclaration.end())
+            continue;
+        auto count = used.find(decl->second);
+        if (count != used.end() && --count->second == 0)
+            used.erase(count);
+        pathToDeclaration.erase(decl); }
+    for (auto pointer : it->second.pointers)
+        if (lastResolution(pointer))
+            thisToDeclaration.erase(pointer);
+    objectReferences.erase(it);
+}
+
+std::set<const IR::Node*> ReferenceMap::dependents(const IR::P4Program* program,
+                                                   const std::set<const IR::Node*> &objects,
+                                                   bool transitive) const {
+    std::set<const IR::Node*> result(objects);
+    std::set<const IR::Node*> added(objects);
+    while (!added.empty()) {
+        std::unordered_set<const IR::IDeclaration*> declarations;
+        for (auto object : added)
+            forAllMatching<IR::Node>(object, [&](const IR::Node* node) {
+                if (auto decl = node->to<IR::IDeclaration>())
+                    declarations.insert(decl); });
+        added.clear();
+        for (auto object : program->objects) {
+            if (result.count(object))
+                continue;
+            auto refs = objectReferences.find(object);
+            if (refs == objectReferences.end()) {
+                // not resolved object by object, so it may refer to anything
+                added.insert(object);
+                continue; }
+            bool refers = false;
+            for (auto path : refs->second.paths)
+                refers = refers || declarations.count(get(pathToDeclaration, path));
+            for (auto pointer : refs->second.pointers)
+                refers = refers || declarations.count(get(thisToDeclaration, pointer));
+            if (refers)
+                added.insert(object); }
+        result.insert(added.begin(), added.end());
+        if (!transitive)
+            break; }
+    return result;
+}
+
+bool ReferenceMap::beginUpdate(const IR::P4Program* newProgram) {
+    endUpdate();
+    std::vector<size_t> changed;
+    if (!incremental || !changedObjects(program, newProgram, changed))
+        return false;
+    for (auto object : program->objects)
+        if (!objectReferences.count(object))
+            return false;  // not resolved object by object
+    std::set<const IR::Node*> modified;
+    for (auto i : changed)
+        modified.insert(program->objects.at(i));
+    auto stale = dependents(program, modified, false);
+    for (size_t i = 0; i < program->objects.size(); ++i) {
+        auto object = program->objects.at(i);
+        if (stale.count(object)) {
+            forget(object);
+            toResolve.insert(newProgram->objects.at(i)); } }
+    LOG2("Resolving " << toResolve.size() << " of " << newProgram->objects.size() << " objects");
+
+    // Start again from the names used by the objects which are kept, as clear() would.
+    usedNames.clear();
+    for (auto &reserved : P4::reservedWords)
+        usedNames.insert({reserved, 0});
+    for (auto &refs : objectReferences)
+        for (auto name : refs.second.names)
+            usedNames.insert({name, 0});
+    updating = true;
+    return true;
+}
+
 void ReferenceMap::setDeclaration(const IR::Path* path, const IR::IDeclaration* decl) {
     CHECK_NULL(path);
     CHECK_NULL(decl);
@@ -44,9 +142,12 @@ void ReferenceMap::setDeclaration(const IR::Path* path, const IR::IDeclaration*
     if (previous != nullptr && previous != decl)
         BUG("%1% already resolved to %2% instead of %3%",
             dbp(path), dbp(previous), dbp(decl->getNode()));
-    pathToDeclaration.emplace(path, decl);
+    if (pathToDeclaration.emplace(path, decl).second)
+        ++used[decl];
+    if (current) {
+        current->paths.push_back(path);
+        ++resolutions[path]; }
     usedName(path->name.name);
-    used.insert(decl);
 }
 
 void ReferenceMap::setDeclaration(const IR::This* pointer, const IR::IDeclaration* decl) {
@@ -58,6 +159,9 @@ void ReferenceMap::setDeclaration(const IR::This* pointer, const IR::IDeclaratio
         BUG("%1% already resolved to %2% instead of %3%",
             dbp(pointer), dbp(previous), dbp(decl));
     thisToDeclaration.emplace(pointer, decl);
+    if (current) {
+        current->pointers.push_back(pointer);
+        ++resolutions[pointer]; }
 }
 
 const IR::IDeclaration* ReferenceMap::getDeclaration(const IR::This* pointer, bool notNull) const {
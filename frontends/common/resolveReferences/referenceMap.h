@@ -17,6 +17,11 @@ limitations under the License.
 #ifndef _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 #define _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "ir/ir.h"
 #include "lib/cstring.h"
 #include "lib/map.h"
@@ -68,8 +73,8 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     /// Maps paths in the program to declarations.
     ordered_map<const IR::Path*, const IR::IDeclaration*> pathToDeclaration;
 
-    /// Set containing all declarations in the program.
-    std::set<const IR::IDeclaration*> used;
+    /// All declarations used in the program, with the number of paths resolved to each.
+    std::unordered_map<const IR::IDeclaration*, unsigned> used;
 
     /// Map from `This` to declarations (an experimental feature).
     std::map<const IR::This*, const IR::IDeclaration*> thisToDeclaration;
@@ -78,6 +83,30 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     /// this name was used as a base for newly generated unique names.
     std::unordered_map<cstring, int> usedNames;
 
+    /// What resolving a top-level object of the program added to the map.
+    struct ObjectReferences {
+        std::vector<const IR::Path*> paths;
+        std::vector<const IR::This*> pointers;
+        std::unordered_set<cstring> names;
+    };
+
+    /// The references of each top-level object of the program, for incremental updates.
+    std::unordered_map<const IR::Node*, ObjectReferences> objectReferences;
+
+    /// How many times the objects resolved each path or `this`: a node shared by
+    /// several objects keeps its declaration until the last of them is forgotten.
+    std::unordered_map<const IR::Node*, unsigned> resolutions;
+
+    /// The references of the object being resolved, if any.
+    ObjectReferences* current = nullptr;
+
+    /// During an incremental update, the objects of the new program which must be resolved.
+    std::unordered_set<const IR::Node*> toResolve;
+    bool updating = false;
+
+    /// Removes the references of top-level @p object from the map.
+    void forget(const IR::Node* object);
+
  public:
     ReferenceMap();
     /// Looks up declaration for @p path. If @p notNull is false, then
@@ -115,7 +144,33 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     bool isUsed(const IR::IDeclaration* decl) const { return used.count(decl) > 0; }
 
     /// Indicate that @p name is used in the program.
-    void usedName(cstring name) { usedNames.insert({name, 0}); }
+    void usedName(cstring name) {
+        usedNames.insert({name, 0});
+        if (current)
+            current->names.insert(name); }
+
+    /// Prepares to update the map for @p program, if the map is incremental and the
+    /// top-level objects of @p program correspond to those of the program of the map.
+    /// The references of the objects which changed, and of the objects referring to
+    /// declarations in them, are removed; all others are kept.
+    /// @returns false if the map must be recomputed instead.
+    bool beginUpdate(const IR::P4Program* program);
+    void endUpdate() { updating = false; toResolve.clear(); }
+    /// @returns true unless the map is being updated and top-level @p object is unchanged.
+    bool needsResolution(const IR::Node* object) const {
+        return !updating || toResolve.count(object) != 0; }
+
+    /// Attributes the references resolved until endObject() to top-level @p object.
+    void beginObject(const IR::Node* object);
+    void endObject() { current = nullptr; }
+
+    /// @returns the top-level objects of @p program, which must be the program of the map,
+    /// that refer to declarations in @p objects, including @p objects themselves.  If
+    /// @p transitive is true, objects referring to declarations in these objects are
+    /// included too, and so on.
+    std::set<const IR::Node*> dependents(const IR::P4Program* program,
+                                         const std::set<const IR::Node*> &objects,
+                                         bool transitive) const;
 };
 
 }  // namespace P4
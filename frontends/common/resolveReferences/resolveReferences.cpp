@@ -39,13 +39,28 @@ ResolutionContext::resolve(IR::ID name, P4::ResolutionType type) const {
     return &empty;
 }
 
+const std::vector<const IR::IDeclaration*> &
+ResolutionContext::declsByName(const IR::IGeneralNamespace *ns, cstring name) const {
+    auto it = symbolTables.find(ns);
+    if (it == symbolTables.end()) {
+        it = symbolTables.emplace(ns, SymbolTable()).first;
+        for (auto decl : *ns->getDeclarations()) {
+            CHECK_NULL(decl);
+            it->second[decl->getName().name].push_back(decl); } }
+    auto decls = it->second.find(name);
+    return decls == it->second.end() ? empty : decls->second;
+}
+
 const std::vector<const IR::IDeclaration*>*
 ResolutionContext::lookup(const IR::INamespace *current, IR::ID name,
                           P4::ResolutionType type) const {
     LOG2("Trying to resolve in " << current->toString());
 
     if (auto gen = current->to<IR::IGeneralNamespace>()) {
-        Util::Enumerator<const IR::IDeclaration*> *decls = gen->getDeclsByName(name);
+        Util::Enumerator<const IR::IDeclaration*> *decls = useSymbolTables
+                ? Util::Enumerator<const IR::IDeclaration*>::createEnumerator(
+                    declsByName(gen, name.name))
+                : gen->getDeclsByName(name);
         switch (type) {
             case P4::ResolutionType::Any:
                 break;
@@ -338,12 +353,16 @@ void ResolveReferences::checkShadowing(const IR::INamespace *ns) const {
 
 Visitor::profile_t ResolveReferences::init_apply(const IR::Node *node) {
     anyOrder = refMap->isV1();
-    if (!refMap->checkMap(node))
+    if (!refMap->checkMap(node) &&
+        !(node->is<IR::P4Program>() && refMap->beginUpdate(node->to<IR::P4Program>())))
         refMap->clear();
+    enableSymbolTables();
     return Inspector::init_apply(node);
 }
 
 void ResolveReferences::end_apply(const IR::Node *node) {
+    disableSymbolTables();
+    refMap->endUpdate();
     refMap->updateMap(node);
 }
 
@@ -352,11 +371,16 @@ void ResolveReferences::end_apply(const IR::Node *node) {
 bool ResolveReferences::preorder(const IR::P4Program *program) {
     if (refMap->checkMap(program))
         return false;
-    return true;
-}
-
-void ResolveReferences::postorder(const IR::P4Program *) {
+    // Resolve each top-level object separately, so that the map can be
+    // updated later for the objects which change.
+    for (auto object : program->objects) {
+        if (!refMap->needsResolution(object))
+            continue;
+        refMap->beginObject(object);
+        visit(object, "objects");
+        refMap->endObject(); }
     LOG2("Reference map " << refMap);
+    return false;
 }
 
 bool ResolveReferences::preorder(const IR::This *pointer) {
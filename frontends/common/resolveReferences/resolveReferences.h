@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _COMMON_RESOLVEREFERENCES_RESOLVEREFERENCES_H_
 #define _COMMON_RESOLVEREFERENCES_RESOLVEREFERENCES_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "ir/ir.h"
 #include "referenceMap.h"
 #include "lib/exceptions.h"
@@ -33,6 +36,17 @@ enum class ResolutionType {
 
 /// Visitor mixin for looking up names in enclosing scopes from the Visitor::Context
 class ResolutionContext : virtual public Visitor, public DeclarationLookup {
+    /// Declarations of a general namespace indexed by name, in declaration order.
+    typedef std::unordered_map<cstring, std::vector<const IR::IDeclaration*>> SymbolTable;
+
+    /// Symbol tables of the general namespaces looked up so far, if enabled.
+    mutable std::unordered_map<const IR::IGeneralNamespace*, SymbolTable> symbolTables;
+    bool useSymbolTables = false;
+
+    /// @returns the declarations named @p name in @p ns, in declaration order.
+    const std::vector<const IR::IDeclaration*> &
+    declsByName(const IR::IGeneralNamespace *ns, cstring name) const;
+
  protected:
     // Note that all errors have been merged by the parser into
     // a single error { } namespace.
@@ -55,6 +69,11 @@ class ResolutionContext : virtual public Visitor, public DeclarationLookup {
     ResolutionContext();
     explicit ResolutionContext(bool ao) : anyOrder(ao) {}
 
+    /// Index each general namespace by name the first time it is searched, instead of
+    /// scanning its declarations for every lookup.  The tables are keyed by node, so
+    /// this may only be enabled while the IR being visited does not change.
+    void enableSymbolTables() { useSymbolTables = true; }
+    void disableSymbolTables() { useSymbolTables = false; symbolTables.clear(); }
 
     /// We are resolving a method call.  Find the arguments from the context.
     const IR::Vector<IR::Argument> *methodArguments(cstring name) const;
@@ -107,7 +126,6 @@ class ResolveReferences : public Inspector, private ResolutionContext {
     bool preorder(const IR::Declaration_Instance *decl) override;
 
     bool preorder(const IR::P4Program *t) override;
-    void postorder(const IR::P4Program *t) override;
     bool preorder(const IR::P4Control *t) override;
     bool preorder(const IR::P4Parser *t) override;
     bool preorder(const IR::P4Action *t) override;
@@ -244,25 +244,44 @@ const LocationSet* LocationSet::allElements() const {
     return result;
 }
 
+const LocationSet* StorageLocation::canonical() const {
+    if (canonicalSet != nullptr)
+        return canonicalSet;
+    LocationSet* result = new LocationSet();
+    if (is<BaseLocation>()) {
+        result->add(this);
+    } else if (auto wfl = to<WithFieldsLocation>()) {
+        for (auto f : wfl->fields())
+            result->addCanonical(f);
+    } else if (auto a = to<IndexedLocation>()) {
+        for (auto e : *a)
+            result->addCanonical(e);
+    } else {
+        BUG("unexpected location");
+    }
+    result->canonical = result;
+    canonicalSet = result;
+    return result;
+}
+
 const LocationSet* LocationSet::canonicalize() const {
+    if (canonical != nullptr)
+        return canonical;
+    if (locations.size() == 1) {
+        canonical = (*locations.begin())->canonical();
+        return canonical;
+    }
     LocationSet* result = new LocationSet();
     for (auto e : locations)
         result->addCanonical(e);
+    result->canonical = result;
+    canonical = result;
     return result;
 }
 
 void LocationSet::addCanonical(const StorageLocation* location) {
-    if (location->is<BaseLocation>()) {
-        add(location);
-    } else if (auto wfl = location->to<WithFieldsLocation>()) {
-        for (auto f : wfl->fields())
-            addCanonical(f);
-    } else if (auto a = location->to<IndexedLocation>()) {
-        for (auto e : *a)
-            addCanonical(e);
-    } else {
-        BUG("unexpected location");
-    }
+    for (auto l : *location->canonical())
+        add(l);
 }
 
 bool LocationSet::overlaps(const LocationSet* other) const {
@@ -274,10 +293,19 @@ bool LocationSet::overlaps(const LocationSet* other) const {
 }
 
 const ProgramPoints* ProgramPoints::merge(const ProgramPoints* with) const {
-    auto result = new ProgramPoints(points);
-    for (auto p : with->points)
+    if (with == this)
+        return this;
+    // Only copy the points if some are missing, so that merging
+    // definitions which already agree does not allocate.
+    ProgramPoints* result = nullptr;
+    for (auto p : with->points) {
+        if (points.find(p) != points.end())
+            continue;
+        if (result == nullptr)
+            result = new ProgramPoints(points);
         result->points.emplace(p);
-    return result;
+    }
+    return result != nullptr ? result : this;
 }
 
 ProgramPoint::ProgramPoint(const ProgramPoint &context, const IR::Node* node) {
@@ -311,35 +339,19 @@ bool ProgramPoints::operator==(const ProgramPoints& other) const {
 }
 
 Definitions* Definitions::joinDefinitions(const Definitions* other) const {
-    auto result = new Definitions();
-    for (auto d : other->definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(definitions, loc);
-        if (current != nullptr) {
-            auto merged = current->merge(defs);
-            result->definitions.emplace(loc, merged);
-        } else {
-            result->definitions.emplace(loc, defs);
-        }
-    }
-    for (auto d : definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(other->definitions, loc);
-        if (current == nullptr)
-            result->definitions.emplace(loc, defs);
-        // otherwise have have already done it in the loop above
-    }
-    if (unreachable && other->unreachable)
-        result->setUnreachable();
+    auto result = new Definitions(*this);
+    // The locations that were not written since the two definitions
+    // diverged are shared, and are skipped.
+    result->definitions.unite(other->definitions,
+                              [](const BaseLocation*, const ProgramPoints*& points,
+                                 const ProgramPoints* otherPoints) {
+                                  points = points->merge(otherPoints); });
+    result->unreachable = unreachable && other->unreachable;
     return result;
 }
 
 void Definitions::setDefinition(const StorageLocation* location, const ProgramPoints* point) {
-    LocationSet locset;
-    locset.addCanonical(location);
-    for (auto sl : locset)
+    for (auto sl : *location->canonical())
         definitions[sl->to<BaseLocation>()] = point;
 }
 
@@ -349,14 +361,8 @@ void Definitions::setDefinition(const LocationSet* locations, const ProgramPoint
 }
 
 void Definitions::removeLocation(const StorageLocation* location) {
-    auto loc = new LocationSet();
-    loc->addCanonical(location);
-    for (auto sl : *loc) {
-        auto bl = sl->to<BaseLocation>();
-        auto it = definitions.find(bl);
-        if (it != definitions.end())
-            definitions.erase(it);
-    }
+    for (auto sl : *location->canonical())
+        definitions.erase(sl->to<BaseLocation>());
 }
 
 const ProgramPoints* Definitions::getPoints(const LocationSet* locations) const {
@@ -379,13 +385,17 @@ Definitions* Definitions::writes(ProgramPoint point, const LocationSet* location
 }
 
 bool Definitions::operator==(const Definitions& other) const {
+    // Identical program point sets are the common case.
+    if (definitions == other.definitions)
+        return true;
     if (definitions.size() != other.definitions.size())
         return false;
-    for (auto d : definitions) {
-        auto od = ::get(other.definitions, d.first);
-        if (od == nullptr)
+    // Both are sorted in the same order.
+    for (auto d = definitions.begin(), od = other.definitions.begin();
+         d != definitions.end(); ++d, ++od) {
+        if (d->first != od->first)
             return false;
-        if (!d.second->operator==(*od))
+        if (d->second != od->second && !d->second->operator==(*od->second))
             return false;
     }
     return true;
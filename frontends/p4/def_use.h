@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "lib/ordered_map.h"
 #include "lib/ordered_set.h"
+#include "lib/persistent_map.h"
 #include "ir/ir.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 
@@ -62,6 +63,11 @@ class StorageLocation : public IHasDbPrint {
     /// @returns All locations inside that represent the 'lastIndex' of an array.
     const LocationSet* getLastIndexField() const;
     virtual void addLastIndexField(LocationSet* result) const = 0;
+    /// @returns All the BaseLocations inside; computed once, when first needed.
+    const LocationSet* canonical() const;
+
+ private:
+    mutable const LocationSet* canonicalSet = nullptr;
 };
 
 /** Represents a storage location with a simple type or a tuple type.
@@ -186,6 +192,9 @@ class StorageFactory {
 /// In general this is a conservative approximation of the actual location set.
 class LocationSet : public IHasDbPrint {
     ordered_set<const StorageLocation*> locations;
+    /// Result of canonicalize(), cleared when a location is added.
+    mutable const LocationSet* canonical = nullptr;
+    friend class StorageLocation;
 
  public:
     LocationSet() = default;
@@ -201,10 +210,12 @@ class LocationSet : public IHasDbPrint {
     const LocationSet* getArrayLastIndex() const;
 
     void add(const StorageLocation* location)
-    { CHECK_NULL(location); locations.emplace(location); }
+    { CHECK_NULL(location); locations.emplace(location); canonical = nullptr; }
     const LocationSet* join(const LocationSet* other) const;
     /// @returns this location set expressed only in terms of BaseLocation;
-    /// e.g., a StructLocation is expanded in all its fields.
+    /// e.g., a StructLocation is expanded in all its fields.  The result is
+    /// computed once per set (and once per StorageLocation), and must not be
+    /// modified.
     const LocationSet* canonicalize() const;
     void addCanonical(const StorageLocation* location);
     ordered_set<const StorageLocation*>::const_iterator begin() const { return locations.cbegin(); }
@@ -351,13 +362,25 @@ class ProgramPoints : public IHasDbPrint {
     { return points.cend(); }
 };
 
+/// Orders storage locations by id, so that the order does not depend on addresses.
+struct StorageLocationOrder {
+    bool operator()(const StorageLocation* a, const StorageLocation* b) const
+    { return a->id < b->id; }
+};
+struct StorageLocationHash {
+    std::size_t operator()(const StorageLocation* l) const { return l->id; }
+};
+
 /// List of definers for each base storage (at a specific program point).
 class Definitions : public IHasDbPrint {
     /// Set of program points that have written last to each location
-    /// (conservative approximation).
-    ordered_map<const BaseLocation*, const ProgramPoints*> definitions;
+    /// (conservative approximation).  There is a Definitions object for
+    /// each program point, each a slightly changed copy of the previous
+    /// one, so the copies share all the locations they do not change.
+    persistent_map<const BaseLocation*, const ProgramPoints*,
+                   StorageLocationOrder, StorageLocationHash> definitions;
     /// If true the current program point is actually unreachable.
-    bool unreachable;
+    bool unreachable = false;
 
  public:
     Definitions() = default;
@@ -373,7 +396,7 @@ class Definitions : public IHasDbPrint {
     Definitions* setUnreachable() { unreachable = true; return this; }
     bool isUnreachable() const { return unreachable; }
     bool hasLocation(const BaseLocation* location) const
-    { return definitions.find(location) != definitions.end(); }
+    { return definitions.count(location) != 0; }
     const ProgramPoints* getPoints(const BaseLocation* location) const {
         auto r = ::get(definitions, location);
         BUG_CHECK(r != nullptr, "no definitions found for %1%", location);
@@ -22,6 +22,7 @@ limitations under the License.
 #include "lib/nullstream.h"
 #include "lib/path.h"
 #include "frontend.h"
+#include "frontendCache.h"
 
 #include "frontends/p4/typeMap.h"
 #include "frontends/p4/typeChecking/bindVariables.h"
@@ -153,6 +154,8 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
     ReferenceMap  refMap;
     TypeMap       typeMap;
     refMap.setIsV1(isv1);
+    refMap.setIncremental(options.incrementalMaps);
+    typeMap.setIncremental(options.incrementalMaps);
 
     auto evaluator = new P4::EvaluatorPass(&refMap, &typeMap);
     PassManager passes({
@@ -198,7 +201,7 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
         new PassRepeated({
             new ConstantFolding(&refMap, &typeMap),
             new StrengthReduction(&refMap, &typeMap),
-            new Reassociation(),
+            new ParallelForEachDeclaration([] { return new Reassociation(); }),
             new UselessCasts(&refMap, &typeMap)
         }),
         new SimplifyControlFlow(&refMap, &typeMap),
@@ -208,12 +211,14 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
         new SimplifyParsers(&refMap),
         new ResetHeaders(&refMap, &typeMap),
         new UniqueNames(&refMap),  // Give each local declaration a unique internal name
-        new MoveDeclarations(),  // Move all local declarations to the beginning
+        // Move all local declarations to the beginning
+        new ParallelForEachDeclaration([] { return new MoveDeclarations(); }),
         new MoveInitializers(&refMap),
         new SideEffectOrdering(&refMap, &typeMap, skipSideEffectOrdering),
         new SimplifyControlFlow(&refMap, &typeMap),
         new SimplifySwitch(&refMap, &typeMap),
-        new MoveDeclarations(),  // Move all local declarations to the beginning
+        // Move all local declarations to the beginning
+        new ParallelForEachDeclaration([] { return new MoveDeclarations(); }),
         new SimplifyDefUse(&refMap, &typeMap),
         new UniqueParameters(&refMap, &typeMap),
         new SimplifyControlFlow(&refMap, &typeMap),
@@ -242,7 +247,8 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
         new SimplifyControlFlow(&refMap, &typeMap),
         new RemoveParserControlFlow(&refMap, &typeMap),  // more ifs may have been added to parsers
         new UniqueNames(&refMap),  // needed again after inlining
-        new MoveDeclarations(),  // needed again after inlining
+        // needed again after inlining
+        new ParallelForEachDeclaration([] { return new MoveDeclarations(); }),
         new SimplifyControlFlow(&refMap, &typeMap),
         new HierarchicalNames(),
         new FrontEndLast(),
@@ -260,7 +266,17 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
     passes.setName("FrontEnd");
     passes.setStopOnError(true);
     passes.addDebugHooks(hooks, true);
+
+    if (!FrontEndCache::enabled(options))
+        return program->apply(passes);
+
+    FrontEndCache cache(options, program, skipSideEffectOrdering);
+    if (auto cached = cache.load(options))
+        return cached;
+    FrontEndCache::Recorder diagnostics;
     const IR::P4Program* result = program->apply(passes);
+    if (result && ::errorCount() == 0)
+        cache.store(result, diagnostics);
     return result;
 }
 
@@ -0,0 +1,191 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "frontendCache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+
+#include "ir/binary_loader.h"
+#include "ir/json_generator.h"
+#include "lib/compile_context.h"
+#include "lib/hash.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+/// Hash of the JSON representation of @node.  Node ids depend on how many
+/// nodes were created before, so they are renumbered in the order in which the
+/// nodes are first written; references to nodes already written (i.e. shared
+/// nodes) keep referring to the same number.
+size_t hashIR(const IR::Node *node) {
+    std::stringstream json;
+    JSONGenerator(json, true) << node;
+    std::string text = json.str();
+    static const std::string idKey = "\"Node_ID\" : ";
+    std::unordered_map<std::string, size_t> renumbered;
+    std::string canonical;
+    size_t pos = 0;
+    for (size_t found; (found = text.find(idKey, pos)) != std::string::npos;) {
+        size_t start = found + idKey.size();
+        size_t end = start;
+        while (end < text.size() && isdigit(text[end])) ++end;
+        canonical.append(text, pos, start - pos);
+        canonical += std::to_string(
+            renumbered.emplace(text.substr(start, end - start), renumbered.size()).first->second);
+        pos = end; }
+    canonical.append(text, pos, std::string::npos);
+    return Util::Hash::murmur(canonical.data(), canonical.size());
+}
+
+cstring hexString(size_t value) {
+    std::stringstream ss;
+    ss << std::hex << std::setw(2 * sizeof(value)) << std::setfill('0') << value;
+    return ss.str();
+}
+
+}  // namespace
+
+FrontEndCache::FrontEndCache(const CompilerOptions &options, const IR::P4Program *program,
+                             bool skipSideEffectOrdering) : dir(options.frontendCacheDir) {
+    std::stringstream fingerprint;
+    // Everything besides the program which changes what the front-end produces.
+    fingerprint << options.exe_name << '\n' << options.compilerVersion << '\n'
+                << static_cast<int>(options.langVersion) << '\n'
+                << options.optimizeParserInlining << skipSideEffectOrdering << '\n';
+    for (auto pass : options.passesToExcludeFrontend)
+        fingerprint << pass << ',';
+    fingerprint << '\n';
+
+    fingerprint << hexString(hashIR(program)) << '\n';
+    std::string text = fingerprint.str();
+    key = hexString(Util::Hash::murmur(text.data(), text.size()));
+}
+
+bool FrontEndCache::enabled(const CompilerOptions &options) {
+    // Cached results would not produce the outputs of these debugging options.
+    return !options.frontendCacheDir.isNullOrEmpty() && options.top4.empty() &&
+           options.prettyPrintFile.isNullOrEmpty();
+}
+
+cstring FrontEndCache::entryFile() const {
+    return dir + "/" + key + ".ir";
+}
+
+cstring FrontEndCache::warningsFile() const {
+    return dir + "/" + key + ".warnings";
+}
+
+int FrontEndCache::Recorder::TeeBuffer::overflow(int ch) {
+    if (ch != traits_type::eof()) {
+        out.put(static_cast<char>(ch));
+        copy += static_cast<char>(ch); }
+    return ch;
+}
+
+std::streamsize FrontEndCache::Recorder::TeeBuffer::xsputn(const char *s, std::streamsize n) {
+    out.write(s, n);
+    copy.append(s, n);
+    return n;
+}
+
+int FrontEndCache::Recorder::TeeBuffer::sync() {
+    out.flush();
+    return 0;
+}
+
+FrontEndCache::Recorder::Recorder()
+    : saved(BaseCompileContext::get().errorReporter().getOutputStream()),
+      initialWarnings(BaseCompileContext::get().errorReporter().getWarningCount()),
+      buffer(*saved, text), tee(&buffer) {
+    BaseCompileContext::get().errorReporter().setOutputStream(&tee);
+}
+
+FrontEndCache::Recorder::~Recorder() {
+    BaseCompileContext::get().errorReporter().setOutputStream(saved);
+}
+
+unsigned FrontEndCache::Recorder::warnings() const {
+    return BaseCompileContext::get().errorReporter().getWarningCount() - initialWarnings;
+}
+
+const IR::P4Program *FrontEndCache::load(const CompilerOptions &options) const {
+    if (access(entryFile(), R_OK) != 0) {
+        LOG1("Front-end cache miss for " << options.file << " (" << key << ")");
+        return nullptr; }
+    BinaryLoader loader(entryFile());
+    const IR::Node *node = nullptr;
+    try {
+        if (loader.valid())
+            loader >> node;
+    } catch (Util::CompilationError &) {
+        node = nullptr; }
+    auto program = node ? node->to<IR::P4Program>() : nullptr;
+    if (program == nullptr) {
+        LOG1("Front-end cache entry " << entryFile() << " is corrupt, ignoring it");
+        return nullptr; }
+    LOG1("Front-end cache hit for " << options.file << " (" << key << ")");
+
+    std::ifstream in(warningsFile());
+    unsigned count = 0;
+    if (in >> count && count > 0) {
+        in.ignore(1);  // the newline after the count
+        std::stringstream text;
+        text << in.rdbuf();
+        BaseCompileContext::get().errorReporter().replayWarnings(text.str(), count); }
+    return program;
+}
+
+void FrontEndCache::store(const IR::P4Program *result, const Recorder &diagnostics) const {
+    mkdir(dir, 0777);  // may already exist
+    // Several compilers may share the cache, so write private files and
+    // atomically move them in place, the warnings first.
+    cstring suffix = "." + Util::toString(getpid());
+    cstring tmpWarnings = warningsFile() + suffix;
+    {
+        std::ofstream out(tmpWarnings);
+        out << diagnostics.warnings() << std::endl << diagnostics.output();
+        if (!out) {
+            ::warning(ErrorType::WARN_FAILED, "Cannot write front-end cache entry %1%",
+                      tmpWarnings);
+            std::remove(tmpWarnings);
+            return; }
+    }
+    cstring tmp = entryFile() + suffix;
+    {
+        std::ofstream out(tmp);
+        if (!out) {
+            ::warning(ErrorType::WARN_FAILED, "Cannot write front-end cache entry %1%", tmp);
+            std::remove(tmpWarnings);
+            return; }
+        BinaryGenerator(out, true).emit(result);
+    }
+    if (std::rename(tmpWarnings, warningsFile()) != 0 ||
+        std::rename(tmp, entryFile()) != 0) {
+        std::remove(tmpWarnings);
+        std::remove(tmp); }
+}
+
+}  // namespace P4
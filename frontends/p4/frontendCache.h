@@ -0,0 +1,91 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _FRONTENDS_P4_FRONTENDCACHE_H_
+#define _FRONTENDS_P4_FRONTENDCACHE_H_
+
+#include <iostream>
+#include <string>
+
+#include "ir/ir.h"
+#include "../common/options.h"
+
+namespace P4 {
+
+/**
+ * An on-disk cache of front-end results, enabled with --frontend-cache.
+ *
+ * Entries are keyed by a hash of the IR produced by the parser (serialized as
+ * JSON, including source positions and which nodes are shared), combined with
+ * the compiler version and the options that influence the front-end.  An entry
+ * holds the front-end output in the binary IR format written by --toBinary,
+ * which is mapped into memory and read much faster than JSON.
+ *
+ * The front-end inlines, specializes and renames across declarations, so an
+ * entry is only reused for an identical program.  As source positions are part
+ * of the key, that means a byte-identical one in practice: any edit, even to
+ * whitespace or comments, runs the whole front-end again.  Warnings issued by the front-end are stored
+ * with the entry and reported again when it is reused, but the front-end debug
+ * hooks do not run then.  Entries are only created for error-free compilations.
+ */
+class FrontEndCache {
+    cstring             dir;
+    cstring             key;
+
+    cstring entryFile() const;
+    cstring warningsFile() const;
+
+ public:
+    FrontEndCache(const CompilerOptions &options, const IR::P4Program *program,
+                  bool skipSideEffectOrdering);
+
+    /// Copies the diagnostics reported while it exists, so that they can be
+    /// stored with the entry.
+    class Recorder {
+        class TeeBuffer : public std::streambuf {
+            std::ostream        &out;
+            std::string         &copy;
+            int overflow(int ch) override;
+            std::streamsize xsputn(const char *s, std::streamsize n) override;
+            int sync() override;
+         public:
+            TeeBuffer(std::ostream &out, std::string &copy) : out(out), copy(copy) {}
+        };
+        std::ostream            *saved;
+        unsigned                initialWarnings;
+        std::string             text;
+        TeeBuffer               buffer;
+        std::ostream            tee;
+     public:
+        Recorder();
+        ~Recorder();
+        const std::string &output() const { return text; }
+        unsigned warnings() const;
+    };
+
+    /// @return the cached front-end output for the program, or nullptr.  The
+    /// warnings stored with the entry are reported again.
+    const IR::P4Program *load(const CompilerOptions &options) const;
+    /// Save the front-end output for the program and the warnings reported
+    /// while computing it.
+    void store(const IR::P4Program *result, const Recorder &diagnostics) const;
+    /// @return true if the cache can be used with these options
+    static bool enabled(const CompilerOptions &options);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_P4_FRONTENDCACHE_H_ */
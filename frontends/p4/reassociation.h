@@ -27,6 +27,9 @@ namespace P4 {
 class Reassociation final : public Transform {
  public:
     Reassociation() { visitDagOnce = true; setName("Reassociation"); }
+    bool rerun_is_noop() const override { return true; }
+    bool rerun_needed_for(const IR::Node *n) const override {
+        return n->is<IR::Operation_Binary>(); }
     using Transform::postorder;
 
     const IR::Node* reassociate(IR::Operation_Binary* root);
@@ -108,6 +108,11 @@ class StrengthReduction : public PassManager {
             passes.push_back(typeChecking); }
         passes.push_back(new DoStrengthReduction());
     }
+    bool rerun_is_noop() const override { return true; }
+    // TypeChecking may update expressions whose types come from new types or declarations
+    bool rerun_needed_for(const IR::Node *n) const override {
+        return n->is<IR::Expression>() ||
+               ((n->is<IR::Type>() || n->is<IR::IDeclaration>()) && !isGroupingNode(n)); }
 };
 
 }  // namespace P4
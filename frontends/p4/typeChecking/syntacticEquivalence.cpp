@@ -46,6 +46,10 @@ bool SameExpression::sameExpressions(const IR::Vector<IR::Argument>* left,
 
 bool SameExpression::sameExpression(const IR::Expression* left, const IR::Expression* right) const {
     CHECK_NULL(left); CHECK_NULL(right);
+    // shared (e.g. hash-consed) expressions; structural hashes cannot be used to reject
+    // the others, as paths are compared by declaration and types through the TypeMap
+    if (left == right)
+        return true;
     if (left->node_type_name() != right->node_type_name())
         return false;
     if (left->is<IR::Operation_Unary>()) {
@@ -152,6 +152,9 @@ Visitor::profile_t TypeInference::init_apply(const IR::Node* node) {
     }
     initialNode = node;
     refMap->validateMap(node);
+    if (auto program = node->to<IR::P4Program>())
+        if (!typeMap->checkMap(program))
+            typeMap->beginUpdate(program, refMap);
     return Transform::init_apply(node);
 }
 
@@ -161,6 +164,7 @@ void TypeInference::end_apply(const IR::Node* node) {
             "should not infer new types anymore, but it did.");
     }
     typeMap->updateMap(node);
+    typeMap->endUpdate();
     if (node->is<IR::P4Program>())
         LOG3("Typemap: " << std::endl << typeMap);
 }
@@ -610,6 +614,12 @@ const IR::Node* TypeInference::preorder(IR::P4Program* program) {
     if (typeMap->checkMap(getOriginal()) && readOnly) {
         LOG2("No need to typecheck");
         prune();
+    } else if (typeMap->isUpdating()) {
+        // The types of the other objects are still in the map.
+        for (auto &object : program->objects)
+            if (typeMap->needsTypeInference(object))
+                visit(object, "objects");
+        prune();
     }
     return program;
 }
@@ -30,7 +30,8 @@ limitations under the License.
 namespace P4 {
 
 // This pass only clears the typeMap if the program has changed
-// or the 'force' flag is set.
+// or the 'force' flag is set.  An incremental typeMap is updated
+// instead when the program has changed.
 // This is needed if the types of some objects in the program change.
 class ClearTypeMap : public Inspector {
     TypeMap* typeMap;
@@ -44,7 +45,7 @@ class ClearTypeMap : public Inspector {
         // because the program is saved only *after* typechecking,
         // so if the program changes during type-checking, the
         // typeMap may not be complete.
-        if (force || !typeMap->checkMap(program))
+        if (force || (!typeMap->checkMap(program) && !typeMap->isIncremental()))
             typeMap->clear();
         return false;  // prune()
     }
@@ -15,6 +15,11 @@ limitations under the License.
 */
 
 #include "typeMap.h"
+
+#include <set>
+#include <vector>
+
+#include "ir/pass_profile.h"
 #include "lib/map.h"
 
 namespace P4 {
@@ -95,7 +100,76 @@ void TypeMap::cloneExpressionProperties(const IR::Expression* to,
 void TypeMap::clear() {
     LOG3("Clearing typeMap");
     typeMap.clear(); leftValues.clear(); constants.clear(); allTypeVariables.clear();
+    owners.clear();
     program = nullptr;
+    endUpdate();
+}
+
+bool TypeMap::beginUpdate(const IR::P4Program* newProgram, const ReferenceMap* refMap) {
+    endUpdate();
+    if (!incremental)
+        return false;
+    std::vector<size_t> changed;
+    if (!changedObjects(program, newProgram, changed)) {
+        // ClearTypeMap relies on the update, so start again.
+        if (program != nullptr)
+            clear();
+        return false; }
+    std::set<const IR::Node*> modified;
+    for (auto i : changed)
+        modified.insert(newProgram->objects.at(i));
+    // Types flow along references, so the types in objects which refer to
+    // changed objects, directly or not, may be stale too.
+    auto stale = refMap->dependents(newProgram, modified, true);
+    for (size_t i = 0; i < newProgram->objects.size(); ++i) {
+        auto object = newProgram->objects.at(i);
+        if (!stale.count(object))
+            continue;
+        // Nodes also in objects which are kept keep their types; those are not
+        // stale, or these objects would not be kept.
+        forAllMatching<IR::Node>(program->objects.at(i), [this](const IR::Node* node) {
+            auto count = owners.find(node);
+            if (count != owners.end() && --count->second > 0)
+                return;
+            if (count != owners.end())
+                owners.erase(count);
+            forget(node); });
+        if (object != program->objects.at(i))
+            forAllMatching<IR::Node>(object, [this](const IR::Node* node) {
+                if (!owners.count(node))
+                    forget(node); });
+        toInfer.insert(object);
+        toInferAt.push_back(i); }
+    LOG2("Inferring types for " << toInfer.size() << " of " << newProgram->objects.size() <<
+         " objects");
+    updating = true;
+    return true;
+}
+
+void TypeMap::forget(const IR::Node* node) {
+    typeMap.erase(node);
+    if (auto expression = node->to<IR::Expression>()) {
+        leftValues.erase(expression);
+        constants.erase(expression); }
+}
+
+void TypeMap::countOwners(const IR::Node* object) {
+    forAllMatching<IR::Node>(object, [this](const IR::Node* node) { ++owners[node]; });
+}
+
+void TypeMap::updateMap(const IR::Node* node) {
+    auto newProgram = node ? node->to<IR::P4Program>() : nullptr;
+    if (incremental && newProgram != nullptr && newProgram != program) {
+        if (updating) {
+            // The objects which are kept are still counted; type inference
+            // may have replaced the others.
+            for (auto i : toInferAt)
+                countOwners(newProgram->objects.at(i));
+        } else {
+            owners.clear();
+            for (auto object : newProgram->objects)
+                countOwners(object); } }
+    ProgramMap::updateMap(node);
 }
 
 void TypeMap::checkPrecondition(const IR::Node* element, const IR::Type* type) const {
@@ -363,24 +437,64 @@ bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to)
     return false;
 }
 
+namespace {
+
+/// A hash of @p type which is the same for all types equivalent to it in
+/// strict mode; see TypeMap::equivalent.  Parts of types which are
+/// expensive to hash are left out.
+size_t equivalenceHash(const IR::Type* type) {
+    if (type == nullptr)
+        return 0;
+    size_t hash = std::hash<cstring>()(type->node_type_name());
+    if (auto tb = type->to<IR::Type_Bits>())
+        return IR::hash_combine(hash, tb->size * 2 + tb->isSigned);
+    if (auto tt = type->to<IR::Type_Type>())
+        return IR::hash_combine(hash, equivalenceHash(tt->type));
+    if (auto ts = type->to<IR::Type_Stack>()) {
+        hash = IR::hash_combine(hash, equivalenceHash(ts->elementType));
+        return ts->sizeKnown() ? IR::hash_combine(hash, ts->getSize()) : hash; }
+    if (auto te = type->to<IR::Type_Enum>())
+        return IR::hash_combine(hash, std::hash<cstring>()(te->name.name));
+    if (auto te = type->to<IR::Type_SerEnum>())
+        return IR::hash_combine(hash, std::hash<cstring>()(te->name.name));
+    if (auto ts = type->to<IR::Type_StructLike>()) {
+        if (!ts->is<IR::Type_UnknownStruct>())
+            hash = IR::hash_combine(hash, std::hash<cstring>()(ts->name.name));
+        for (auto f : ts->fields) {
+            hash = IR::hash_combine(hash, std::hash<cstring>()(f->name.name));
+            hash = IR::hash_combine(hash, equivalenceHash(f->type)); }
+        return hash; }
+    if (auto tt = type->to<IR::Type_BaseList>()) {
+        for (auto c : tt->components)
+            hash = IR::hash_combine(hash, equivalenceHash(c));
+        return hash; }
+    if (auto ts = type->to<IR::Type_Set>())
+        return IR::hash_combine(hash, equivalenceHash(ts->elementType));
+    if (auto ts = type->to<IR::Type_SpecializedCanonical>()) {
+        hash = IR::hash_combine(hash, equivalenceHash(ts->baseType));
+        for (auto a : *ts->arguments)
+            hash = IR::hash_combine(hash, equivalenceHash(a));
+        return hash; }
+    return hash;
+}
+
+}  // namespace
+
 // Used for tuples, stacks and lists only
 const IR::Type* TypeMap::getCanonical(const IR::Type* type) {
-    // Currently a linear search; hopefully this won't be too expensive in practice
-    std::vector<const IR::Type*>* searchIn;
-    if (type->is<IR::Type_Stack>())
-        searchIn = &canonicalStacks;
-    else if (type->is<IR::Type_Tuple>())
-        searchIn = &canonicalTuples;
-    else if (type->is<IR::Type_List>())
-        searchIn = &canonicalLists;
-    else
+    if (!type->is<IR::Type_Stack>() && !type->is<IR::Type_Tuple>() &&
+        !type->is<IR::Type_List>())
         BUG("%1%: unexpected type", type);
 
-    for (auto t : *searchIn) {
-        if (equivalent(type, t, true))
-            return t;
-    }
-    searchIn->push_back(type);
+    size_t hash = equivalenceHash(type);
+    auto range = canonicalTypes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        PassProfile::annotate("canonical type comparisons", 1);
+        if (equivalent(type, it->second, true)) {
+            PassProfile::annotate("canonical type hits", 1);
+            return it->second; } }
+    PassProfile::annotate("canonical type misses", 1);
+    canonicalTypes.emplace(hash, type);
     return type;
 }
 
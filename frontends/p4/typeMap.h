@@ -17,8 +17,15 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_TYPEMAP_H_
 #define _FRONTENDS_P4_TYPEMAP_H_
 
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "ir/ir.h"
+#include "lib/flat_ordered_map.h"
+#include "lib/flat_ordered_set.h"
 #include "frontends/common/programMap.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeChecking/typeSubstitution.h"
 
 namespace P4 {
@@ -41,22 +48,36 @@ class TypeMap final : public ProgramMap {
  protected:
     // We want to have the same canonical type for two
     // different tuples, lists, or stacks with the same signature.
-    std::vector<const IR::Type*> canonicalTuples;
-    std::vector<const IR::Type*> canonicalStacks;
-    std::vector<const IR::Type*> canonicalLists;
+    // Indexed by a hash which is the same for equivalent types.
+    std::unordered_multimap<size_t, const IR::Type*> canonicalTypes;
 
     // Map each node to its canonical type
-    ordered_map<const IR::Node*, const IR::Type*> typeMap;
+    flat_ordered_map<const IR::Node*, const IR::Type*> typeMap;
     // All left-values in the program.
-    ordered_set<const IR::Expression*> leftValues;
+    flat_ordered_set<const IR::Expression*> leftValues;
     // All compile-time constants.  A compile-time constant
     // is not necessarily a constant - it could be a directionless
     // parameter as well.
-    ordered_set<const IR::Expression*> constants;
+    flat_ordered_set<const IR::Expression*> constants;
     // For each type variable in the program the actual
     // type that is substituted for it.
     TypeVariableSubstitution allTypeVariables;
 
+    // During an incremental update, the top-level objects of the new program
+    // whose types must be inferred.
+    std::unordered_set<const IR::Node*> toInfer;
+    // ... and their positions.
+    std::vector<size_t> toInferAt;
+    bool updating = false;
+    // For an incremental map, the number of top-level objects of the program
+    // each node is part of.  Nodes may be shared by several objects, such as
+    // the Type_Bits returned by Type_Bits::get, and only lose their types
+    // with the last of them.
+    std::unordered_map<const IR::Node*, unsigned> owners;
+    void countOwners(const IR::Node* object);
+    // Removes the types of @p node.
+    void forget(const IR::Node* node);
+
     // checks some preconditions before setting the type
     void checkPrecondition(const IR::Node* element, const IR::Type* type) const;
 
@@ -74,6 +95,23 @@ class TypeMap final : public ProgramMap {
     const IR::Type* getTypeType(const IR::Node* element, bool notNull) const;
     void dbprint(std::ostream& out) const;
     void clear();
+
+    /// Prepares to update the map for @p program, whose references are resolved in
+    /// @p refMap, if the map is incremental and the top-level objects of @p program
+    /// correspond to those of the program of the map.  The types of the objects which
+    /// changed, and of the objects referring to them directly or not, are removed.
+    /// @returns false if the map must be recomputed instead; an incremental map is
+    /// then cleared.
+    bool beginUpdate(const IR::P4Program* program, const ReferenceMap* refMap);
+    void endUpdate() { updating = false; toInfer.clear(); toInferAt.clear(); }
+    bool isUpdating() const { return updating; }
+    /// Records that the map now holds the types of @p node, the program
+    /// given to beginUpdate or a program whose types were all inferred.
+    void updateMap(const IR::Node* node);
+    /// @returns true unless the map is being updated and the types of top-level
+    /// @p object are known.
+    bool needsTypeInference(const IR::Node* object) const {
+        return !updating || toInfer.count(object) != 0; }
     bool isLeftValue(const IR::Expression* expression) const
     { return leftValues.count(expression) > 0; }
     bool isCompileTimeConstant(const IR::Expression* expression) const;
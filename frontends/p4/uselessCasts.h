@@ -42,6 +42,11 @@ class UselessCasts : public PassManager {
         passes.push_back(new RemoveUselessCasts(typeMap));
         setName("UselessCasts");
     }
+    bool rerun_is_noop() const override { return true; }
+    // a cast is useless depending on its type and the type of its operand
+    bool rerun_needed_for(const IR::Node *n) const override {
+        return n->is<IR::Cast>() ||
+               ((n->is<IR::Type>() || n->is<IR::IDeclaration>()) && !isGroupingNode(n)); }
 };
 
 }  // namespace P4
@@ -1,9 +1,16 @@
 #include "parserDriver.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
 #include <sstream>
+#include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/format.hpp>
@@ -69,6 +76,97 @@ struct AutoStdioInputStream {
 
 namespace P4 {
 
+namespace {
+
+/// @return the flag of a preprocessor line marker (1 when entering a file,
+/// 2 when returning to one, 0 if there is no flag), or -1 if @line is not a
+/// line marker
+int lineMarkerFlag(const std::string& line) {
+    if (line.size() < 3 || line[0] != '#' || line[1] != ' ' || !isdigit(line[2]))
+        return -1;
+    auto quote = line.rfind('"');
+    if (quote == std::string::npos) return 0;
+    return atoi(line.c_str() + quote + 1);
+}
+
+/**
+ * Find the headers the preprocessed @text of a program starts with: the text
+ * is split before the line marker returning to the main file from the last of
+ * the leading includes, provided only line markers and blank lines come
+ * between them.  @key receives the text of the headers, without the lines
+ * belonging to the main file (as they contain its name).
+ *
+ * @returns where the rest of the program starts, or 0 if it does not start
+ * with headers.
+ */
+size_t headerPrefix(const std::string& text, std::string& key) {
+    size_t pos = 0, split = 0, keySize = 0;
+    int depth = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        size_t next = eol == std::string::npos ? text.size() : eol + 1;
+        std::string line = text.substr(pos, next - pos);
+        int flag = lineMarkerFlag(line);
+        if (depth == 0 && flag < 0 && line.find_first_not_of(" \t\r\n") != std::string::npos)
+            break;
+        if (flag == 1) {
+            ++depth;
+        } else if (flag == 2 && depth > 0 && --depth == 0) {
+            split = pos;
+            keySize = key.size(); }
+        if (depth > 0) key += line;
+        pos = next; }
+    key.resize(keySize);
+    return split;
+}
+
+/**
+ * The text of a program read from a FILE*, as a single buffer which the lexer
+ * reads through a stream, and which @sources refers to instead of holding a copy
+ * of each line.  A regular file is mapped into memory, and stays mapped for the
+ * rest of the compilation since the source positions of the program refer to it;
+ * other input (e.g., the output of the preprocessor) is read into a string kept
+ * by @sources.
+ */
+class InputBuffer : private std::streambuf {
+    std::istream stream;
+
+ public:
+    InputBuffer(FILE* in, Util::InputSources* sources) : stream(this) {
+        struct stat st;
+        if (fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+            ftell(in) == 0) {
+            void* text = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+            if (text != MAP_FAILED)
+                sources->useBuffer(static_cast<const char*>(text), st.st_size); }
+        if (!sources->getBuffer()) {
+            std::string text;
+            char chunk[65536];
+            while (size_t size = fread(chunk, 1, sizeof(chunk), in))
+                text.append(chunk, size);
+            sources->useBuffer(std::move(text)); }
+        auto text = sources->getBuffer();
+        char* begin = const_cast<char*>(text.p);
+        setg(begin, begin, begin + text.len);
+    }
+
+    std::istream& get() { return stream; }
+};
+
+/// The state of a parser after it has parsed some headers.
+struct PreloadedHeaders {
+    std::string         key;  // see headerPrefix
+    P4ParserDriver*     driver;
+    bool                used;
+};
+
+std::vector<PreloadedHeaders>& preloaded() {
+    static std::vector<PreloadedHeaders> headers;
+    return headers;
+}
+
+}  // namespace
+
 AbstractParserDriver::AbstractParserDriver()
     : sources(new Util::InputSources) { }
 
@@ -150,19 +248,61 @@ P4ParserDriver::parse(AbstractP4Lexer& lexer, const char* sourceFile,
 /* static */ const IR::P4Program*
 P4ParserDriver::parse(std::istream& in, const char* sourceFile,
                       unsigned sourceLine /* = 1 */) {
+    std::istringstream text;
+    std::istream* input = &in;
+    if (!preloaded().empty()) {
+        std::string program{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        std::string key;
+        size_t split = headerPrefix(program, key);
+        for (auto& headers : preloaded()) {
+            if (headers.used || headers.key != key) continue;
+            LOG1("Parsing P4-16 program " << sourceFile << " after preloaded headers");
+            headers.used = true;
+            text.str(program.substr(split));
+            P4Lexer lexer(text);
+            auto& driver = *headers.driver;
+            if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
+            return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes); }
+        text.str(program);
+        input = &text; }
+
     LOG1("Parsing P4-16 program " << sourceFile);
 
     P4ParserDriver driver;
-    P4Lexer lexer(in);
+    P4Lexer lexer(*input);
     if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
     return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
 }
 
+/* static */ bool
+P4ParserDriver::preloadHeaders(const std::string& text, const char* sourceFile) {
+    std::string key;
+    size_t split = headerPrefix(text, key);
+    if (split == 0) return false;
+    LOG1("Preloading headers of " << sourceFile);
+    auto* driver = new P4ParserDriver;
+    std::istringstream headers(text.substr(0, split));
+    P4Lexer lexer(headers);
+    if (!driver->parse(lexer, sourceFile)) return false;
+    preloaded().push_back({key, driver, false});
+    return true;
+}
+
 /* static */ const IR::P4Program*
 P4ParserDriver::parse(FILE* in, const char* sourceFile,
                       unsigned sourceLine /* = 1 */) {
-    AutoStdioInputStream inputStream(in);
-    return parse(inputStream.get(), sourceFile, sourceLine);
+    if (!preloaded().empty()) {
+        // The text has to be split after the preloaded headers.
+        AutoStdioInputStream inputStream(in);
+        return parse(inputStream.get(), sourceFile, sourceLine); }
+
+    LOG1("Parsing P4-16 program " << sourceFile);
+
+    P4ParserDriver driver;
+    InputBuffer input(in, driver.sources);
+    P4Lexer lexer(input.get());
+    if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
+    return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
 }
 
 template<typename T> const T*
@@ -116,6 +116,20 @@ class P4ParserDriver final : public AbstractParserDriver {
     static const IR::P4Program* parse(FILE* in, const char* sourceFile,
                                       unsigned sourceLine = 1);
 
+    /**
+     * Parse the preprocessed text of a program which only includes headers
+     * (e.g. core.p4 and an architecture) and keep the state of the parser.
+     * A later parse() of a program whose preprocessed text starts with the
+     * same headers then only parses the rest of the program.
+     *
+     * The state is not copied, so it can only be resumed once per process;
+     * the compiler server (frontends/common/compilerServer.h) preloads
+     * headers and forks a process for each compilation.
+     *
+     * @returns false if @text could not be parsed.
+     */
+    static bool preloadHeaders(const std::string& text, const char* sourceFile);
+
     /**
      * Parses a P4-16 annotation body.
      *
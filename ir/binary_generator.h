@@ -0,0 +1,261 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _IR_BINARY_GENERATOR_H_
+#define _IR_BINARY_GENERATOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "lib/bitvec.h"
+#include "lib/cstring.h"
+#include "lib/ltbitmatrix.h"
+#include "lib/match.h"
+#include "lib/ordered_map.h"
+#include "lib/ordered_set.h"
+#include "lib/safe_vector.h"
+
+#include "ir.h"
+
+/* The binary IR format, written by BinaryGenerator and read by BinaryLoader.
+ *
+ * It holds the same information as the JSON format, without the field names:
+ * the toBinary methods and BinaryLoader constructors generated from the .def
+ * files write and read the fields of each class in declaration order.
+ *
+ *   file    := magic version flags strings value
+ *   strings := count (length bytes)*     -- each distinct string once
+ *   node    := NullNode | NodeReference id | NodeRecord type fields [source-info]
+ *
+ * Integers are LEB128 varints (zigzag encoded if signed), and strings are
+ * indices into the string table, with 0 standing for the null cstring.  */
+namespace BinaryIR {
+static const char magic[8] = { 'P', '4', 'I', 'R', 'B', 'I', 'N', '\0' };
+static const unsigned version = 1;
+
+enum Flags { HasSourceInfo = 1 };
+enum NodeTag { NullNode = 0, NodeReference = 1, NodeRecord = 2 };
+}  // namespace BinaryIR
+
+class BinaryGenerator {
+    std::ostream &out;
+    bool dumpSourceInfo;
+    std::string body;
+    std::unordered_map<cstring, uint64_t> stringIndex;
+    std::vector<cstring> strings;
+    std::unordered_set<int> node_refs;
+
+    template<typename T>
+    class has_toBinary {
+        typedef char small;
+        typedef struct { char c[2]; } big;
+
+        template<typename C> static small test(decltype(&C::toBinary));
+        template<typename C> static big test(...);
+     public:
+        static const bool value = sizeof(test<T>(0)) == sizeof(char);
+    };
+
+    void put(std::string &buf, uint64_t v) {
+        while (v >= 0x80) {
+            buf.push_back(static_cast<char>(v | 0x80));
+            v >>= 7; }
+        buf.push_back(static_cast<char>(v)); }
+
+ public:
+    explicit BinaryGenerator(std::ostream &out, bool dumpSourceInfo = false) :
+        out(out), dumpSourceInfo(dumpSourceInfo) {}
+
+    /// Writes @p root and all the nodes reachable from it as a binary IR file.
+    void emit(const IR::Node *root) {
+        generate(root);
+        std::string header(BinaryIR::magic, sizeof(BinaryIR::magic));
+        put(header, BinaryIR::version);
+        put(header, dumpSourceInfo ? BinaryIR::HasSourceInfo : 0);
+        put(header, strings.size());
+        for (auto s : strings) {
+            put(header, s.size());
+            header.append(s.c_str(), s.size()); }
+        out.write(header.data(), header.size());
+        out.write(body.data(), body.size());
+        body.clear(); }
+
+    void putUnsigned(uint64_t v) { put(body, v); }
+    void putSigned(int64_t v) {
+        putUnsigned((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+    void putBytes(const std::string &v) {
+        putUnsigned(v.size());
+        body.append(v); }
+
+    template<typename T>
+    void generate(const safe_vector<T> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename T>
+    void generate(const std::vector<T> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename T, typename U>
+    void generate(const std::pair<T, U> &v) {
+        generate(v.first);
+        generate(v.second); }
+
+    template<typename T>
+    void generate(const boost::optional<T> &v) {
+        generate(static_cast<bool>(v));
+        if (v) generate(*v); }
+
+    template<typename T>
+    void generate(const std::set<T> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename T>
+    void generate(const ordered_set<T> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename K, typename V>
+    void generate(const std::map<K, V> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename K, typename V>
+    void generate(const std::multimap<K, V> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    template<typename K, typename V>
+    void generate(const ordered_map<K, V> &v) {
+        putUnsigned(v.size());
+        for (auto &el : v) generate(el); }
+
+    void generate(bool v) { body.push_back(v ? 1 : 0); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    generate(T v) { putSigned(v); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+    generate(T v) { putUnsigned(v); }
+    template<typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    generate(T v) { putSigned(static_cast<int64_t>(v)); }
+    void generate(double v) {
+        char bytes[sizeof(v)];
+        memcpy(bytes, &v, sizeof(v));
+        body.append(bytes, sizeof(v)); }
+    template<typename T>
+    typename std::enable_if<std::is_same<T, big_int>::value>::type
+    generate(const T &v) {
+        // Most constants fit in 64 bits; the others are written in decimal.
+        static const big_int min = std::numeric_limits<int64_t>::min();
+        static const big_int max = std::numeric_limits<int64_t>::max();
+        bool small = v >= min && v <= max;
+        generate(small);
+        if (small)
+            putSigned(static_cast<int64_t>(v));
+        else
+            putBytes(v.str()); }
+
+    void generate(cstring v) {
+        if (!v) {
+            putUnsigned(0);
+            return; }
+        auto it = stringIndex.emplace(v, strings.size() + 1);
+        if (it.second)
+            strings.push_back(v);
+        putUnsigned(it.first->second); }
+    void generate(const IR::ID &v) {
+        generate(v.name);
+        generate(v.originalName); }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<T, LTBitMatrix>::value ||
+                            std::is_same<T, bitvec>::value>::type
+    generate(const T &v) {
+        std::stringstream text;
+        text << v;
+        putBytes(text.str()); }
+
+    void generate(const match_t &v) {
+        putUnsigned(v.word0);
+        putUnsigned(v.word1); }
+
+    void generate(const UnparsedConstant *v) {
+        generate(v != nullptr);
+        if (!v) return;
+        generate(v->text);
+        generate(v->skip);
+        generate(v->base);
+        generate(v->hasWidth); }
+
+    template<typename T>
+    typename std::enable_if<
+                    has_toBinary<T>::value &&
+                    !std::is_base_of<IR::INode, T>::value>::type
+    generate(const T &v) { v.toBinary(*this); }
+
+    template<typename T>
+    typename std::enable_if<
+                    has_toBinary<T>::value &&
+                    !std::is_base_of<IR::INode, T>::value>::type
+    generate(const T *v) {
+        generate(v != nullptr);
+        if (v) v->toBinary(*this); }
+
+    void generate(const IR::Node &v) {
+        if (node_refs.count(v.id)) {
+            putUnsigned(BinaryIR::NodeReference);
+            putSigned(v.id);
+            return; }
+        node_refs.insert(v.id);
+        putUnsigned(BinaryIR::NodeRecord);
+        generate(v.node_type_name());
+        v.toBinary(*this);
+        if (dumpSourceInfo)
+            v.sourceInfoToBinary(*this); }
+
+    template<typename T>
+    typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    generate(const T *v) {
+        if (v)
+            generate(*v->getNode());
+        else
+            putUnsigned(BinaryIR::NullNode); }
+
+    template<typename T, size_t N>
+    void generate(const T (&v)[N]) {
+        for (size_t i = 0; i < N; i++)
+            generate(v[i]); }
+
+    template<typename T> BinaryGenerator &operator<<(const T &v) { generate(v); return *this; }
+};
+
+#endif /* _IR_BINARY_GENERATOR_H_ */
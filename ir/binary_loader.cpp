@@ -0,0 +1,125 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ir/binary_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/map.h"
+
+BinaryLoader::BinaryLoader(const char *data, size_t size)
+: name("binary IR"), data(data), size(size) {
+    readHeader();
+}
+
+BinaryLoader::BinaryLoader(cstring filename) : name(filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+        } else {
+            data = static_cast<const char *>(mapping);
+            size = st.st_size; } }
+    close(fd);
+    readHeader();
+}
+
+BinaryLoader::~BinaryLoader() {
+    // The loaded IR does not point into the file: strings are copied when interned.
+    if (mapping)
+        munmap(mapping, size);
+}
+
+void BinaryLoader::readHeader() {
+    if (!isBinaryIR(data, size))
+        return;
+    pos = sizeof(BinaryIR::magic);
+    try {
+        if (getUnsigned() != BinaryIR::version)
+            return;
+        sourceInfo = getUnsigned() & BinaryIR::HasSourceInfo;
+        auto count = getUnsigned();
+        // Every string takes at least one byte.
+        if (count > size - pos)
+            return;
+        strings.reserve(count);
+        for (; count > 0; --count) {
+            size_t length = getUnsigned();
+            if (length > size - pos)
+                return;
+            strings.emplace_back(pos, length);
+            pos += length; }
+    } catch (Util::CompilationError &) {
+        // A truncated header; valid() returns false.
+        return; }
+    interned.resize(strings.size());
+    ok = true;
+}
+
+void BinaryLoader::corrupt() const {
+    FATAL_ERROR("%1%: corrupt binary IR at offset %2%", name, pos);
+}
+
+void BinaryLoader::unpack(cstring &v) {
+    auto index = getUnsigned();
+    if (index == 0) {
+        v = cstring();
+        return; }
+    if (index > strings.size())
+        corrupt();
+    auto &s = interned[index - 1];
+    if (s.isNull())
+        s = cstring(data + strings[index - 1].first, strings[index - 1].second);
+    v = s;
+}
+
+const IR::Node *BinaryLoader::get_node(BinaryNodeFactoryFn factory) {
+    switch (getUnsigned()) {
+        case BinaryIR::NullNode:
+            return nullptr;
+        case BinaryIR::NodeReference: {
+            auto it = node_refs.find(getSigned());
+            if (it == node_refs.end())
+                corrupt();
+            return it->second; }
+        case BinaryIR::NodeRecord: {
+            cstring type;
+            unpack(type);
+            if (auto fn = get(IR::binary_unpacker_table, type))
+                factory = fn;
+            if (!factory)
+                FATAL_ERROR("%1%: unknown IR node type %2%", name, type);
+            IR::Node *node = factory(*this);
+            if (sourceInfo && getByte()) {
+                cstring filename, fragment;
+                int line, column;
+                unpack(filename);
+                unpack(line);
+                unpack(column);
+                unpack(fragment);
+                node->srcInfo = Util::SourceInfo(filename, line, column, fragment); }
+            node_refs[node->id] = node;
+            return node; }
+        default:
+            corrupt(); }
+}
@@ -0,0 +1,314 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _IR_BINARY_LOADER_H_
+#define _IR_BINARY_LOADER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "lib/bitvec.h"
+#include "lib/cstring.h"
+#include "lib/exceptions.h"
+#include "lib/ltbitmatrix.h"
+#include "lib/match.h"
+#include "lib/ordered_map.h"
+#include "lib/ordered_set.h"
+#include "lib/safe_vector.h"
+#include "ir.h"
+#include "binary_generator.h"
+
+/// Reads IR written by BinaryGenerator; see binary_generator.h for the format.
+/// A file is mapped into memory rather than read, and its strings are only
+/// interned as cstrings when a node which uses them is created.
+class BinaryLoader {
+    template<typename T> class has_fromBinary {
+        typedef char small;
+        typedef struct { char c[2]; } big;
+
+        template<typename C> static small test(decltype(&C::fromBinary));
+        template<typename C> static big test(...);
+     public:
+        static const bool value = sizeof(test<T>(0)) == sizeof(char);
+    };
+
+    cstring             name;
+    const char          *data = nullptr;
+    size_t              size = 0;
+    size_t              pos = 0;
+    void                *mapping = nullptr;
+    bool                sourceInfo = false;
+    bool                ok = false;
+
+    /// The strings of the string table, as (offset, length) pairs, and the
+    /// cstrings already made from them.
+    std::vector<std::pair<size_t, size_t>>      strings;
+    std::vector<cstring>                        interned;
+
+    std::unordered_map<int, IR::Node *>         node_refs;
+
+    void readHeader();
+    [[noreturn]] void corrupt() const;
+    uint8_t getByte() {
+        if (pos >= size) corrupt();
+        return data[pos++]; }
+
+ public:
+    uint64_t getUnsigned() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = getByte();
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v; }
+        corrupt(); }
+    int64_t getSigned() {
+        uint64_t v = getUnsigned();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+    std::string getBytes() {
+        size_t length = getUnsigned();
+        if (length > size - pos) corrupt();
+        pos += length;
+        return std::string(data + pos - length, length); }
+
+ private:
+    /// Reads a node, which is created with @p factory if its type is not in
+    /// IR::binary_unpacker_table (as for the Vector classes).
+    const IR::Node *get_node(BinaryNodeFactoryFn factory);
+
+    template<typename T> static BinaryNodeFactoryFn factory(std::true_type) {
+        return [](BinaryLoader &binary) -> IR::Node * { return T::fromBinary(binary); }; }
+    template<typename T> static BinaryNodeFactoryFn factory(std::false_type) { return nullptr; }
+    template<typename T> const IR::Node *get_node() {
+        return get_node(factory<T>(std::integral_constant<bool, has_fromBinary<T>::value>())); }
+
+    template<typename T>
+    void unpack(safe_vector<T> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            T temp;
+            unpack(temp);
+            v.push_back(temp); } }
+
+    template<typename T>
+    void unpack(std::vector<T> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            T temp;
+            unpack(temp);
+            v.push_back(temp); } }
+
+    template<typename T>
+    void unpack(std::set<T> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            T temp;
+            unpack(temp);
+            v.insert(temp); } }
+
+    template<typename T>
+    void unpack(ordered_set<T> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            T temp;
+            unpack(temp);
+            v.insert(temp); } }
+
+    template<typename K, typename V>
+    void unpack(std::map<K, V> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            std::pair<K, V> temp;
+            unpack(temp);
+            v.insert(temp); } }
+
+    template<typename K, typename V>
+    void unpack(std::multimap<K, V> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            std::pair<K, V> temp;
+            unpack(temp);
+            v.insert(temp); } }
+
+    template<typename K, typename V>
+    void unpack(ordered_map<K, V> &v) {
+        for (auto count = getUnsigned(); count > 0; --count) {
+            std::pair<K, V> temp;
+            unpack(temp);
+            v.insert(temp); } }
+
+    template<typename T, typename U>
+    void unpack(std::pair<T, U> &v) {
+        unpack(v.first);
+        unpack(v.second); }
+
+    template<typename T>
+    void unpack(boost::optional<T> &v) {
+        bool isValid = false;
+        unpack(isValid);
+        if (!isValid) {
+            v = boost::none;
+            return; }
+        T value;
+        unpack(value);
+        v = std::move(value); }
+
+    void unpack(bool &v) { v = getByte() != 0; }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    unpack(T &v) { v = getSigned(); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+    unpack(T &v) { v = getUnsigned(); }
+    template<typename T> typename std::enable_if<std::is_enum<T>::value>::type
+    unpack(T &v) { v = static_cast<T>(getSigned()); }
+    void unpack(double &v) {
+        if (sizeof(v) > size - pos) corrupt();
+        memcpy(&v, data + pos, sizeof(v));
+        pos += sizeof(v); }
+    void unpack(big_int &v) {
+        bool small = false;
+        unpack(small);
+        if (small)
+            v = static_cast<int64_t>(getSigned());
+        else
+            v = big_int(getBytes()); }
+
+    void unpack(cstring &v);
+    void unpack(IR::ID &v) {
+        unpack(v.name);
+        unpack(v.originalName); }
+
+    void unpack(LTBitMatrix &m) { getBytes().c_str() >> m; }
+    void unpack(bitvec &v) { getBytes().c_str() >> v; }
+    void unpack(match_t &v) {
+        unpack(v.word0);
+        unpack(v.word1); }
+
+    void unpack(UnparsedConstant *&v) {
+        bool present = false;
+        unpack(present);
+        if (!present) {
+            v = nullptr;
+            return; }
+        v = new UnparsedConstant{cstring(), 0, 0, false};
+        unpack(v->text);
+        unpack(v->skip);
+        unpack(v->base);
+        unpack(v->hasWidth); }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T *&v) {
+        bool present = false;
+        unpack(present);
+        v = present ? T::fromBinary(*this) : nullptr; }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T &v) { v = *(T::fromBinary(*this)); }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        !std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T &v) { v = T::fromBinary(*this); }
+
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack(T &v) {
+        const IR::Node *node = get_node<T>();
+        BUG_CHECK(node && node->is<T>(), "%1%: expected a %2%", name, T::static_type_name());
+        v = *node->to<T>(); }
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack(const T *&v) {
+        const IR::Node *node = get_node<T>();
+        v = node ? node->to<T>() : nullptr; }
+
+    template<typename T, size_t N>
+    void unpack(T (&v)[N]) {
+        for (size_t i = 0; i < N; ++i)
+            unpack(v[i]); }
+
+ public:
+    /// Reads binary IR from the @p size bytes at @p data, which must stay
+    /// valid while the IR is loaded.
+    BinaryLoader(const char *data, size_t size);
+    /// Maps file @p filename into memory to read the binary IR it contains.
+    explicit BinaryLoader(cstring filename);
+    BinaryLoader(const BinaryLoader &) = delete;
+    ~BinaryLoader();
+
+    /// @returns false if the input could not be read or is not binary IR.
+    bool valid() const { return ok; }
+    /// @returns true if @p data starts like binary IR.
+    static bool isBinaryIR(const char *data, size_t size) {
+        return size >= sizeof(BinaryIR::magic) &&
+               memcmp(data, BinaryIR::magic, sizeof(BinaryIR::magic)) == 0; }
+
+    /// Reads the next value; the IR must be read in the order it was written.
+    template<typename T>
+    void load(T &v) { unpack(v); }
+
+    template<typename T> BinaryLoader& operator>>(T &v) {
+        if (!ok) corrupt();
+        unpack(v);
+        return *this; }
+};
+
+template<class T>
+IR::Vector<T>::Vector(BinaryLoader &binary) : VectorBase(binary) {
+    binary.load(vec.modify());
+}
+template<class T>
+IR::Vector<T>* IR::Vector<T>::fromBinary(BinaryLoader &binary) {
+    return new Vector<T>(binary);
+}
+template<class T>
+IR::IndexedVector<T>::IndexedVector(BinaryLoader &binary) : Vector<T>(binary) {
+    // The declarations are not written, as they can be found again.
+    for (auto el : *this) insertInMap(el);
+}
+template<class T>
+IR::IndexedVector<T>* IR::IndexedVector<T>::fromBinary(BinaryLoader &binary) {
+    return new IndexedVector<T>(binary);
+}
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+IR::NameMap<T, MAP, COMP, ALLOC>::NameMap(BinaryLoader &binary) : Node(binary) {
+    binary.load(symbols);
+}
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+IR::NameMap<T, MAP, COMP, ALLOC> *IR::NameMap<T, MAP, COMP, ALLOC>::fromBinary(
+        BinaryLoader &binary) {
+    return new IR::NameMap<T, MAP, COMP, ALLOC>(binary);
+}
+
+#endif /* _IR_BINARY_LOADER_H_ */
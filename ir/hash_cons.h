@@ -0,0 +1,96 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _IR_HASH_CONS_H_
+#define _IR_HASH_CONS_H_
+
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+#include <unordered_map>
+#include <utility>
+
+#include "node.h"
+
+namespace IR {
+
+/**
+ * Hash-consing factory for immutable nodes (typically expressions such as
+ * Constants and Members that passes create over and over): all the nodes
+ * obtained from one HashCons which are equiv are the same object.  Since equiv
+ * ignores source positions, the shared node keeps the position of the first
+ * one created, so this is meant for compiler-generated nodes.  The nodes are
+ * shared, so they must not be modified, and the IR built from them is a DAG.
+ * A HashCons may be used from several threads.
+ */
+class HashCons {
+    std::unordered_multimap<size_t, const Node *> table;
+    size_t      hits = 0;
+#ifdef MULTITHREAD
+    mutable std::mutex lock;
+#endif  // MULTITHREAD
+
+ public:
+    /// @return a node equiv to @n which was interned before, or @n itself
+    const Node *intern(const Node *n) {
+        size_t h = n->structuralHash();
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        auto range = table.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == n || it->second->equiv(*n)) {
+                ++hits;
+                return it->second; } }
+        table.emplace(h, n);
+        return n; }
+    template<class T> const T *intern(const T *n) {
+        return static_cast<const T *>(intern(static_cast<const Node *>(n))); }
+
+    /// Create a T from @args, unless an equiv node was already created; only
+    /// new nodes are allocated
+    template<class T, class... Args> const T *get(Args&&... args) {
+        T tmp(std::forward<Args>(args)...);
+        size_t h = tmp.structuralHash();
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        auto range = table.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second->equiv(tmp)) {
+                ++hits;
+                return static_cast<const T *>(it->second); } }
+        auto *rv = tmp.clone();
+        rv->structuralHash();  // so that later lookups can reject it without comparing
+        table.emplace(h, rv);
+        return rv; }
+
+    size_t size() const {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        return table.size(); }
+    /// number of requests answered with an existing node
+    size_t hitCount() const {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        return hits; }
+};
+
+}  // namespace IR
+
+#endif /* _IR_HASH_CONS_H_ */
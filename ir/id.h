@@ -50,5 +50,7 @@ struct ID : Util::IHasSourceInfo {
     cstring toString() const override { return originalName.isNullOrEmpty() ? name : originalName; }
 };
 
+inline size_t hashValue(const ID &id) { return std::hash<cstring>()(id.name); }
+
 }  // namespace IR
 #endif  // _IR_ID_H_
@@ -28,16 +28,18 @@ limitations under the License.
 #include "declaration.h"
 
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
 /**
  * A Vector which holds objects which are instances of IDeclaration, and keeps
- * an index so that they can be quickly looked up by name.
+ * an index so that they can be quickly looked up by name.  Like the elements,
+ * the index is shared with copies until one of them is changed.
  */
 template<class T>
 class IndexedVector : public Vector<T> {
-    ordered_map<cstring, const IDeclaration*> declarations;
+    copy_on_write<ordered_map<cstring, const IDeclaration*>> declarations;
     bool invalid = false;  // set when an error occurs; then we don't
                            // expect the validity check to succeed.
 
@@ -46,13 +48,13 @@ class IndexedVector : public Vector<T> {
             return;
         auto decl = a->template to<IDeclaration>();
         auto name = decl->getName().name;
-        auto previous = declarations.find(name);
-        if (previous != declarations.end()) {
+        auto previous = declarations->find(name);
+        if (previous != declarations->end()) {
             invalid = true;
             ::error(ErrorType::ERR_DUPLICATE,
                     "%1%: Duplicates declaration %2%", a, previous->second);
         } else {
-            declarations[name] = decl; }}
+            declarations.modify()[name] = decl; }}
     void removeFromMap(const T* a) {
         if (a == nullptr)
             return;
@@ -60,10 +62,9 @@ class IndexedVector : public Vector<T> {
         if (decl == nullptr)
             return;
         cstring name = decl->getName().name;
-        auto it = declarations.find(name);
-        if (it == declarations.end())
+        if (declarations->find(name) == declarations->end())
             BUG("%1% does not exist", a);
-        declarations.erase(it); }
+        declarations.modify().erase(name); }
 
  public:
     using Vector<T>::begin;
@@ -83,27 +84,28 @@ class IndexedVector : public Vector<T> {
     explicit IndexedVector(const Vector<T> &a) {
         insert(typename Vector<T>::end(), a.begin(), a.end()); }
     explicit IndexedVector(JSONLoader &json);
+    explicit IndexedVector(BinaryLoader &binary);
 
-    void clear() { IR::Vector<T>::clear(); declarations.clear(); }
+    void clear() { IR::Vector<T>::clear(); declarations = decltype(declarations)(); }
     // TODO: Although this is not a const_iterator, it should NOT
     // be used to modify the vector directly.  I don't know
     // how to enforce this property, though.
     typedef typename Vector<T>::iterator iterator;
 
     const IDeclaration* getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end())
+        auto it = declarations->find(name);
+        if (it == declarations->end())
             return nullptr;
         return it->second; }
     template <class U>
     const U* getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end())
+        auto it = declarations->find(name);
+        if (it == declarations->end())
             return nullptr;
         return it->second->template to<U>(); }
     Util::Enumerator<const IDeclaration*>* getDeclarations() const {
         return Util::Enumerator<const IDeclaration*>::createEnumerator(
-            Values(declarations).begin(), Values(declarations).end()); }
+            Values(*declarations).begin(), Values(*declarations).end()); }
     iterator erase(iterator i) {
         removeFromMap(*i);
         return Vector<T>::erase(i); }
@@ -179,13 +181,15 @@ class IndexedVector : public Vector<T> {
 
     void toJSON(JSONGenerator &json) const override;
     static IndexedVector<T>* fromJSON(JSONLoader &json);
+    void toBinary(BinaryGenerator &binary) const override;
+    static IndexedVector<T>* fromBinary(BinaryLoader &binary);
     void validate() const override {
         if (invalid) return;  // don't crash the compiler because an error happened
         for (auto el : *this) {
             auto decl = el->template to<IR::IDeclaration>();
             if (!decl) continue;
-            auto it = declarations.find(decl->getName());
-            BUG_CHECK(it != declarations.end() && it->second->getNode() == el->getNode(),
+            auto it = declarations->find(decl->getName());
+            BUG_CHECK(it != declarations->end() && it->second->getNode() == el->getNode(),
                       "invalid element %1%", el); }
     }
 };
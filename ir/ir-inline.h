@@ -45,79 +45,59 @@ limitations under the License.
 
 IRNODE_ALL_TEMPLATES(DEFINE_APPLY_FUNCTIONS, inline)
 
-template<class T> void IR::Vector<T>::visit_children(Visitor &v) {
-    for (auto i = vec.begin(); i != vec.end();) {
-        auto n = v.apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
-            i++;
-        } else if (auto l = dynamic_cast<const Vector *>(n)) {
-            i = erase(i);
-            i = insert(i, l->vec.begin(), l->vec.end());
-            i += l->vec.size();
-        } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
-            if (v->empty()) {
-                i = erase(i);
-            } else {
-                i = insert(i, v->size() - 1, nullptr);
-                for (auto el : *v) {
-                    if (auto e = dynamic_cast<const T *>(el))
-                        *i++ = e;
-                    else
-                        BUG("visitor returned invalid type %s for Vector<%s>",
-                            el->node_type_name(), T::static_type_name()); } }
-        } else if (auto e = dynamic_cast<const T *>(n)) {
-            *i++ = e;
+// The children are read through const references, so that the elements stay
+// shared with the node this one was cloned from until a child is changed.
+template<class T> size_t IR::Vector<T>::replaceChild(size_t i, const Node *n) {
+    const T *el = (*vec)[i];
+    if (!n && el) {
+        erase(begin() + i);
+    } else if (n == el) {
+        i++;
+    } else if (auto l = dynamic_cast<const Vector *>(n)) {
+        insert(erase(begin() + i), l->begin(), l->end());
+        i += l->size();
+    } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
+        if (v->empty()) {
+            erase(begin() + i);
         } else {
-            BUG("visitor returned invalid type %s for Vector<%s>",
-                n->node_type_name(), T::static_type_name());
-        }
+            auto it = insert(begin() + i, v->size() - 1, nullptr);
+            for (auto el : *v) {
+                if (auto e = dynamic_cast<const T *>(el))
+                    *it++ = e;
+                else
+                    BUG("visitor returned invalid type %s for Vector<%s>",
+                        el->node_type_name(), T::static_type_name()); }
+            i += v->size(); }
+    } else if (auto e = dynamic_cast<const T *>(n)) {
+        (*this)[i++] = e;
+    } else {
+        BUG("visitor returned invalid type %s for Vector<%s>",
+            n->node_type_name(), T::static_type_name());
     }
+    return i;
+}
+template<class T> void IR::Vector<T>::visit_children(Visitor &v) {
+    for (size_t i = 0; i < size();)
+        i = replaceChild(i, v.apply_visitor((*vec)[i]));
 }
 template<class T> void IR::Vector<T>::visit_children(Visitor &v) const {
-    for (auto &a : vec) v.visit(a); }
+    for (auto &a : *vec) v.visit(a); }
 template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) {
     Visitor *start = nullptr, *tmp = &v;
-    size_t todo = vec.size();
+    size_t todo = size();
     if (todo > 1) start = &v.flow_clone();
-    for (auto i = vec.begin(); i != vec.end(); --todo, tmp = nullptr) {
+    for (size_t i = 0; i < size(); --todo, tmp = nullptr) {
         if (!tmp)
             tmp = todo > 1 ? &start->flow_clone() : start;
-        auto n = tmp->apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
-            i++;
-        } else if (auto l = dynamic_cast<const Vector *>(n)) {
-            i = erase(i);
-            i = insert(i, l->vec.begin(), l->vec.end());
-            i += l->vec.size();
-        } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
-            if (v->empty()) {
-                i = erase(i);
-            } else {
-                i = insert(i, v->size() - 1, nullptr);
-                for (auto el : *v) {
-                    if (auto e = dynamic_cast<const T *>(el))
-                        *i++ = e;
-                    else
-                        BUG("visitor returned invalid type %s for Vector<%s>",
-                            el->node_type_name(), T::static_type_name()); } }
-        } else if (auto e = dynamic_cast<const T *>(n)) {
-            *i++ = e;
-        } else {
-            BUG("visitor returned invalid type %s for Vector<%s>",
-                n->node_type_name(), T::static_type_name());
-        }
+        i = replaceChild(i, tmp->apply_visitor((*vec)[i]));
         if (tmp != &v)
             v.flow_merge(*tmp); }
 }
 template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) const {
     Visitor *start = nullptr, *tmp = &v;
-    size_t todo = vec.size();
+    size_t todo = vec->size();
     if (todo > 1) start = &v.flow_clone();
-    for (auto &a : vec) {
+    for (auto &a : *vec) {
         if (!tmp)
             tmp = todo > 1 ? &start->flow_clone() : start;
         tmp->visit(a);
@@ -131,29 +111,34 @@ template<class T> void IR::Vector<T>::toJSON(JSONGenerator &json) const {
     const char *sep = "";
     Node::toJSON(json);
     json << "," << std::endl << json.indent++ << "\"vec\" : [";
-    for (auto &k : vec) {
+    for (auto &k : *vec) {
         json << sep << std::endl << json.indent << k;
         sep = ","; }
     --json.indent;
     if (*sep) json << std::endl << json.indent;
     json << "]";
 }
+template<class T> void IR::Vector<T>::toBinary(BinaryGenerator &binary) const {
+    Node::toBinary(binary);
+    binary << *vec;
+}
 
 std::ostream &operator<<(std::ostream &out, const IR::Vector<IR::Expression> &v);
 
 template<class T> void IR::IndexedVector<T>::visit_children(Visitor &v) {
-    for (auto i = begin(); i != end();) {
-        auto n = v.apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
+    const Vector<T> &elements = *this;
+    for (size_t i = 0; i < elements.size();) {
+        const T *el = elements[i];
+        auto n = v.apply_visitor(el);
+        if (!n && el) {
+            erase(begin() + i);
+        } else if (n == el) {
             i++;
         } else if (auto l = dynamic_cast<const Vector<T> *>(n)) {
-            i = erase(i);
-            i = insert(i, l->begin(), l->end());
+            insert(erase(begin() + i), l->begin(), l->end());
             i += l->Vector<T>::size();
         } else if (auto e = dynamic_cast<const T *>(n)) {
-            i = replace(i, e);
+            replace(begin() + i++, e);
         } else {
             BUG("visitor returned invalid type %s for IndexedVector<%s>",
                 n->node_type_name(), T::static_type_name());
@@ -167,13 +152,18 @@ void IR::IndexedVector<T>::toJSON(JSONGenerator &json) const {
     const char *sep = "";
     Vector<T>::toJSON(json);
     json << "," << std::endl << json.indent++ << "\"declarations\" : {";
-    for (auto &k : declarations) {
+    for (auto &k : *declarations) {
         json << sep << std::endl << json.indent << k.first << " : " << k.second;
         sep = ","; }
     --json.indent;
     if (*sep) json << std::endl << json.indent;
     json << "}";
 }
+template<class T>
+void IR::IndexedVector<T>::toBinary(BinaryGenerator &binary) const {
+    // The declarations are found again from the elements when loading.
+    Vector<T>::toBinary(binary);
+}
 IRNODE_DEFINE_APPLY_OVERLOAD(IndexedVector, template<class T>, <T>)
 
 #include "lib/ordered_map.h"
@@ -247,6 +237,13 @@ void IR::NameMap<T, MAP, COMP, ALLOC>::toJSON(JSONGenerator &json) const {
     if (*sep) json << std::endl << json.indent;
     json << "}";
 }
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+void IR::NameMap<T, MAP, COMP, ALLOC>::toBinary(BinaryGenerator &binary) const {
+    Node::toBinary(binary);
+    binary << symbols;
+}
 
 template<class KEY, class VALUE,
          template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
@@ -296,7 +296,7 @@ class JSONLoader {
 
 template<class T>
 IR::Vector<T>::Vector(JSONLoader &json) : VectorBase(json) {
-    json.load("vec", vec);
+    json.load("vec", vec.modify());
 }
 template<class T>
 IR::Vector<T>* IR::Vector<T>::fromJSON(JSONLoader &json) {
@@ -304,7 +304,7 @@ IR::Vector<T>* IR::Vector<T>::fromJSON(JSONLoader &json) {
 }
 template<class T>
 IR::IndexedVector<T>::IndexedVector(JSONLoader &json) : Vector<T>(json) {
-    json.load("declarations", declarations);
+    json.load("declarations", declarations.modify());
 }
 template<class T>
 IR::IndexedVector<T>* IR::IndexedVector<T>::fromJSON(JSONLoader &json) {
@@ -18,6 +18,7 @@ limitations under the License.
 #define _IR_NAMEMAP_H_
 
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
@@ -39,6 +40,7 @@ class NameMap : public Node {
     NameMap(const NameMap &) = default;
     NameMap(NameMap &&) = default;
     explicit NameMap(JSONLoader &);
+    explicit NameMap(BinaryLoader &);
     NameMap &operator=(const NameMap &) = default;
     NameMap &operator=(NameMap &&) = default;
     typedef typename map_t::value_type          value_type;
@@ -117,6 +119,7 @@ class NameMap : public Node {
     bool equiv(const Node &a_) const override {
         if (static_cast<const Node *>(this) == &a_) return true;
         if (typeid(*this) != typeid(a_)) return false;
+        if (hashMismatch(a_)) return false;
         auto &a = static_cast<const NameMap<T, MAP, COMP, ALLOC> &>(a_);
         if (size() != a.size()) return false;
         auto it = a.begin();
@@ -124,6 +127,12 @@ class NameMap : public Node {
             if (el.first != it->first || !el.second->equiv(*(it++)->second))
                 return false;
         return true; }
+    size_t computeStructuralHash() const override {
+        size_t h = Node::computeStructuralHash();
+        for (auto &el : *this)
+            h = hash_combine(hash_combine(h, hashValue(el.first)),
+                             el.second->structuralHash());
+        return h; }
     cstring node_type_name() const override {
         return "NameMap<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -132,6 +141,8 @@ class NameMap : public Node {
     void visit_children(Visitor &v) const override;
     void toJSON(JSONGenerator &json) const override;
     static NameMap<T, MAP, COMP, ALLOC> *fromJSON(JSONLoader &json);
+    void toBinary(BinaryGenerator &binary) const override;
+    static NameMap<T, MAP, COMP, ALLOC> *fromBinary(BinaryLoader &binary);
 
     Util::Enumerator<const T*>* valueEnumerator() const {
         return Util::Enumerator<const T*>::createEnumerator(Values(symbols).begin(),
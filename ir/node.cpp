@@ -18,6 +18,7 @@ limitations under the License.
 // #include <signal.h>
 
 #include "ir.h"
+#include "ir/binary_loader.h"
 #include "ir/json_loader.h"
 
 #include "node.h"
@@ -35,7 +36,13 @@ void IR::Node::traceCreation() const {
     LOG5("Created node " << id);
 }
 
-int IR::Node::currentId = 0;
+std::atomic<int> IR::Node::currentId{0};
+
+// Make sure that ids allocated after loading a node with id @id are larger.
+static void bumpCurrentId(std::atomic<int> &currentId, int id) {
+    int current = currentId.load();
+    while (id >= current && !currentId.compare_exchange_weak(current, id + 1)) {}
+}
 
 void IR::Node::toJSON(JSONGenerator &json) const {
     json << json.indent << "\"Node_ID\" : " << id << "," << std::endl
@@ -46,8 +53,21 @@ IR::Node::Node(JSONLoader &json) : id(-1) {
     json.load("Node_ID", id);
     if (id < 0)
         id = currentId++;
-    else if (id >= currentId)
-        currentId = id+1;
+    else
+        bumpCurrentId(currentId, id);
+    clone_id = id;
+}
+
+void IR::Node::toBinary(BinaryGenerator &binary) const {
+    binary << id;
+}
+
+IR::Node::Node(BinaryLoader &binary) : id(-1) {
+    binary.load(id);
+    if (id < 0)
+        id = currentId++;
+    else
+        bumpCurrentId(currentId, id);
     clone_id = id;
 }
 
@@ -152,4 +172,19 @@ void IR::Node::sourceInfoToJSON(JSONGenerator &json) const {
     json << --json.indent << "}";
 }
 
+void IR::Node::sourceInfoToBinary(BinaryGenerator &binary) const {
+    Util::SourceInfo si = srcInfo;
+    unsigned lineNumber, columnNumber;
+    cstring fName = prepareSourceInfoForJSON(si, &lineNumber, &columnNumber);
+    if (fName != nullptr) {
+        binary << true << fName << static_cast<int>(lineNumber)
+               << static_cast<int>(columnNumber) << si.toBriefSourceFragment();
+    } else if (srcInfo.line != -1) {
+        // Same reasoning as in sourceInfoJsonObj.
+        binary << true << srcInfo.filename << srcInfo.line << srcInfo.column
+               << srcInfo.srcBrief;
+    } else {
+        binary << false; }
+}
+
 IRNODE_DEFINE_APPLY_OVERLOAD(Node, , )
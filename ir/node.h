@@ -17,8 +17,12 @@ limitations under the License.
 #ifndef _IR_NODE_H_
 #define _IR_NODE_H_
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include "lib/arena.h"
 #include "lib/cstring.h"
+#include "lib/gmputil.h"
 #include "lib/stringify.h"
 #include "lib/indent.h"
 #include "lib/source_file.h"
@@ -34,12 +38,32 @@ class Modifier;
 class Transform;
 class JSONGenerator;
 class JSONLoader;
+class BinaryGenerator;
+class BinaryLoader;
 
 namespace IR {
 
 class Node;
 class Annotation;
 
+/// Combine hash @v into @seed (as boost::hash_combine does)
+inline size_t hash_combine(size_t seed, size_t v) {
+    return seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)); }
+
+namespace Detail {
+template<class T> auto hashValue(const T &v, int) -> decltype(std::hash<T>()(v)) {
+    return std::hash<T>()(v); }
+// values with no std::hash do not contribute to the structural hash; this is
+// consistent with equiv, just less precise
+template<class T> size_t hashValue(const T &, long) { return 0; }
+}  // namespace Detail
+
+/// Hash of a non-IR field of a node, used by the generated computeStructuralHash
+template<class T> size_t hashValue(const T &v) { return Detail::hashValue(v, 0); }
+inline size_t hashValue(const big_int &v) {
+    uint64_t low = static_cast<uint64_t>((v < 0 ? big_int(-v) : v) & ~uint64_t(0));
+    return hash_combine(std::hash<uint64_t>()(low), v < 0); }
+
 template<class T> class Vector;
 template<class T> class IndexedVector;
 // node interface
@@ -51,6 +75,7 @@ class INode : public Util::IHasSourceInfo, public IHasDbPrint, public ICastable
     virtual void dbprint(std::ostream &out) const = 0;  // for debugging
     virtual cstring toString() const = 0;  // for user consumption
     virtual void toJSON(JSONGenerator &) const = 0;
+    virtual void toBinary(BinaryGenerator &) const = 0;
     virtual cstring node_type_name() const = 0;
     virtual void validate() const {}
     virtual const Annotation *getAnnotation(cstring) const { return nullptr; }
@@ -80,11 +105,18 @@ class Node : public virtual INode {
     virtual const Node *apply_visitor_postorder(Transform &v);
     virtual void apply_visitor_revisit(Transform &v, const Node *n) const;
     virtual void apply_visitor_loop_revisit(Transform &v) const;
-    Node &operator=(const Node &) = default;
-    Node &operator=(Node &&) = default;
+    Node &operator=(const Node &a) {
+        srcInfo = a.srcInfo;
+        id = a.id;
+        clone_id = a.clone_id;
+        hashCache = a.hashCache.load(std::memory_order_relaxed);
+        return *this; }
+    Node &operator=(Node &&a) { return *this = a; }
 
  protected:
-    static int currentId;
+    // atomic, as nodes may be created concurrently (see ParallelForEachDeclaration)
+    static std::atomic<int> currentId;
+    mutable std::atomic<size_t> hashCache{0};  // 0 until structuralHash is computed
     void traceVisit(const char* visitor) const;
     virtual void visit_children(Visitor &) { }
     virtual void visit_children(Visitor &) const { }
@@ -106,7 +138,19 @@ class Node : public virtual INode {
         traceCreation(); }
     Node(const Node& other) : srcInfo(other.srcInfo), id(currentId++), clone_id(other.clone_id) {
         traceCreation(); }
+    /// The id the next node will get: nodes created before this call have
+    /// lower ids (other than ones loaded from JSON or binary with their id).
+    static int nextId() { return currentId; }
     virtual ~Node() {}
+    /* nodes are allocated in the current arena of the thread, if any (see Util::Arena) */
+    static void *operator new(size_t size) {
+        if (auto *arena = Util::Arena::current()) return arena->allocate(size);
+        return ::operator new(size); }
+    static void *operator new(size_t, void *place) { return place; }
+    static void operator delete(void *p) {
+        if (Util::Arena::owner(p)) return;  // freed when the arena is released
+        ::operator delete(p); }
+    static void operator delete(void *, void *) {}
     const Node *apply(Visitor &v, const Visitor_Context *ctxt = nullptr) const;
     const Node *apply(Visitor &&v, const Visitor_Context *ctxt = nullptr) const {
         return apply(v, ctxt); }
@@ -120,9 +164,12 @@ class Node : public virtual INode {
     static cstring static_type_name() { return "Node"; }
     virtual int num_children() { return 0; }
     explicit Node(JSONLoader &json);
+    explicit Node(BinaryLoader &binary);
     cstring toString() const override { return node_type_name(); }
     void toJSON(JSONGenerator &json) const override;
     void sourceInfoToJSON(JSONGenerator &json) const;
+    void toBinary(BinaryGenerator &binary) const override;
+    void sourceInfoToBinary(BinaryGenerator &binary) const;
     Util::JsonObject* sourceInfoJsonObj() const;
     /* operator== does a 'shallow' comparison, comparing two Node subclass objects for equality,
      * and comparing pointers in the Node directly for equality */
@@ -130,6 +177,28 @@ class Node : public virtual INode {
     /* 'equiv' does a deep-equals comparison, comparing all non-pointer fields and recursing
      * though all Node subclass pointers to compare them with 'equiv' as well. */
     virtual bool equiv(const Node &a) const { return typeid(*this) == typeid(a); }
+    /* 'structuralHash' is a deep hash consistent with 'equiv': nodes which are equiv have
+     * the same hash.  It is computed (by computeStructuralHash) the first time it is needed
+     * and cached in the node.  Nodes in the IR tree are immutable, so a node must not be
+     * modified in place once it (or a node containing it) has been hashed: clone() returns
+     * an unhashed copy, and visitors drop the cached value of the clones they modify.
+     * Several threads may hash the same node; they all compute the same value and the
+     * first one stored is kept. */
+    size_t structuralHash() const {
+        size_t h = hashCache.load(std::memory_order_acquire);
+        if (!h) {
+            size_t unset = 0;
+            h = computeStructuralHash() | 1;
+            if (!hashCache.compare_exchange_strong(unset, h, std::memory_order_acq_rel))
+                h = unset; }
+        return h; }
+    virtual size_t computeStructuralHash() const { return typeid(*this).hash_code(); }
+    /// true if both nodes have already been hashed and so are known not to be equiv;
+    /// lets 'equiv' reject different nodes in constant time without hashing them
+    bool hashMismatch(const Node &a) const {
+        size_t h = hashCache.load(std::memory_order_relaxed);
+        size_t ah = a.hashCache.load(std::memory_order_relaxed);
+        return h && ah && h != ah; }
 #define DEFINE_OPEQ_FUNC(CLASS, BASE) \
     virtual bool operator==(const CLASS &) const { return false; }
     IRNODE_ALL_SUBCLASSES(DEFINE_OPEQ_FUNC)
@@ -149,6 +218,10 @@ inline bool equiv(const Node *a, const Node *b) {
     return a == b || (a && b && a->equiv(*b)); }
 inline bool equiv(const INode *a, const INode *b) {
     return a == b || (a && b && a->getNode()->equiv(*b->getNode())); }
+/// 'equiv', hashing both nodes first: for nodes which are compared repeatedly, different
+/// nodes are then rejected in constant time
+inline bool equivHashed(const Node *a, const Node *b) {
+    return a == b || (a && b && a->structuralHash() == b->structuralHash() && a->equiv(*b)); }
 
 /* common things that ALL Node subclasses must define */
 #define IRNODE_SUBCLASS(T)                                              \
@@ -75,6 +75,7 @@ class NodeMap : public Node {
     bool equiv(const Node &a_) const override {
         if (static_cast<const Node *>(this) == &a_) return true;
         if (typeid(*this) != typeid(a_)) return false;
+        if (hashMismatch(a_)) return false;
         auto &a = static_cast<const NodeMap<KEY, VALUE, MAP, COMP, ALLOC> &>(a_);
         if (size() != a.size()) return false;
         auto it = a.begin();
@@ -82,6 +83,12 @@ class NodeMap : public Node {
             if (el.first != it->first || !el.second->equiv(*(it++)->second))
                 return false;
         return true; }
+    size_t computeStructuralHash() const override {
+        size_t h = Node::computeStructuralHash();
+        for (auto &el : *this)
+            h = hash_combine(hash_combine(h, hashValue(el.first)),
+                             el.second->structuralHash());
+        return h; }
     cstring node_type_name() const override {
         return "NodeMap<" + KEY::static_type_name() + "," + VALUE::static_type_name() + ">"; }
     static cstring static_type_name() {
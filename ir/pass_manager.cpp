@@ -14,11 +14,18 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <exception>
+#ifdef MULTITHREAD
+#include <atomic>
+#include <thread>
+#endif  // MULTITHREAD
+
 #include "ir.h"
 #include "lib/gc.h"
 #include "lib/n4.h"
 
 #include "pass_manager.h"
+#include "pass_profile.h"
 
 void PassManager::removePasses(const std::vector<cstring> &exclude) {
     for (auto it : exclude) {
@@ -44,6 +51,43 @@ void PassManager::listPasses(std::ostream &out, cstring sep) const {
         first = false; }
 }
 
+bool isGroupingNode(const IR::Node *n) {
+    return n->is<IR::P4Program>() || n->is<IR::P4Control>() || n->is<IR::P4Parser>() ||
+           n->is<IR::ParserState>() || n->is<IR::P4Action>() || n->is<IR::BlockStatement>() ||
+           n->is<IR::VectorBase>();
+}
+
+/// Looks for a node created since @nextId that needs @pass to run again.  A node
+/// is not changed once it is in a program, so a node created earlier only has
+/// children created earlier, and those are not visited.
+class FindRerunNeeded : public Inspector {
+    const Visitor   &pass;
+    int             nextId;
+
+ public:
+    bool            needed = false;
+    FindRerunNeeded(const Visitor &pass, int nextId) : pass(pass), nextId(nextId) {}
+    bool preorder(const IR::Node *n) override {
+        if (needed || n->id < nextId) return false;
+        needed = pass.rerun_needed_for(n);
+        return !needed; }
+};
+
+// This assumes passes only put nodes created earlier back into a program if
+// they are still in it, so those are all in the program @v left unchanged.
+bool PassManager::rerunNeeded(const Visitor *v, const IR::Node *program) const {
+    auto unchanged = leftUnchanged.find(v);
+    if (unchanged == leftUnchanged.end() || !v->rerun_is_noop())
+        return true;
+    if (program == unchanged->second.program)
+        return false;
+    if (program->id < unchanged->second.nextId)
+        return true;  // an older program, e.g. after backtracking
+    FindRerunNeeded find(*v, unchanged->second.nextId);
+    program->apply(find);
+    return find.needed;
+}
+
 const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *) {
     safe_vector<std::pair<safe_vector<Visitor *>::iterator, const IR::Node *>> backup;
     static indent_t log_indent(-1);
@@ -58,6 +102,16 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
     BUG_CHECK(running, "not calling apply properly");
     for (auto it = passes.begin(); it != passes.end();) {
         Visitor* v = *it;
+        if (skipUnchanged && !rerunNeeded(v, program)) {
+            LOG1(log_indent << name() << " skipping " << v->name() <<
+                 ", which has nothing new to do");
+            // as if it ran and left this program unchanged
+            leftUnchanged[v] = { program, IR::Node::nextId() };
+            PassProfile::annotate("skipped", 1);
+            runDebugHooks(v->name(), program);
+            seqNo++;
+            it++;
+            continue; }
         if (auto b = dynamic_cast<Backtrack *>(v)) {
             if (!b->never_backtracks()) {
                 backup.emplace_back(it, program); } }
@@ -71,6 +125,11 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
                          n4(mem) << "B, max " << n4(maxmem) << "B"); }
                 if (stop_on_error && ::errorCount() > initial_error_count)
                     break;
+                if (skipUnchanged) {
+                    if (after == program)
+                        leftUnchanged[v] = { program, IR::Node::nextId() };
+                    else
+                        leftUnchanged.erase(v); }
                 if ((program = after) == nullptr) break;
             } catch (Backtrack::trigger::type_t &trig_type) {
                 throw Backtrack::trigger(trig_type);
@@ -127,6 +186,9 @@ const IR::Node *PassRepeated::apply_visitor(const IR::Node *program, const char
     bool done = false;
     unsigned iterations = 0;
     unsigned initial_error_count = ::errorCount();
+    // Only skip passes within one run: other passes may change the state
+    // they depend on in between.
+    leftUnchanged.clear();
     while (!done) {
         LOG5("PassRepeated state is:\n" << dumpToString(program));
         running = true;
@@ -136,6 +198,7 @@ const IR::Node *PassRepeated::apply_visitor(const IR::Node *program, const char
         if (stop_on_error && ::errorCount() > initial_error_count)
             return program;
         iterations++;
+        PassProfile::annotate("iterations", 1);
         if (repeats != 0 && iterations > repeats)
             done = true;
         program = newprogram;
@@ -147,6 +210,7 @@ const IR::Node *PassRepeatUntil::apply_visitor(const IR::Node *program, const ch
     do {
         running = true;
         program = PassManager::apply_visitor(program, name);
+        PassProfile::annotate("iterations", 1);
     } while (!done());
     return program;
 }
@@ -158,3 +222,66 @@ const IR::Node *PassIf::apply_visitor(const IR::Node *program, const char *name)
     }
     return program;
 }
+
+const IR::Node *ParallelForEachDeclaration::apply_visitor(const IR::Node *n, const char *) {
+    auto *ctxt = getChildContext();
+    auto *program = n->to<IR::P4Program>();
+    if (!program)
+        return n->apply(*visitor, ctxt);
+
+    size_t count = program->objects.size();
+    std::vector<const IR::Node *> results(count);
+    std::vector<std::exception_ptr> failures(count);
+    auto run = [&](size_t task) {
+        Visitor::Context parent = { ctxt, program, program, static_cast<int>(task), "objects",
+                                    ctxt ? ctxt->depth + 1 : 1 };
+        try {
+            auto *v = make();
+            v->setCalledBy(this);
+            results[task] = program->objects.at(task)->apply(*v, &parent);
+        } catch (...) {
+            failures[task] = std::current_exception(); } };
+
+#ifdef MULTITHREAD
+    unsigned nthreads = threads ? threads : std::thread::hardware_concurrency();
+    if (nthreads > count) nthreads = count;
+    if (nthreads > 1) {
+        LOG2(name() << " running on " << count << " declarations with " <<
+             nthreads << " threads");
+        gc_allow_threads();
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        auto *arena = Util::Arena::current();
+        for (unsigned t = 0; t < nthreads; ++t)
+            workers.emplace_back([&] {
+                gc_register_thread();
+                Util::Arena::Scope allocateIn(arena);
+                for (size_t task; (task = next.fetch_add(1)) < count;)
+                    run(task);
+                gc_unregister_thread(); });
+        for (auto &w : workers) w.join();
+    } else {
+        for (size_t task = 0; task < count; ++task)
+            run(task); }
+#else
+    for (size_t task = 0; task < count; ++task)
+        run(task);
+#endif  // MULTITHREAD
+
+    // report the failure of the first declaration, whichever thread hit it first
+    for (auto &f : failures)
+        if (f) std::rethrow_exception(f);
+
+    bool changed = false;
+    for (size_t task = 0; task < count; ++task)
+        if (results[task] != program->objects.at(task))
+            changed = true;
+    if (!changed)
+        return program;
+
+    auto *rv = program->clone();
+    rv->objects.clear();
+    for (auto *result : results)
+        rv->objects.pushBackOrAppend(result);
+    return rv;
+}
@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _IR_PASS_MANAGER_H_
 #define _IR_PASS_MANAGER_H_
 
+#include <unordered_map>
+
 #include "visitor.h"
 
 typedef std::function<void(const char* manager, unsigned seqNo,
@@ -33,6 +35,16 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
     bool                stop_on_error = true;
     bool                running = false;
     unsigned            seqNo = 0;
+    /// If true, passes whose rerun_is_noop() is true are skipped when none of
+    /// the nodes created since they left the program unchanged, as recorded
+    /// in leftUnchanged, needs them (see Visitor::rerun_needed_for).
+    bool                skipUnchanged = false;
+    struct Unchanged {
+        const IR::Node  *program;  // the program the pass left unchanged
+        int             nextId;    // IR::Node::nextId() when it did
+    };
+    std::unordered_map<const Visitor *, Unchanged> leftUnchanged;
+    bool rerunNeeded(const Visitor *v, const IR::Node *program) const;
     void runDebugHooks(const char* visitorName, const IR::Node* node);
     profile_t init_apply(const IR::Node *root) override {
         running = true;
@@ -107,13 +119,21 @@ class OnBacktrack : virtual public Visitor, virtual public Backtrack {
             return false; } }
 };
 
+/// True for nodes that only group other nodes: programs, controls, parsers,
+/// parser states, actions, block statements and vectors.  A new one without new
+/// children only differs in which children it holds, which is no reason for
+/// most passes to run again (see Visitor::rerun_needed_for).
+bool isGroupingNode(const IR::Node *n);
+
 // Repeat a pass until convergence (or up to a fixed number of repeats)
+// Passes which declare rerun_is_noop() are not run again once they have left
+// the program unchanged, until a node they need (rerun_needed_for) is created.
 class PassRepeated : virtual public PassManager {
     unsigned            repeats;  // 0 = until convergence
  public:
-    PassRepeated() : repeats(0) {}
+    PassRepeated() : repeats(0) { skipUnchanged = true; }
     PassRepeated(const std::initializer_list<VisitorRef> &init, unsigned repeats = 0) :
-            PassManager(init), repeats(repeats) {}
+            PassManager(init), repeats(repeats) { skipUnchanged = true; }
     const IR::Node *apply_visitor(const IR::Node *, const char * = 0) override;
     PassRepeated *setRepeats(unsigned repeats) { this->repeats = repeats; return this; }
     PassRepeated *clone() const override { return new PassRepeated(*this); }
@@ -140,6 +160,30 @@ class PassIf : virtual public PassManager {
     PassIf *clone() const override { return new PassIf(*this); }
 };
 
+/// Applies a visitor separately to every top-level declaration of a P4Program,
+/// fanning the declarations out over a pool of threads when built with
+/// MULTITHREAD, and reassembles P4Program::objects in the original order, so
+/// the result does not depend on scheduling.  Each declaration is visited by a
+/// new visitor obtained from @make, with the program as the parent context (most
+/// visitors have no clone method, and their state must not be shared).  This is
+/// only correct for visitors that look inside one declaration at a time and do
+/// not modify shared state (e.g. the ReferenceMap or TypeMap); any other node is
+/// passed to the visitor as usual.
+class ParallelForEachDeclaration : public Visitor {
+    std::function<Visitor *()>  make;
+    Visitor                     *visitor;  // for any node that is not a P4Program
+    unsigned                    threads;  // 0 = use all available hardware threads
+ public:
+    explicit ParallelForEachDeclaration(std::function<Visitor *()> make, unsigned threads = 0)
+    : make(make), visitor(make()), threads(threads) { setName(visitor->name()); }
+    const IR::Node *apply_visitor(const IR::Node *, const char * = 0) override;
+    bool rerun_is_noop() const override { return visitor->rerun_is_noop(); }
+    bool rerun_needed_for(const IR::Node *n) const override {
+        return visitor->rerun_needed_for(n); }
+    ParallelForEachDeclaration *clone() const override {
+        return new ParallelForEachDeclaration(*this); }
+};
+
 // Converts a function Node* -> Node* into a visitor
 class VisitFunctor : virtual public Visitor {
     std::function<const IR::Node *(const IR::Node *)>       fn;
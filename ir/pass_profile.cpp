@@ -0,0 +1,164 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "pass_profile.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include "lib/gc.h"
+#include "ir.h"
+#include "visitor.h"
+
+thread_local PassProfile::Counters PassProfile::counters;
+cstring PassProfile::outputFile;
+
+namespace {
+
+struct Event {
+    cstring             name;
+    unsigned            tid;
+    uint64_t            start, end;  // nsec, monotonic clock
+    uint64_t            visited, cloned, allocated;
+    std::map<cstring, uint64_t> args;
+};
+
+// Events of passes that are still running on this thread, innermost last.
+// Counters are snapshots at the start of the pass until the pass ends.
+struct ThreadState {
+    unsigned            tid;
+    std::vector<Event>  open;
+    ThreadState();
+};
+
+// Events of passes that have completed, on any thread.
+std::vector<Event> &completed() {
+    static std::vector<Event> events;
+    return events;
+}
+
+#ifdef MULTITHREAD
+std::mutex &lock() {
+    static std::mutex theLock;
+    return theLock;
+}
+#endif  // MULTITHREAD
+
+unsigned thread_count = 0;
+
+ThreadState::ThreadState() {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
+    tid = ++thread_count;
+}
+
+ThreadState &state() {
+    static thread_local ThreadState state;
+    return state;
+}
+
+}  // namespace
+
+void PassProfile::enable(cstring file) {
+    if (!enabled()) {
+        // construct the event list before registering the exit handler, so that
+        // it is destroyed after the handler runs
+        completed();
+        std::atexit([]() { write(); }); }
+    outputFile = file;
+}
+
+void PassProfile::begin(const Visitor &v, uint64_t start) {
+    auto &ts = state();
+    ts.open.emplace_back();
+    auto &ev = ts.open.back();
+    ev.name = v.name();
+    ev.tid = ts.tid;
+    ev.start = start;
+    ev.visited = counters.visited;
+    ev.cloned = counters.cloned;
+    ev.allocated = gc_bytes_allocated();
+}
+
+void PassProfile::end(const Visitor &v, uint64_t end) {
+    auto &ts = state();
+    if (ts.open.empty()) return;  // enabled while the pass was running
+    auto ev = std::move(ts.open.back());
+    ts.open.pop_back();
+    ev.name = v.name();  // the visitor may have been renamed while running
+    ev.end = end;
+    ev.visited = counters.visited - ev.visited;
+    ev.cloned = counters.cloned - ev.cloned;
+    ev.allocated = gc_bytes_allocated() - ev.allocated;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
+    completed().push_back(std::move(ev));
+}
+
+void PassProfile::annotate(const char *key, uint64_t value) {
+    if (!enabled()) return;
+    auto &ts = state();
+    if (!ts.open.empty())
+        ts.open.back().args[key] += value;
+}
+
+void PassProfile::write(std::ostream &out) {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
+    uint64_t first = 0;
+    for (auto &ev : completed())
+        if (!first || ev.start < first) first = ev.start;
+    const char *sep = "";
+    // print times with nanosecond precision, never in scientific notation
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (auto &ev : completed()) {
+        // trace-event timestamps are in microseconds
+        out << sep << std::endl << "  {\"name\": \"" << ev.name.escapeJson()
+            << "\", \"cat\": \"pass\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ev.tid
+            << ", \"ts\": " << (ev.start - first) / 1000.0
+            << ", \"dur\": " << (ev.end - ev.start) / 1000.0
+            << ", \"args\": {\"nodes_visited\": " << ev.visited
+            << ", \"nodes_cloned\": " << ev.cloned
+            << ", \"bytes_allocated\": " << ev.allocated;
+        for (auto &arg : ev.args)
+            out << ", \"" << arg.first.escapeJson() << "\": " << arg.second;
+        out << "}}";
+        sep = ","; }
+    out << std::endl << "]}" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void PassProfile::write() {
+    if (!enabled()) return;
+    std::ofstream out(outputFile.c_str());
+    if (!out) {
+        std::cerr << "Could not open pass profile file " << outputFile << std::endl;
+        return; }
+    write(out);
+}
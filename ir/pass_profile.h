@@ -0,0 +1,62 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _IR_PASS_PROFILE_H_
+#define _IR_PASS_PROFILE_H_
+
+#include <cstdint>
+#include <iostream>
+
+#include "lib/cstring.h"
+
+class Visitor;
+
+/// Collects per-pass statistics (wall time, nodes visited, nodes cloned by
+/// Transforms, bytes allocated, PassRepeated iterations and any other counters
+/// passes choose to report) and writes them as a Chrome trace-event JSON file,
+/// which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+/// Profiling is off unless enabled, e.g. with the --pass-profile option.
+class PassProfile {
+ public:
+    /// Counters maintained by the visitors of the running thread.
+    struct Counters {
+        uint64_t visited = 0;  // nodes visited by any visitor
+        uint64_t cloned = 0;   // nodes cloned by Modifiers and Transforms
+    };
+    static thread_local Counters counters;
+
+    /// Start collecting events; they are written to @file when the program exits.
+    static void enable(cstring file);
+    static bool enabled() { return !outputFile.isNull(); }
+
+    /// Called by Visitor::profile_t when a visitor starts/stops running.
+    static void begin(const Visitor &v, uint64_t start);
+    static void end(const Visitor &v, uint64_t end);
+
+    /// Attach a counter to the innermost pass running on this thread.  Counters
+    /// with the same name reported several times are added up.
+    static void annotate(const char *key, uint64_t value);
+
+    /// Write the events collected so far in Chrome trace-event format.
+    static void write(std::ostream &out);
+    /// Write the events to the file given to enable(); called on exit.
+    static void write();
+
+ private:
+    static cstring outputFile;
+};
+
+#endif /* _IR_PASS_PROFILE_H_ */
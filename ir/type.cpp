@@ -15,6 +15,9 @@ limitations under the License.
 */
 
 #include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include "ir.h"
 #include "frontends/common/options.h"
 
@@ -54,8 +57,8 @@ const cstring IR::Annotation::noWarnAnnotation = "noWarn";
 const cstring IR::Annotation::matchAnnotation = "match";
 const cstring IR::Annotation::fieldListAnnotation = "field_list";
 
-int Type_Declaration::nextId = 0;
-int Type_InfInt::nextId = 0;
+std::atomic<int> Type_Declaration::nextId{0};
+std::atomic<int> Type_InfInt::nextId{0};
 
 Annotations* Annotations::empty = new Annotations(Vector<Annotation>());
 
@@ -64,12 +67,20 @@ const Type* Type_Stack::at(size_t) const { return elementType; }
 const Type_Bits* Type_Bits::get(int width, bool isSigned) {
     // map (width, signed) to type
     using bit_type_key = std::pair<int, bool>;
-    static std::map<bit_type_key, const IR::Type_Bits*> *type_map = nullptr;
-    if (type_map == nullptr)
-        type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
-    auto &result = (*type_map)[std::make_pair(width, isSigned)];
-    if (!result)
-        result = new Type_Bits(width, isSigned);
+    static auto *type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
+    const IR::Type_Bits *result;
+    {
+#ifdef MULTITHREAD
+        // types are requested concurrently by ParallelForEachDeclaration workers
+        static std::mutex lock;
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        auto &cached = (*type_map)[std::make_pair(width, isSigned)];
+        if (!cached) {
+            Util::Arena::Scope permanent(nullptr);  // shared by all compilations
+            cached = new Type_Bits(width, isSigned); }
+        result = cached;
+    }
     if (width > P4CContext::getConfig().maximumWidthSupported())
         ::error(ErrorType::ERR_UNSUPPORTED, "%1%: Compiler only supports widths up to %2%",
                 result, P4CContext::getConfig().maximumWidthSupported());
@@ -77,23 +88,25 @@ const Type_Bits* Type_Bits::get(int width, bool isSigned) {
 }
 
 const Type::Unknown *Type::Unknown::get() {
-    static const Type::Unknown *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Unknown());
+    // initialized only once, even when called concurrently (magic static);
+    // shared by all compilations
+    static const Type::Unknown *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type::Unknown(); }();
     return singleton;
 }
 
 const Type::Boolean *Type::Boolean::get() {
-    static const Type::Boolean *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Boolean());
+    static const Type::Boolean *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type::Boolean(); }();
     return singleton;
 }
 
 const Type_String *Type_String::get() {
-    static const Type_String *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type_String());
+    static const Type_String *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type_String(); }();
     return singleton;
 }
 
@@ -127,30 +140,30 @@ const Type::Varbits *Type::Varbits::get() {
 }
 
 const Type_Dontcare *Type_Dontcare::get() {
-    static const Type_Dontcare *singleton;
-    if (!singleton)
-        singleton = (new Type_Dontcare());
+    static const Type_Dontcare *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type_Dontcare(); }();
     return singleton;
 }
 
 const Type_State *Type_State::get() {
-    static const Type_State *singleton;
-    if (!singleton)
-        singleton = (new Type_State());
+    static const Type_State *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type_State(); }();
     return singleton;
 }
 
 const Type_Void *Type_Void::get() {
-    static const Type_Void *singleton;
-    if (!singleton)
-        singleton = (new Type_Void());
+    static const Type_Void *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type_Void(); }();
     return singleton;
 }
 
 const Type_MatchKind *Type_MatchKind::get() {
-    static const Type_MatchKind *singleton;
-    if (!singleton)
-        singleton = (new Type_MatchKind());
+    static const Type_MatchKind *singleton = [] {
+        Util::Arena::Scope permanent(nullptr);
+        return new Type_MatchKind(); }();
     return singleton;
 }
 
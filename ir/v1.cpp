@@ -23,9 +23,9 @@ limitations under the License.
 
 #define SINGLETON_TYPE(NAME)                                    \
 const IR::Type_##NAME *IR::Type_##NAME::get() {                 \
-    static const Type_##NAME *singleton;                        \
-    if (!singleton)                                             \
-        singleton = (new Type_##NAME(Util::SourceInfo()));      \
+    static const Type_##NAME *singleton = [] {                  \
+        Util::Arena::Scope permanent(nullptr);                  \
+        return new Type_##NAME(Util::SourceInfo()); }();        \
     return singleton;                                           \
 }
 SINGLETON_TYPE(Block)
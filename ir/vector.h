@@ -18,11 +18,13 @@ limitations under the License.
 #define _IR_VECTOR_H_
 
 #include "dbprint.h"
+#include "lib/copy_on_write.h"
 #include "lib/enumerator.h"
 #include "lib/null.h"
 #include "lib/safe_vector.h"
 
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
@@ -46,13 +48,23 @@ class VectorBase : public Node {
     VectorBase &operator=(VectorBase &&) = default;
  protected:
     explicit VectorBase(JSONLoader &json) : Node(json) {}
+    explicit VectorBase(BinaryLoader &binary) : Node(binary) {}
 };
 
 // This class should only be used in the IR.
 // User-level code should use regular std::vector
+//
+// The elements are shared with copies of the Vector (such as the clones made
+// by Transform) until one of them is changed, so a Vector can be cloned in
+// constant time.  The non-const accessors below all unshare the elements, so
+// prefer const access when only reading them.
 template<class T>
 class Vector : public VectorBase {
-    safe_vector<const T *>   vec;
+    copy_on_write<safe_vector<const T *>>   vec;
+
+    /// Replaces element @p i by @p n, the result of visiting it.
+    /// @returns the index of the next element to visit.
+    size_t replaceChild(size_t i, const Node *n);
 
  public:
     typedef const T* value_type;
@@ -60,45 +72,49 @@ class Vector : public VectorBase {
     Vector(const Vector &) = default;
     Vector(Vector &&) = default;
     explicit Vector(JSONLoader &json);
+    explicit Vector(BinaryLoader &binary);
     Vector &operator=(const Vector &) = default;
     Vector &operator=(Vector &&) = default;
     explicit Vector(const T *a) {
-        vec.emplace_back(std::move(a)); }
+        vec.modify().emplace_back(std::move(a)); }
     explicit Vector(const safe_vector<const T *> &a) {
-        vec.insert(vec.end(), a.begin(), a.end()); }
-    Vector(const std::initializer_list<const T *> &a) : vec(a) {}
+        vec.modify().insert(vec.modify().end(), a.begin(), a.end()); }
+    Vector(const std::initializer_list<const T *> &a) {
+        if (a.size()) vec.modify().assign(a); }
     static Vector<T>* fromJSON(JSONLoader &json);
+    static Vector<T>* fromBinary(BinaryLoader &binary);
     typedef typename safe_vector<const T *>::iterator        iterator;
     typedef typename safe_vector<const T *>::const_iterator  const_iterator;
-    iterator begin() { return vec.begin(); }
-    const_iterator begin() const { return vec.begin(); }
+    iterator begin() { return vec.modify().begin(); }
+    const_iterator begin() const { return vec->begin(); }
     VectorBase::iterator VectorBase_begin() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0]); }
-    iterator end() { return vec.end(); }
-    const_iterator end() const { return vec.end(); }
+        return reinterpret_cast<VectorBase::iterator>(vec->data()); }
+    iterator end() { return vec.modify().end(); }
+    const_iterator end() const { return vec->end(); }
     VectorBase::iterator VectorBase_end() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0] + vec.size()); }
-    std::reverse_iterator<iterator> rbegin() { return vec.rbegin(); }
-    std::reverse_iterator<const_iterator> rbegin() const { return vec.rbegin(); }
-    std::reverse_iterator<iterator> rend() { return vec.rend(); }
-    std::reverse_iterator<const_iterator> rend() const { return vec.rend(); }
-    size_t size() const override { return vec.size(); }
-    void resize(size_t sz) { vec.resize(sz); }
-    bool empty() const override { return vec.empty(); }
-    const T* const & front() const { return vec.front(); }
-    const T*& front() { return vec.front(); }
-    void clear() { vec.clear(); }
-    iterator erase(iterator i) { return vec.erase(i); }
-    iterator erase(iterator s, iterator e) { return vec.erase(s, e); }
+        return reinterpret_cast<VectorBase::iterator>(vec->data() + vec->size()); }
+    std::reverse_iterator<iterator> rbegin() { return vec.modify().rbegin(); }
+    std::reverse_iterator<const_iterator> rbegin() const { return vec->rbegin(); }
+    std::reverse_iterator<iterator> rend() { return vec.modify().rend(); }
+    std::reverse_iterator<const_iterator> rend() const { return vec->rend(); }
+    size_t size() const override { return vec->size(); }
+    void resize(size_t sz) { vec.modify().resize(sz); }
+    bool empty() const override { return vec->empty(); }
+    const T* const & front() const { return vec->front(); }
+    const T*& front() { return vec.modify().front(); }
+    void clear() { vec = decltype(vec)(); }
+    iterator erase(iterator i) { return vec.modify().erase(i); }
+    iterator erase(iterator s, iterator e) { return vec.modify().erase(s, e); }
     template<typename ForwardIter>
     iterator insert(iterator i, ForwardIter b, ForwardIter e) {
         /* FIXME -- gcc prior to 4.9 is broken and the insert routine returns void
          * FIXME -- rather than an iterator.  So we recalculate it from an index */
-        int index = i - vec.begin();
-        vec.insert(i, b, e);
-        return vec.begin() + index; }
+        auto &v = vec.modify();
+        int index = i - v.begin();
+        v.insert(i, b, e);
+        return v.begin() + index; }
 
     template<typename Container>
     iterator append(const Container &toAppend)
@@ -126,29 +142,31 @@ class Vector : public VectorBase {
     iterator insert(iterator i, const T* v) {
         /* FIXME -- gcc prior to 4.9 is broken and the insert routine returns void
          * FIXME -- rather than an iterator.  So we recalculate it from an index */
-        int index = i - vec.begin();
-        vec.insert(i, v);
-        return vec.begin() + index; }
+        auto &vv = vec.modify();
+        int index = i - vv.begin();
+        vv.insert(i, v);
+        return vv.begin() + index; }
     iterator insert(iterator i, size_t n, const T* v) {
         /* FIXME -- gcc prior to 4.9 is broken and the insert routine returns void
          * FIXME -- rather than an iterator.  So we recalculate it from an index */
-        int index = i - vec.begin();
-        vec.insert(i, n, v);
-        return vec.begin() + index; }
-
-    const T *const &operator[](size_t idx) const { return vec[idx]; }
-    const T *&operator[](size_t idx) { return vec[idx]; }
-    const T *const &at(size_t idx) const { return vec.at(idx); }
-    const T *&at(size_t idx) { return vec.at(idx); }
+        auto &vv = vec.modify();
+        int index = i - vv.begin();
+        vv.insert(i, n, v);
+        return vv.begin() + index; }
+
+    const T *const &operator[](size_t idx) const { return (*vec)[idx]; }
+    const T *&operator[](size_t idx) { return vec.modify()[idx]; }
+    const T *const &at(size_t idx) const { return vec->at(idx); }
+    const T *&at(size_t idx) { return vec.modify().at(idx); }
     template <class... Args> void emplace_back(Args&&... args) {
-        vec.emplace_back(new T(std::forward<Args>(args)...)); }
-    void push_back(T *a) { vec.push_back(a); }
-    void push_back(const T *a) { vec.push_back(a); }
-    void pop_back() { vec.pop_back(); }
-    const T* const & back() const { return vec.back(); }
-    const T*& back() { return vec.back(); }
-    template<class U> void push_back(U &a) { vec.push_back(a); }
-    void check_null() const { for (auto e : vec) CHECK_NULL(e); }
+        vec.modify().emplace_back(new T(std::forward<Args>(args)...)); }
+    void push_back(T *a) { vec.modify().push_back(a); }
+    void push_back(const T *a) { vec.modify().push_back(a); }
+    void pop_back() { vec.modify().pop_back(); }
+    const T* const & back() const { return vec->back(); }
+    const T*& back() { return vec.modify().back(); }
+    template<class U> void push_back(U &a) { vec.modify().push_back(a); }
+    void check_null() const { for (auto e : *vec) CHECK_NULL(e); }
 
     IRNODE_SUBCLASS(Vector)
     IRNODE_DECLARE_APPLY_OVERLOAD(Vector)
@@ -171,11 +189,16 @@ class Vector : public VectorBase {
     bool equiv(const Node &a_) const override {
         if (static_cast<const Node *>(this) == &a_) return true;
         if (typeid(*this) != typeid(a_)) return false;
+        if (hashMismatch(a_)) return false;
         auto &a = static_cast<const Vector<T> &>(a_);
         if (size() != a.size()) return false;
         auto it = a.begin();
         for (auto *el : *this) if (!el->equiv(**it++)) return false;
         return true; }
+    size_t computeStructuralHash() const override {
+        size_t h = Node::computeStructuralHash();
+        for (auto *el : *this) h = hash_combine(h, el->structuralHash());
+        return h; }
     cstring node_type_name() const override {
         return "Vector<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -185,8 +208,9 @@ class Vector : public VectorBase {
     virtual void parallel_visit_children(Visitor &v);
     virtual void parallel_visit_children(Visitor &v) const;
     void toJSON(JSONGenerator &json) const override;
+    void toBinary(BinaryGenerator &binary) const override;
     Util::Enumerator<const T*>* getEnumerator() const {
-        return Util::Enumerator<const T*>::createEnumerator(vec); }
+        return Util::Enumerator<const T*>::createEnumerator(*vec); }
     template <typename S>
     Util::Enumerator<const S*>* only() const {
         std::function<bool(const T*)> filter = [](const T* d) { return d->template is<S>(); };
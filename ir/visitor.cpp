@@ -18,6 +18,7 @@ limitations under the License.
 #include <time.h>
 #include "ir.h"
 #include "lib/log.h"
+#include "pass_profile.h"
 
 #include "visitor.h"
 
@@ -193,7 +194,7 @@ Visitor::profile_t Transform::init_apply(const IR::Node *root) {
 void Visitor::end_apply() {}
 void Visitor::end_apply(const IR::Node*) {}
 
-static indent_t profile_indent;
+static thread_local indent_t profile_indent;
 static uint64_t first_start = 0;
 Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
     struct timespec ts;
@@ -205,6 +206,8 @@ Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
 #endif
     start = ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
     assert(start);
+    if (PassProfile::enabled())
+        PassProfile::begin(v, start);
     LOG3(profile_indent << v.name() << " statrting at +" <<
          (first_start ? start - first_start : (first_start = start, 0UL))/1000000.0 << " msec");
     ++profile_indent;
@@ -224,6 +227,8 @@ Visitor::profile_t::~profile_t() {
         ts.tv_sec = ts.tv_nsec = 0;
 #endif
         uint64_t end = ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
+        if (PassProfile::enabled())
+            PassProfile::end(v, end);
         LOG1(profile_indent << v.name() << ' ' << (end-start)/1000.0 << " usec"); }
 }
 
@@ -291,6 +296,8 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
         } else {
             visited->start(n, visitDagOnce);
             IR::Node *copy = n->clone();
+            ++PassProfile::counters.visited;
+            ++PassProfile::counters.cloned;
             local.current.node = copy;
             if (!dontForwardChildrenBeforePreorder) {
                 ForwardChildren forward_children(*visited);
@@ -300,6 +307,7 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
                 copy->visit_children(*this);
                 visitCurrentOnce = visited->refVisitOnce(n);
                 copy->apply_visitor_postorder(*this); }
+            copy->hashCache = 0;  // may have been hashed before it was modified
             if (visited->finish(n, copy))
                 (n = copy)->validate(); } }
     if (ctxt)
@@ -320,6 +328,7 @@ const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
             n->apply_visitor_revisit(*this);
         } else {
             vp.first->second.done = false;
+            ++PassProfile::counters.visited;
             visitCurrentOnce = &vp.first->second.visitOnce;
             if (n->apply_visitor_preorder(*this)) {
                 n->visit_children(*this);
@@ -350,6 +359,8 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
         } else {
             visited->start(n, visitDagOnce);
             auto copy = n->clone();
+            ++PassProfile::counters.visited;
+            ++PassProfile::counters.cloned;
             local.current.node = copy;
             if (!dontForwardChildrenBeforePreorder) {
                 ForwardChildren forward_children(*visited);
@@ -373,11 +384,13 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
                 } else {
                     extra_clone = true;
                     visited->start(preorder_result, *visitCurrentOnce);
-                    local.current.node = copy = preorder_result->clone(); } }
+                    local.current.node = copy = preorder_result->clone();
+                    ++PassProfile::counters.cloned; } }
             if (!prune_flag) {
                 copy->visit_children(*this);
                 visitCurrentOnce = visited->refVisitOnce(n);
                 final_result = copy->apply_visitor_postorder(*this); }
+            copy->hashCache = 0;  // may have been hashed before it was modified
             prune_flag = save_prune_flag;
             if (final_result == copy
                 && final_result != preorder_result
@@ -137,6 +137,19 @@ class Visitor  {
     virtual Visitor *clone() const { BUG("need %s::clone method",  name()); return nullptr; }
     virtual bool check_clone(const Visitor *a) { return typeid(*this) == typeid(*a); }
 
+    /** True if applying this visitor again to a program it has left unchanged
+     * is known to leave it unchanged again and to have no other effect; that
+     * is, it only depends on the program and on state derived from it.
+     * PassRepeated skips such visitors when they would see the same program.
+     */
+    virtual bool rerun_is_noop() const { return false; }
+    /** For a visitor whose rerun_is_noop() is true: false if finding @n, a
+     * node created since the visitor last left the program unchanged, cannot
+     * give it anything new to do.  PassRepeated skips the visitor when no such
+     * node needs it.  The default treats every new node as needing it.
+     */
+    virtual bool rerun_needed_for(const IR::Node *) const { return true; }
+
     // Functions for IR visit_children to call for ControlFlowVisitors.
     virtual Visitor &flow_clone() { return *this; }
 
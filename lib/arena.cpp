@@ -0,0 +1,243 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "config.h"
+#if HAVE_LIBGC
+#ifdef MULTITHREAD
+#define GC_THREADS
+#endif  // MULTITHREAD
+#include <gc/gc.h>
+#endif  /* HAVE_LIBGC */
+#include "arena.h"
+
+#include <cstdlib>
+#include <map>
+#include <new>
+#ifdef MULTITHREAD
+#include <shared_mutex>
+#endif  // MULTITHREAD
+
+#include "log.h"
+#include "n4.h"
+
+namespace Util {
+
+thread_local Arena *Arena::current_ = nullptr;
+thread_local Arena::LocalCache Arena::cache_ = { nullptr, 0, nullptr };
+thread_local size_t Arena::threadBytes = 0;
+bool Arena::enabled_ = false;
+
+namespace {
+
+constexpr size_t alignment = 16;
+
+std::atomic<uint64_t> nextSerial(1);
+
+// the chunks of all arenas, by base address, for Arena::owner
+struct ChunkOwner {
+    const char  *end;
+    Arena       *arena;
+};
+std::map<const char *, ChunkOwner> &chunkOwners() {
+    static std::map<const char *, ChunkOwner> all;
+    return all;
+}
+// so that deleting nodes does not take the lock when no arena holds memory
+std::atomic<size_t> chunkCount(0);
+
+#ifdef MULTITHREAD
+std::shared_mutex &chunkOwnersLock() {
+    static std::shared_mutex theLock;
+    return theLock;
+}
+#endif  // MULTITHREAD
+
+void *chunkAlloc(size_t size) {
+#if HAVE_LIBGC
+    // collectable, and kept alive (and scanned) by the arena's pointer to its start
+    return GC_MALLOC_IGNORE_OFF_PAGE(size);
+#else
+    return std::malloc(size);
+#endif  /* HAVE_LIBGC */
+}
+
+void chunkFree(void *p) {
+#if HAVE_LIBGC
+    GC_FREE(p);
+#else
+    std::free(p);
+#endif  /* HAVE_LIBGC */
+}
+
+void add(std::atomic<size_t> &counter, size_t n) {
+    // only ever written by one thread, so no need for a locked add
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+Arena::Arena(size_t chunkSize) : chunkSize(chunkSize), serial(nextSerial++) {}
+
+Arena::~Arena() {
+    release();
+    for (auto *local : locals)
+        delete local;
+}
+
+Arena::Local &Arena::local() {
+    if (cache_.arena == this && cache_.serial == serial)
+        return *cache_.local;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    auto self = std::this_thread::get_id();
+    Local *rv = nullptr;
+    for (auto *local : locals) {
+        if (local->thread == self) {
+            rv = local;
+            break; } }
+    if (!rv) {
+        rv = new Local;
+        rv->thread = self;
+        locals.push_back(rv); }
+    cache_ = { this, serial, rv };
+    return *rv;
+}
+
+// called with lock held
+char *Arena::newChunk(size_t size) {
+    auto *base = static_cast<char *>(chunkAlloc(size));
+    if (!base) throw std::bad_alloc();
+    chunks.push_back({base, size});
+    stat.reserved += size;
+    stat.chunks++;
+    {
+#ifdef MULTITHREAD
+        std::unique_lock<std::shared_mutex> acquireOwners(chunkOwnersLock());
+#endif  // MULTITHREAD
+        chunkOwners()[base] = { base + size, this };
+        chunkCount++;
+    }
+    return base;
+}
+
+void *Arena::allocate(size_t size) {
+    size = (size + alignment - 1) & ~(alignment - 1);
+    threadBytes += size;
+    if (size > chunkSize / 4) {
+        // large objects get their own chunk, so the current one is not wasted
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        stat.allocations++;
+        stat.bytes += size;
+        return newChunk(size); }
+    auto &local = this->local();
+    if (size > size_t(local.end - local.next)) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        local.next = newChunk(chunkSize);
+        local.end = local.next + chunkSize; }
+    add(local.allocations, 1);
+    add(local.bytes, size);
+    auto *rv = local.next;
+    local.next += size;
+    return rv;
+}
+
+void Arena::release() {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    if (chunks.empty()) return;
+    LOG1("Releasing arena: " << stat);
+    {
+#ifdef MULTITHREAD
+        std::unique_lock<std::shared_mutex> acquireOwners(chunkOwnersLock());
+#endif  // MULTITHREAD
+        for (auto &chunk : chunks)
+            chunkOwners().erase(chunk.base);
+        chunkCount -= chunks.size();
+    }
+    for (auto &chunk : chunks)
+        chunkFree(chunk.base);
+    chunks.clear();
+    for (auto *local : locals)
+        local->next = local->end = nullptr;
+    stat.released += stat.reserved;
+    stat.reserved = stat.chunks = 0;
+}
+
+bool Arena::contains(const void *p) const {
+    return owner(p) == this;
+}
+
+Arena::Stats Arena::stats() const {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    Stats rv = stat;
+    for (auto *local : locals) {
+        rv.allocations += local->allocations.load(std::memory_order_relaxed);
+        rv.bytes += local->bytes.load(std::memory_order_relaxed); }
+    return rv;
+}
+
+Arena::Scope::Scope(Arena *arena) : prev(current_) {
+    current_ = arena;
+}
+
+Arena::Scope::~Scope() {
+    current_ = prev;
+}
+
+void Arena::enable() {
+    if (enabled_) return;
+    enabled_ = true;
+    static Arena *process = new Arena;  // never released
+    current_ = process;
+    strings();
+    std::atexit([]() {
+        LOG1("IR arena: " << process->stats());
+        LOG1("cstring arena: " << strings().stats()); });
+}
+
+Arena &Arena::strings() {
+    static Arena *strings = new Arena;  // never released
+    return *strings;
+}
+
+Arena *Arena::owner(const void *p) {
+    if (chunkCount.load(std::memory_order_acquire) == 0) return nullptr;
+    auto *cp = static_cast<const char *>(p);
+#ifdef MULTITHREAD
+    std::shared_lock<std::shared_mutex> acquire(chunkOwnersLock());
+#endif  // MULTITHREAD
+    auto &all = chunkOwners();
+    auto it = all.upper_bound(cp);
+    if (it == all.begin()) return nullptr;
+    --it;
+    return cp < it->second.end ? it->second.arena : nullptr;
+}
+
+std::ostream &operator<<(std::ostream &out, const Arena::Stats &stats) {
+    return out << n4(stats.allocations) << " objects, " << n4(stats.bytes) << "B allocated, "
+               << n4(stats.reserved) << "B in " << stats.chunks << " chunks, "
+               << n4(stats.released) << "B released";
+}
+
+}  // namespace Util
@@ -0,0 +1,137 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _LIB_ARENA_H_
+#define _LIB_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+namespace Util {
+
+/**
+ * A bump allocator: memory is carved out of large chunks and is only given
+ * back when the whole arena is released (or destroyed).  Destructors of the
+ * objects allocated in an arena are never run.
+ *
+ * IR nodes are allocated in the current arena of the allocating thread, if
+ * any (see Arena::Scope); interned cstrings are allocated in the permanent
+ * strings() arena once arenas are enabled, as the intern table never shrinks.
+ * Each thread bump-allocates from a chunk of its own, so allocation only takes
+ * the arena lock when a new chunk is needed.
+ *
+ * When built with libgc the chunks are ordinary collectable objects which are
+ * only reachable from their arena: they are scanned while the arena holds
+ * them, so objects in the arena keep what they point to alive, but they are
+ * not roots and cannot be reclaimed by the collector, only by release().
+ */
+class Arena {
+ public:
+    struct Stats {
+        size_t allocations = 0;  // number of objects allocated
+        size_t bytes = 0;        // bytes handed out
+        size_t reserved = 0;     // bytes in chunks currently held
+        size_t chunks = 0;       // chunks currently held
+        size_t released = 0;     // bytes given back by release()
+    };
+
+    static constexpr size_t defaultChunkSize = 1 << 20;
+
+    explicit Arena(size_t chunkSize = defaultChunkSize);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size);
+    /// Give back all the memory allocated in the arena.  Nothing allocated in
+    /// it may be used afterwards.
+    void release();
+    bool contains(const void *p) const;
+    Stats stats() const;
+
+    /// Make @arena the arena IR nodes are allocated in on this thread until
+    /// the Scope is destroyed.  A null @arena turns arena allocation off.
+    class Scope {
+        Arena *prev;
+     public:
+        explicit Scope(Arena *arena);
+        ~Scope();
+    };
+
+    /// The arena of the running thread, or nullptr
+    static Arena *current() { return current_; }
+    /// Turn on arena allocation for the process: the calling thread
+    /// allocates IR nodes in a process-wide arena which is never released,
+    /// and cstrings are allocated in strings().
+    static void enable();
+    static bool enabled() { return enabled_; }
+    /// The arena holding interned strings
+    static Arena &strings();
+    /// @return the arena containing @p, or nullptr; O(log #chunks)
+    static Arena *owner(const void *p);
+    /// Bytes allocated in arenas by the running thread (cf. gc_bytes_allocated)
+    static size_t threadBytesAllocated() { return threadBytes; }
+
+ private:
+    struct Chunk {
+        char    *base;
+        size_t  size;
+    };
+    /// The chunk a thread allocates from.  Only that thread writes it, so the
+    /// counters are atomic only to let stats() read them.
+    struct alignas(64) Local {
+        std::thread::id         thread;
+        char                    *next = nullptr;  // free space in the chunk
+        char                    *end = nullptr;
+        std::atomic<size_t>     allocations{0};
+        std::atomic<size_t>     bytes{0};
+    };
+    size_t              chunkSize;
+    uint64_t            serial;  // tells the arena apart from a later one at the same address
+    std::vector<Chunk>  chunks;
+    std::vector<Local *> locals;
+    Stats               stat;  // chunks, and the objects allocated in chunks of their own
+#ifdef MULTITHREAD
+    mutable std::mutex  lock;
+#endif  // MULTITHREAD
+
+    Local &local();
+    char *newChunk(size_t size);
+
+    /// The Local of the running thread in the arena it last allocated in
+    struct LocalCache {
+        const Arena     *arena;
+        uint64_t        serial;
+        Local           *local;
+    };
+    static thread_local Arena *current_;
+    static thread_local LocalCache cache_;
+    static thread_local size_t threadBytes;
+    static bool enabled_;
+};
+
+std::ostream &operator<<(std::ostream &out, const Arena::Stats &stats);
+
+}  // namespace Util
+
+#endif /* _LIB_ARENA_H_ */
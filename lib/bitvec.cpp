@@ -18,21 +18,20 @@ limitations under the License.
 #include "bitvec.h"
 #include "hex.h"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 std::ostream &operator<<(std::ostream &os, const bitvec &bv) {
-    if (bv.size == 1) {
-        os << hex(bv.data);
-    } else {
-        bool first = true;
-        for (int i = bv.size-1; i >= 0; i--) {
-            if (first) {
-                if (!bv.ptr[i]) continue;
-                os << hex(bv.ptr[i]);
-                first = false;
-            } else {
-                os << hex(bv.ptr[i], sizeof(bv.data)*2, '0'); } }
-        if (first)
-            os << '0';
-    }
+    const uintptr_t *w = bv.words();
+    bool first = true;
+    for (int i = bv.size-1; i >= 0; i--) {
+        if (first) {
+            if (!w[i] && i > 0) continue;
+            os << hex(w[i]);
+            first = false;
+        } else {
+            os << hex(w[i], sizeof(*w)*2, '0'); } }
     return os;
 }
 
@@ -69,44 +68,42 @@ bool operator>>(const char *s, bitvec &bv) {
 }
 
 bitvec &bitvec::operator>>=(size_t count) {
-    if (size == 1) {
-        if (count >= bits_per_unit)
-            data = 0;
-        else
-            data >>= count;
-        return *this; }
-    int off = count / bits_per_unit;
+    uintptr_t *w = words();
+    size_t off = count / bits_per_unit;
     count %= bits_per_unit;
     for (size_t i = 0; i < size; i++)
         if (i + off < size) {
-            ptr[i] = ptr[i+off] >> count;
+            w[i] = w[i+off] >> count;
             if (count && i + off + 1 < size)
-                ptr[i] |= ptr[i+off+1] << (bits_per_unit - count);
+                w[i] |= w[i+off+1] << (bits_per_unit - count);
         } else {
-            ptr[i] = 0; }
-    while (size > 1 && !ptr[size-1]) size--;
-    if (size == 1) {
-        auto tmp = ptr[0];
-        delete [] ptr;
-        data = tmp; }
+            w[i] = 0; }
+    if (!is_inline()) {
+        size_t used = size;
+        while (used > 0 && !w[used-1]) used--;
+        if (used <= inline_units) {
+            // Small enough to move back into the bitvec.
+            uintptr_t *old = ptr;
+            memset(data, 0, sizeof(data));
+            memcpy(data, old, used * sizeof(*old));
+            delete [] old;
+            size = inline_units; } }
     return *this;
 }
 
 bitvec &bitvec::operator<<=(size_t count) {
     size_t needsize = (max().index() + count + bits_per_unit)/bits_per_unit;
     if (needsize > size) expand(needsize);
-    if (size == 1) {
-        data <<= count;
-        return *this; }
-    int off = count / bits_per_unit;
+    uintptr_t *w = words();
+    size_t off = count / bits_per_unit;
     count %= bits_per_unit;
-    for (int i = size-1; i >= 0; i--)
+    for (size_t i = size; i-- > 0;)
         if (i >= off) {
-            ptr[i] = ptr[i-off] << count;
+            w[i] = w[i-off] << count;
             if (count && i > off)
-                ptr[i] |= ptr[i-off-1] >> (bits_per_unit - count);
+                w[i] |= w[i-off-1] >> (bits_per_unit - count);
         } else {
-            ptr[i] = 0; }
+            w[i] = 0; }
     return *this;
 }
 
@@ -115,26 +112,20 @@ bitvec bitvec::getslice(size_t idx, size_t sz) const {
     if (idx >= size * bits_per_unit) return bitvec();
     if (idx + sz > size * bits_per_unit)
         sz = size * bits_per_unit - idx;
-    if (size > 1) {
-        bitvec rv;
-        unsigned shift = idx % bits_per_unit;
-        idx /= bits_per_unit;
-        if (sz > bits_per_unit) {
-            rv.expand((sz-1)/bits_per_unit + 1);
-            for (size_t i = 0; i < rv.size; i++) {
-                if (shift != 0 && i != 0)
-                    rv.ptr[i-1] |= ptr[idx + i] << (bits_per_unit - shift);
-                rv.ptr[i] = ptr[idx + i] >> shift; }
-            if ((sz %= bits_per_unit))
-                rv.ptr[rv.size-1] &= ~(~static_cast<uintptr_t>(1) << (sz-1));
-        } else {
-            rv.data = ptr[idx] >> shift;
-            if (shift != 0 && idx + 1 < size)
-                rv.data |= ptr[idx + 1] << (bits_per_unit - shift);
-            rv.data &= ~(~static_cast<uintptr_t>(1) << (sz-1)); }
-        return rv;
-    } else {
-        return bitvec((data >> idx) & ~(~static_cast<uintptr_t>(1) << (sz-1))); }
+    bitvec rv;
+    size_t units = (sz-1)/bits_per_unit + 1;
+    if (units > rv.size) rv.expand(units);
+    const uintptr_t *w = words();
+    uintptr_t *rw = rv.words();
+    unsigned shift = idx % bits_per_unit;
+    idx /= bits_per_unit;
+    for (size_t i = 0; i < units; i++) {
+        rw[i] = w[idx + i] >> shift;
+        if (shift != 0 && idx + i + 1 < size)
+            rw[i] |= w[idx + i + 1] << (bits_per_unit - shift); }
+    if ((sz %= bits_per_unit))
+        rw[units-1] &= ~(~static_cast<uintptr_t>(1) << (sz-1));
+    return rv;
 }
 
 int bitvec::ffs(unsigned start) const {
@@ -198,3 +189,152 @@ bitvec bitvec::rotate_right_copy(size_t start_bit, size_t rotation_idx, size_t e
     bitvec rv = rot_section | (*this - rot_mask);
     return rv;
 }
+
+namespace bv {
+
+namespace {
+
+/* Word-at-a-time fallback, with the same interface as the vector types below. */
+struct Scalar {
+    typedef uintptr_t vec;
+    static constexpr size_t units = 1;
+    static vec zero() { return 0; }
+    static vec load(const uintptr_t *p) { return *p; }
+    static void store(uintptr_t *p, vec v) { *p = v; }
+    static vec or_(vec a, vec b) { return a | b; }
+    static vec and_(vec a, vec b) { return a & b; }
+    static vec andnot(vec a, vec b) { return ~a & b; }
+    static vec xor_(vec a, vec b) { return a ^ b; }
+    static bool any(vec v) { return v != 0; }
+};
+
+/* The operations, as the new value of the destination and the bits that changed. */
+struct Or {
+    template<class V> static typename V::vec apply(typename V::vec d, typename V::vec s) {
+        return V::or_(d, s); }
+    template<class V> static typename V::vec changed(typename V::vec d, typename V::vec s) {
+        return V::andnot(d, s); }
+};
+struct And {
+    template<class V> static typename V::vec apply(typename V::vec d, typename V::vec s) {
+        return V::and_(d, s); }
+    template<class V> static typename V::vec changed(typename V::vec d, typename V::vec s) {
+        return V::andnot(s, d); }
+};
+struct AndNot {
+    template<class V> static typename V::vec apply(typename V::vec d, typename V::vec s) {
+        return V::andnot(s, d); }
+    template<class V> static typename V::vec changed(typename V::vec d, typename V::vec s) {
+        return V::and_(d, s); }
+};
+struct Xor {
+    template<class V> static typename V::vec apply(typename V::vec d, typename V::vec s) {
+        return V::xor_(d, s); }
+    template<class V> static typename V::vec changed(typename V::vec, typename V::vec) {
+        return V::zero(); }
+};
+
+template<class V, class Op>
+inline bool apply_units(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    typename V::vec changed = V::zero();
+    size_t i = 0;
+    for (; i + V::units <= n; i += V::units) {
+        auto d = V::load(dst + i), s = V::load(src + i);
+        changed = V::or_(changed, Op::template changed<V>(d, s));
+        V::store(dst + i, Op::template apply<V>(d, s)); }
+    bool rv = V::any(changed);
+    for (; i < n; i++) {
+        rv |= Scalar::any(Op::template changed<Scalar>(dst[i], src[i]));
+        dst[i] = Op::template apply<Scalar>(dst[i], src[i]); }
+    return rv;
+}
+
+int popcount_scalar(const uintptr_t *src, size_t n) {
+    int rv = 0;
+    for (size_t i = 0; i < n; i++)
+        rv += popcount(src[i]);
+    return rv;
+}
+
+#if defined(__AVX2__)
+struct Avx2 {
+    typedef __m256i vec;
+    static constexpr size_t units = sizeof(vec) / sizeof(uintptr_t);
+    static vec zero() { return _mm256_setzero_si256(); }
+    static vec load(const uintptr_t *p) { return _mm256_loadu_si256((const vec *)p); }
+    static void store(uintptr_t *p, vec v) { _mm256_storeu_si256((vec *)p, v); }
+    static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+    static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+    static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+    static vec xor_(vec a, vec b) { return _mm256_xor_si256(a, b); }
+    static bool any(vec v) { return !_mm256_testz_si256(v, v); }
+};
+typedef Avx2 Simd;
+
+/* Counts the bits of each byte with a 4-bit lookup table, and adds up the bytes of each
+ * 64-bit lane. */
+int popcount_simd(const uintptr_t *src, size_t n) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + Avx2::units <= n; i += Avx2::units) {
+        __m256i v = Avx2::load(src + i);
+        __m256i bits = _mm256_add_epi8(
+            _mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+            _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(bits, _mm256_setzero_si256())); }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, sums);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcount_scalar(src + i, n - i);
+}
+#elif defined(__SSE2__)
+struct Sse2 {
+    typedef __m128i vec;
+    static constexpr size_t units = sizeof(vec) / sizeof(uintptr_t);
+    static vec zero() { return _mm_setzero_si128(); }
+    static vec load(const uintptr_t *p) { return _mm_loadu_si128((const vec *)p); }
+    static void store(uintptr_t *p, vec v) { _mm_storeu_si128((vec *)p, v); }
+    static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+    static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+    static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+    static vec xor_(vec a, vec b) { return _mm_xor_si128(a, b); }
+    static bool any(vec v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero())) != 0xffff; }
+};
+typedef Sse2 Simd;
+
+/* Counts the bits of each byte by adding pairs, nibbles and then bytes, and adds up the
+ * bytes of each 64-bit lane. */
+int popcount_simd(const uintptr_t *src, size_t n) {
+    const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33), m4 = _mm_set1_epi8(0x0f);
+    __m128i sums = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + Sse2::units <= n; i += Sse2::units) {
+        __m128i v = Sse2::load(src + i);
+        v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+        v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(v, _mm_setzero_si128())); }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, sums);
+    return lanes[0] + lanes[1] + popcount_scalar(src + i, n - i);
+}
+#else
+typedef Scalar Simd;
+int popcount_simd(const uintptr_t *src, size_t n) { return popcount_scalar(src, n); }
+#endif
+
+}  // namespace
+
+bool simd_or(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    return apply_units<Simd, Or>(dst, src, n); }
+bool simd_and(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    return apply_units<Simd, And>(dst, src, n); }
+bool simd_andnot(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    return apply_units<Simd, AndNot>(dst, src, n); }
+void simd_xor(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    apply_units<Simd, Xor>(dst, src, n); }
+int simd_popcount(const uintptr_t *src, size_t n) { return popcount_simd(src, n); }
+
+}  // namespace bv
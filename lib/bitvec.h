@@ -22,6 +22,7 @@ limitations under the License.
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <utility>
 #include <iostream>
 #include <type_traits>
@@ -43,6 +44,11 @@ limitations under the License.
 #undef clrbit
 #endif
 
+#ifndef BITVEC_INLINE_UNITS
+/* number of words a bitvec holds without allocating memory */
+#define BITVEC_INLINE_UNITS 4
+#endif
+
 namespace bv {
 #if defined(__GNUC__) || defined(__clang__)
 /* use builtin count leading/trailing bits of type-approprite size */
@@ -106,19 +112,71 @@ int popcount(I x) {
     return rv;
 #endif
 }
+
+/* Bulk operations on arrays of 'n' words, used by bitvec for the words the two operands
+ * have in common.  The ones updating 'dst' return true if that changed it.  Long arrays
+ * are handed to the vectorized versions in bitvec.cpp. */
+static constexpr size_t simd_min_units = 8;
+bool simd_or(uintptr_t *dst, const uintptr_t *src, size_t n);
+bool simd_and(uintptr_t *dst, const uintptr_t *src, size_t n);
+bool simd_andnot(uintptr_t *dst, const uintptr_t *src, size_t n);
+void simd_xor(uintptr_t *dst, const uintptr_t *src, size_t n);
+int simd_popcount(const uintptr_t *src, size_t n);
+
+inline bool or_units(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    if (n >= simd_min_units) return simd_or(dst, src, n);
+    uintptr_t changed = 0;
+    for (size_t i = 0; i < n; i++) {
+        changed |= src[i] & ~dst[i];
+        dst[i] |= src[i]; }
+    return changed != 0; }
+inline bool and_units(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    if (n >= simd_min_units) return simd_and(dst, src, n);
+    uintptr_t changed = 0;
+    for (size_t i = 0; i < n; i++) {
+        changed |= dst[i] & ~src[i];
+        dst[i] &= src[i]; }
+    return changed != 0; }
+inline bool andnot_units(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    if (n >= simd_min_units) return simd_andnot(dst, src, n);
+    uintptr_t changed = 0;
+    for (size_t i = 0; i < n; i++) {
+        changed |= dst[i] & src[i];
+        dst[i] &= ~src[i]; }
+    return changed != 0; }
+inline void xor_units(uintptr_t *dst, const uintptr_t *src, size_t n) {
+    if (n >= simd_min_units) return simd_xor(dst, src, n);
+    for (size_t i = 0; i < n; i++)
+        dst[i] ^= src[i]; }
+inline int popcount_units(const uintptr_t *src, size_t n) {
+    if (n >= simd_min_units) return simd_popcount(src, n);
+    int rv = 0;
+    for (size_t i = 0; i < n; i++)
+        rv += popcount(src[i]);
+    return rv; }
 }  // namespace bv
 
 
+/* A set of bits, stored in 'size' words.  Up to inline_units words (BITVEC_INLINE_UNITS,
+ * 4 by default) are held in the bitvec itself; larger bitvecs allocate their words.
+ * An inline bitvec always uses all of its inline words, so 'size > inline_units' tells
+ * whether the words are allocated. */
 class bitvec {
+ public:
+    static constexpr size_t bits_per_unit = CHAR_BIT * sizeof(uintptr_t);
+    static constexpr size_t inline_units = BITVEC_INLINE_UNITS;
+    static_assert(inline_units >= 1, "a bitvec needs at least one inline word");
+
+ private:
     size_t              size;
     union {
-        uintptr_t       data;
+        uintptr_t       data[inline_units];
         uintptr_t       *ptr;
     };
-    uintptr_t word(size_t i) const { return i < size ? size > 1 ? ptr[i] : data : 0; }
-
- public:
-    static constexpr size_t bits_per_unit = CHAR_BIT * sizeof(uintptr_t);
+    bool is_inline() const { return size <= inline_units; }
+    uintptr_t *words() { return is_inline() ? data : ptr; }
+    const uintptr_t *words() const { return is_inline() ? data : ptr; }
+    uintptr_t word(size_t i) const { return i < size ? words()[i] : 0; }
 
  private:
     template<class T> class bitref {
@@ -199,162 +257,140 @@ class bitvec {
     // incomplete type errors
     class copy_bitref;
 
-    bitvec() : size(1), data(0) {}
-    explicit bitvec(uintptr_t v) : size(1), data(v) {}
+    bitvec() : size(inline_units), data{} {}
+    explicit bitvec(uintptr_t v) : size(inline_units), data{v} {}
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
-    explicit bitvec(T v) : size(1), data(v) {
-        if (v != data) {
-            size = sizeof(v)/sizeof(data);
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
-            for (unsigned i = 0; i < size; ++i) {
-                ptr[i] = v;
-                v >>= bits_per_unit; } } }
-    bitvec(size_t lo, size_t cnt) : size(1), data(0) { setrange(lo, cnt); }
+    explicit bitvec(T v) : size(inline_units), data{} { setraw(v); }
+    bitvec(size_t lo, size_t cnt) : size(inline_units), data{} { setrange(lo, cnt); }
     bitvec(const bitvec &a) : size(a.size) {
-        if (size > 1) {
+        if (!is_inline()) {
             ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
             memcpy(ptr, a.ptr, size * sizeof(*ptr));
         } else {
-            data = a.data; }}
-    bitvec(bitvec &&a) : size(a.size), data(a.data) { a.size = 1; }
+            memcpy(data, a.data, sizeof(data)); }}
+    bitvec(bitvec &&a) : size(a.size) {
+        memcpy(data, a.data, sizeof(data));
+        if (!a.is_inline()) {
+            a.size = inline_units;
+            memset(a.data, 0, sizeof(a.data)); } }
     bitvec &operator=(const bitvec &a) {
         if (this == &a) return *this;
-        if (size > 1) delete [] ptr;
-        if ((size = a.size) > 1) {
+        if (!is_inline()) delete [] ptr;
+        if ((size = a.size) > inline_units) {
             ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
             memcpy(ptr, a.ptr, size * sizeof(*ptr));
         } else {
-            data = a.data; }
+            memcpy(data, a.data, sizeof(data)); }
         return *this; }
     bitvec &operator=(bitvec &&a) {
         std::swap(size, a.size); std::swap(data, a.data);
         return *this; }
-    ~bitvec() { if (size > 1) delete [] ptr; }
+    ~bitvec() { if (!is_inline()) delete [] ptr; }
 
-    void clear() {
-        if (size > 1) memset(ptr, 0, size * sizeof(*ptr));
-        else data = 0; }  // NOLINT(whitespace/newline)
+    void clear() { memset(words(), 0, size * sizeof(uintptr_t)); }
     bool setbit(size_t idx) {
         if (idx >= size * bits_per_unit) expand(1 + idx/bits_per_unit);
-        if (size > 1)
-            ptr[idx/bits_per_unit] |= (uintptr_t)1 << (idx%bits_per_unit);
-        else
-            data |= (uintptr_t)1 << idx;
+        words()[idx/bits_per_unit] |= (uintptr_t)1 << (idx%bits_per_unit);
         return true; }
     void setrange(size_t idx, size_t sz) {
         if (sz == 0) return;
         if (idx+sz > size * bits_per_unit) expand(1 + (idx+sz-1)/bits_per_unit);
-        if (size == 1) {
-            data |= ~(~(uintptr_t)1 << (sz-1)) << idx;
-        } else if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
-            ptr[idx/bits_per_unit] |=
+        uintptr_t *w = words();
+        if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
+            w[idx/bits_per_unit] |=
                 ~(~(uintptr_t)1 << (sz-1)) << (idx%bits_per_unit);
         } else {
             size_t i = idx/bits_per_unit;
-            ptr[i] |= ~(uintptr_t)0 << (idx%bits_per_unit);
+            w[i] |= ~(uintptr_t)0 << (idx%bits_per_unit);
             idx += sz;
             while (++i < idx/bits_per_unit) {
-                ptr[i] = ~(uintptr_t)0; }
+                w[i] = ~(uintptr_t)0; }
             if (i < size)
-                ptr[i] |= (((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
+                w[i] |= (((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
     void setraw(uintptr_t raw) {
-        if (size == 1) {
-            data = raw;
-        } else {
-            ptr[0] = raw;
-            for (size_t i = 1; i < size; i++)
-                ptr[i] = 0; } }
+        uintptr_t *w = words();
+        w[0] = raw;
+        for (size_t i = 1; i < size; i++)
+            w[i] = 0; }
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
     void setraw(T raw) {
         if (sizeof(T)/sizeof(uintptr_t) > size) expand(sizeof(T)/sizeof(uintptr_t));
+        uintptr_t *w = words();
         for (size_t i = 0; i < size; i++) {
-            ptr[i] = raw;
-            raw >>= bits_per_unit; } }
+            w[i] = i < sizeof(T)/sizeof(uintptr_t) ? raw : 0;
+            if (i + 1 < sizeof(T)/sizeof(uintptr_t)) raw >>= bits_per_unit; } }
     void setraw(uintptr_t *raw, size_t sz) {
         if (sz > size) expand(sz);
-        if (size == 1) {
-            data = raw[0];
-        } else {
-            for (size_t i = 0; i < sz; i++)
-                ptr[i] = raw[i];
-            for (size_t i = sz; i < size; i++)
-                ptr[i] = 0; } }
+        uintptr_t *w = words();
+        for (size_t i = 0; i < sz; i++)
+            w[i] = raw[i];
+        for (size_t i = sz; i < size; i++)
+            w[i] = 0; }
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
     void setraw(T *raw, size_t sz) {
         constexpr size_t m = sizeof(T)/sizeof(uintptr_t);
         if (m * sz > size) expand(m * sz);
+        uintptr_t *w = words();
         size_t i = 0;
         for (; i < sz*m; ++i)
-            ptr[i] = raw[i/m] >> ((i%m) * bits_per_unit);
+            w[i] = raw[i/m] >> ((i%m) * bits_per_unit);
         for (; i < size; ++i)
-            ptr[i] = 0; }
+            w[i] = 0; }
     bool clrbit(size_t idx) {
         if (idx >= size * bits_per_unit) return false;
-        if (size > 1)
-            ptr[idx/bits_per_unit] &= ~((uintptr_t)1 << (idx%bits_per_unit));
-        else
-            data &= ~((uintptr_t)1 << idx);
+        words()[idx/bits_per_unit] &= ~((uintptr_t)1 << (idx%bits_per_unit));
         return false; }
     void clrrange(size_t idx, size_t sz) {
         if (sz == 0) return;
         if (size < sz/bits_per_unit)  // To avoid sz + idx overflow
             sz = size * bits_per_unit;
         if (idx >= size * bits_per_unit) return;
-        if (size == 1) {
-            if (idx + sz < bits_per_unit)
-                data &= ~(~(~(uintptr_t)1 << (sz-1)) << idx);
-            else
-                data &= ~(~(uintptr_t)0 << idx);
-        } else if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
-            ptr[idx/bits_per_unit] &=
+        uintptr_t *w = words();
+        if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
+            w[idx/bits_per_unit] &=
                 ~(~(~(uintptr_t)1 << (sz-1)) << (idx%bits_per_unit));
         } else {
             size_t i = idx/bits_per_unit;
-            ptr[i] &= ~(~(uintptr_t)0 << (idx%bits_per_unit));
+            w[i] &= ~(~(uintptr_t)0 << (idx%bits_per_unit));
             idx += sz;
             while (++i < idx/bits_per_unit && i < size) {
-                ptr[i] = 0; }
+                w[i] = 0; }
             if (i < size)
-                ptr[i] &= ~(((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
+                w[i] &= ~(((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
     bool getbit(size_t idx) const {
         return (word(idx/bits_per_unit) >> (idx%bits_per_unit)) & 1; }
     uintmax_t getrange(size_t idx, size_t sz) const {
         assert(sz > 0 && sz <= CHAR_BIT * sizeof(uintmax_t));
         if (idx >= size * bits_per_unit) return 0;
-        if (size > 1) {
-            unsigned shift = idx % bits_per_unit;
-            idx /= bits_per_unit;
-            uintmax_t rv = ptr[idx] >> shift;
-            shift = bits_per_unit - shift;
-            while (shift < sz) {
-                if (++idx >= size) break;
-                rv |= (uintmax_t)ptr[idx] << shift;
-                shift += bits_per_unit; }
-            return rv & ~(~(uintmax_t)1 << (sz-1));
-        } else {
-            return (data >> idx) & ~(~(uintmax_t)1 << (sz-1)); } }
+        const uintptr_t *w = words();
+        unsigned shift = idx % bits_per_unit;
+        idx /= bits_per_unit;
+        uintmax_t rv = w[idx] >> shift;
+        shift = bits_per_unit - shift;
+        while (shift < sz) {
+            if (++idx >= size) break;
+            rv |= (uintmax_t)w[idx] << shift;
+            shift += bits_per_unit; }
+        return rv & ~(~(uintmax_t)1 << (sz-1)); }
     void putrange(size_t idx, size_t sz, uintmax_t v) {
         assert(sz > 0 && sz <= CHAR_BIT * sizeof(uintmax_t));
         uintptr_t mask = ~(uintmax_t)0 >> (CHAR_BIT * sizeof(uintmax_t) - sz);
         v &= mask;
         if (idx+sz > size * bits_per_unit) expand(1 + (idx+sz-1)/bits_per_unit);
-        if (size == 1) {
-            data &= ~(mask << idx);
-            data |= v << idx;
-        } else {
-            unsigned shift = idx % bits_per_unit;
-            idx /= bits_per_unit;
-            ptr[idx] &= ~(mask << shift);
-            ptr[idx] |= v << shift;
-            shift = bits_per_unit - shift;
-            while (shift < sz) {
-                assert(idx+1 < size);
-                ptr[++idx] &= ~(mask >> shift);
-                ptr[idx] |= v >> shift;
-                shift += bits_per_unit; } } }
+        uintptr_t *w = words();
+        unsigned shift = idx % bits_per_unit;
+        idx /= bits_per_unit;
+        w[idx] &= ~(mask << shift);
+        w[idx] |= v << shift;
+        shift = bits_per_unit - shift;
+        while (shift < sz) {
+            assert(idx+1 < size);
+            w[++idx] &= ~(mask >> shift);
+            w[idx] |= v >> shift;
+            shift += bits_per_unit; } }
     bitvec getslice(size_t idx, size_t sz) const;
     nonconst_bitref operator[](int idx) { return nonconst_bitref(*this, idx); }
     bool operator[](int idx) const { return getbit(idx); }
@@ -375,31 +411,20 @@ class bitvec {
     nonconst_bitref begin() & { return min(); }
     nonconst_bitref end() & { return nonconst_bitref(*this, -1); }
     bool empty() const {
+        const uintptr_t *w = words();
         for (size_t i = 0; i < size; i++)
-            if (word(i) != 0) return false;
+            if (w[i] != 0) return false;
         return true; }
     explicit operator bool() const { return !empty(); }
     bool operator&=(const bitvec &a) {
-        bool rv = false;
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < size && i < a.size; i++) {
-                    rv |= ((ptr[i] & a.ptr[i]) != ptr[i]);
-                    ptr[i] &= a.ptr[i]; }
-            } else {
-                rv |= ((*ptr & a.data) != *ptr);
-                *ptr &= a.data; }
-            if (size > a.size) {
-                if (!rv) {
-                    for (size_t i = a.size; i < size; i++)
-                        if (ptr[i]) { rv = true; break; }}
-                memset(ptr + a.size, 0, (size-a.size) * sizeof(*ptr)); }
-        } else if (a.size > 1) {
-            rv |= ((data & a.ptr[0]) != data);
-            data &= a.ptr[0];
-        } else {
-            rv |= ((data & a.data) != data);
-            data &= a.data; }
+        uintptr_t *w = words();
+        size_t common = std::min(size, a.size);
+        bool rv = bv::and_units(w, a.words(), common);
+        if (size > common) {
+            if (!rv) {
+                for (size_t i = common; i < size; i++)
+                    if (w[i]) { rv = true; break; }}
+            memset(w + common, 0, (size - common) * sizeof(*w)); }
         return rv; }
     bitvec operator&(const bitvec &a) const {
         if (size <= a.size) {
@@ -407,23 +432,11 @@ class bitvec {
         } else {
             bitvec rv(a); rv &= *this; return rv; } }
     bool operator|=(const bitvec &a) {
-        bool rv = false;
         if (size < a.size) expand(a.size);
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < a.size; i++) {
-                    rv |= ((ptr[i] | a.ptr[i]) != ptr[i]);
-                    ptr[i] |= a.ptr[i]; }
-            } else {
-                rv |= ((*ptr | a.data) != *ptr);
-                *ptr |= a.data; }
-        } else {
-            rv |= ((data | a.data) != data);
-            data |= a.data; }
-        return rv; }
+        return bv::or_units(words(), a.words(), a.size); }
     bool operator|=(uintptr_t a) {
         bool rv = false;
-        auto t = size > 1 ? ptr : &data;
+        auto t = words();
         rv |= ((*t | a) != *t);
         *t |= a;
         return rv; }
@@ -439,33 +452,12 @@ class bitvec {
     bitvec operator|(T a) { bitvec rv(*this); rv |= bitvec(a); return rv; }
     bitvec &operator^=(const bitvec &a) {
         if (size < a.size) expand(a.size);
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < a.size; i++) ptr[i] ^= a.ptr[i];
-            } else {
-                *ptr ^= a.data; }
-        } else {
-            data ^= a.data; }
+        bv::xor_units(words(), a.words(), a.size);
         return *this; }
     bitvec operator^(const bitvec &a) const {
         bitvec rv(*this); rv ^= a; return rv; }
     bool operator-=(const bitvec &a) {
-        bool rv = false;
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < size && i < a.size; i++) {
-                    rv |= ((ptr[i] & ~a.ptr[i]) != ptr[i]);
-                    ptr[i] &= ~a.ptr[i]; }
-            } else {
-                rv |= ((*ptr & ~a.data) != *ptr);
-                *ptr &= ~a.data; }
-        } else if (a.size > 1) {
-            rv |= ((data & ~a.ptr[0]) != data);
-            data &= ~a.ptr[0];
-        } else {
-            rv |= ((data & ~a.data) != data);
-            data &= ~a.data; }
-        return rv; }
+        return bv::andnot_units(words(), a.words(), std::min(size, a.size)); }
     bitvec operator-(const bitvec &a) const {
         bitvec rv(*this); rv -= a; return rv; }
     bool operator==(const bitvec &a) const {
@@ -498,11 +490,7 @@ class bitvec {
     bitvec operator<<(size_t count) const { bitvec rv(*this); rv <<= count; return rv; }
     void rotate_right(size_t start_bit, size_t rotation_idx, size_t end_bit);
     bitvec rotate_right_copy(size_t start_bit, size_t rotation_idx, size_t end_bit) const;
-    int popcount() const {
-        int rv = 0;
-        for (size_t i = 0; i < size; i++)
-            rv += bv::popcount(word(i));
-        return rv; }
+    int popcount() const { return bv::popcount_units(words(), size); }
     bool is_contiguous() const;
 
  private:
@@ -516,18 +504,11 @@ class bitvec {
             m |= m >> 8;
             m |= m >> 16;
             newsize = (newsize + m) & ~m; }
-        if (size > 1) {
-            uintptr_t *old = ptr;
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
-            memcpy(ptr, old, size * sizeof(*ptr));
-            memset(ptr + size, 0, (newsize - size) * sizeof(*ptr));
-            delete [] old;
-        } else {
-            uintptr_t d = data;
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
-            *ptr = d;
-            memset(ptr + size, 0, (newsize - size) * sizeof(*ptr));
-        }
+        uintptr_t *units = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
+        memcpy(units, words(), size * sizeof(*units));
+        memset(units + size, 0, (newsize - size) * sizeof(*units));
+        if (!is_inline()) delete [] ptr;
+        ptr = units;
         size = newsize;
     }
 
@@ -0,0 +1,55 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _LIB_COPY_ON_WRITE_H_
+#define _LIB_COPY_ON_WRITE_H_
+
+#include <memory>
+
+/// Holds a value of type T which is shared by copies of the holder until one
+/// of them modifies it.  Copying the holder is thus constant time; the value
+/// itself is only copied by the first modify() of a shared holder.  An empty
+/// holder does not allocate anything and reads as a default-constructed T.
+template<class T>
+class copy_on_write {
+    std::shared_ptr<T> ptr;
+
+    static const T &empty() {
+        static const T *value = new T();
+        return *value; }
+
+ public:
+    copy_on_write() = default;
+
+    const T &operator*() const { return ptr ? *ptr : empty(); }
+    const T *operator->() const { return &**this; }
+
+    /// @returns the value for modification, first copying it if it is shared.
+    T &modify() {
+        if (!ptr)
+            ptr = std::make_shared<T>();
+        else if (ptr.use_count() > 1)
+            ptr = std::make_shared<T>(*ptr);
+        return *ptr; }
+
+    /// @returns true if this and @p a hold the same value without having copied it.
+    bool shares(const copy_on_write &a) const { return ptr == a.ptr; }
+
+    bool operator==(const copy_on_write &a) const { return shares(a) || **this == *a; }
+    bool operator!=(const copy_on_write &a) const { return !(*this == a); }
+};
+
+#endif /* _LIB_COPY_ON_WRITE_H_ */
@@ -17,10 +17,16 @@ limitations under the License.
 #include "cstring.h"
 
 #include <algorithm>
+#include <atomic>
 #include <ios>
 #include <string>
 #include <unordered_set>
+#ifdef MULTITHREAD
+#include <mutex>
+#include <shared_mutex>
+#endif  // MULTITHREAD
 
+#include "arena.h"
 #include "hash.h"
 
 namespace {
@@ -42,6 +48,7 @@ inline table_entry_flags operator |(table_entry_flags l, table_entry_flags r) {
 // cache entry, ordered by string length
 class table_entry {
     std::size_t m_length = 0;
+    std::size_t m_hash = 0;
     table_entry_flags m_flags = table_entry_flags::none;
 
     union {
@@ -51,8 +58,9 @@ class table_entry {
 
  public:
     // entry ctor, makes copy of passed string
-    table_entry(const char *string, std::size_t length, table_entry_flags flags)
-        : m_length(length) {
+    table_entry(const char *string, std::size_t length, std::size_t hash,
+                table_entry_flags flags)
+        : m_length(length), m_hash(hash) {
         if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
             // No need to copy object, it's view of string, string literal or string allocated
             // on heap and wrapped with cstring.
@@ -68,10 +76,18 @@ class table_entry {
             // String with length less than size of pointer store directly
             // in pointer, that hint allows reduce stack fragmentation.
             // We can make such optimization because std::unordered_set never
-            // moves objects in memory on new element insert
+            // moves objects in memory on new element insert, and the per-thread
+            // caches only ever point at entries that live in the table
             std::memcpy(m_inplace_string, string, length);
             m_inplace_string[length] = '\0';
             m_flags = table_entry_flags::inplace;
+        } else if (Util::Arena::enabled()) {
+            // interned strings are never freed, so they can as well be bump-allocated
+            auto copy = static_cast<char *>(Util::Arena::strings().allocate(length + 1));
+            std::memcpy(copy, string, length);
+            copy[length] = '\0';
+            m_string = copy;
+            m_flags = table_entry_flags::none;
         } else {
             // Make copy of string elseware
             auto copy = new char[length + 1];
@@ -87,7 +103,8 @@ class table_entry {
     // table_entry moveable only
     table_entry(const table_entry &) = delete;
 
-    table_entry(table_entry &&other) : m_length(other.m_length), m_flags(other.m_flags) {
+    table_entry(table_entry &&other)
+        : m_length(other.m_length), m_hash(other.m_hash), m_flags(other.m_flags) {
         // this object for internal usage only, length will never be accessed
         // if object was moved, so do not zero other.m_length here
 
@@ -113,6 +130,10 @@ class table_entry {
         return m_length;
     }
 
+    std::size_t hash() const {
+        return m_hash;
+    }
+
     const char *string() const {
         if (is_inplace()) {
             return m_inplace_string;
@@ -122,7 +143,8 @@ class table_entry {
     }
 
     bool operator ==(const table_entry &other) const {
-        return length() == other.length() && std::memcmp(string(), other.string(), length()) == 0;
+        return hash() == other.hash() && length() == other.length() &&
+               std::memcmp(string(), other.string(), length()) == 0;
     }
 
  private:
@@ -130,37 +152,128 @@ class table_entry {
         return (m_flags & table_entry_flags::inplace) == table_entry_flags::inplace;
     }
 };
-}  // namespace
 
-namespace std {
-template<>
-struct hash<table_entry> {
+struct table_entry_hash {
     std::size_t operator()(const table_entry &entry) const {
-        return Util::Hash::murmur(entry.string(), entry.length());
+        return entry.hash();
     }
 };
+
+// The intern table is split into independently locked shards, selected by the
+// string hash, so that threads interning different strings rarely contend.
+// Lookups which miss the per-thread cache below take a shared (reader) lock on
+// their shard, so they are not lock-free, but readers never block each other;
+// a writer lock is taken only when a string is not interned yet.  Each shard
+// has its own cache line so that the locks of neighbouring shards do not
+// false-share.
+struct alignas(64) cache_shard {
+#ifdef MULTITHREAD
+    std::shared_mutex lock;
+#endif  // MULTITHREAD
+    std::unordered_set<table_entry, table_entry_hash> table;
+};
+
+constexpr std::size_t shard_count = 64;
+
+cache_shard *shards() {
+    static cache_shard g_shards[shard_count];
+
+    return g_shards;
 }
 
-namespace {
-std::unordered_set<table_entry>& cache() {
-    static std::unordered_set<table_entry> g_cache;
+cache_shard &shard_for(std::size_t hash) {
+    // low bits of the hash are used by the per-thread cache and by the
+    // buckets of each shard, so select the shard with the high ones.
+    return shards()[(hash >> 24) % shard_count];
+}
+
+// Counters of the per-thread caches of threads which have already flushed them.
+std::atomic<std::size_t> g_local_hits{0};
+std::atomic<std::size_t> g_hits{0};
+std::atomic<std::size_t> g_misses{0};
+
+// Small direct-mapped per-thread cache of recently interned strings. A hit
+// here needs neither a lock nor access to shared memory other than the
+// (immutable) string itself.
+struct local_cache {
+    static constexpr std::size_t size = 256;
+    // flush the counters to the global ones when one reaches this value
+    static constexpr std::size_t flush_interval = 4096;
+
+    struct slot {
+        const char *string;
+        std::size_t length;
+        std::size_t hash;
+    } slots[size] = {};
+    // counted per thread, so that lookups do not write to shared cache lines
+    std::size_t hits = 0;         // hits in this cache
+    std::size_t table_hits = 0;   // hits in the shared table
+    std::size_t misses = 0;       // strings inserted into the shared table
+
+    void count(std::size_t &counter) {
+        if (++counter >= flush_interval)
+            flush();
+    }
+    void flush() {
+        g_local_hits.fetch_add(hits, std::memory_order_relaxed);
+        g_hits.fetch_add(table_hits, std::memory_order_relaxed);
+        g_misses.fetch_add(misses, std::memory_order_relaxed);
+        hits = table_hits = misses = 0;
+    }
+    ~local_cache() { flush(); }
+};
+
+local_cache &thread_cache() {
+    static thread_local local_cache t_cache;
 
-    return g_cache;
+    return t_cache;
 }
 
 const char *save_to_cache(const char *string, std::size_t length, table_entry_flags flags) {
-    if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
-        return cache().emplace(string, length, flags).first->string();
+    std::size_t hash = Util::Hash::murmur(string, length);
+    bool owned = (flags & table_entry_flags::require_destruction) ==
+            table_entry_flags::require_destruction;
+
+    auto &local = thread_cache();
+    auto &slot = local.slots[hash % local_cache::size];
+    if (slot.string && slot.hash == hash && slot.length == length &&
+        (slot.string == string || std::memcmp(slot.string, string, length) == 0)) {
+        local.count(local.hits);
+        if (owned && slot.string != string)
+            delete [] string;
+        return slot.string;
     }
 
-    // temporary table_entry, used for searching only. no need to copy string
-    auto found = cache().find(table_entry(string, length, table_entry_flags::no_need_copy));
+    auto &shard = shard_for(hash);
+    const char *rv = nullptr;
+    {
+        // temporary table_entry, used for searching only. no need to copy string
+        table_entry key(string, length, hash, table_entry_flags::no_need_copy);
+#ifdef MULTITHREAD
+        std::shared_lock<std::shared_mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+        auto found = shard.table.find(key);
+        if (found != shard.table.end())
+            rv = found->string();
+    }
 
-    if (found == cache().end()) {
-        return cache().emplace(string, length, flags).first->string();
+    if (rv) {
+        local.count(local.table_hits);
+        if (owned && rv != string)
+            delete [] string;
+    } else {
+        local.count(local.misses);
+#ifdef MULTITHREAD
+        std::unique_lock<std::shared_mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+        // another thread may have inserted the same string in the meantime;
+        // in that case emplace destroys the new entry (and an owned string
+        // with it) and returns the existing one.
+        rv = shard.table.emplace(string, length, hash, flags).first->string();
     }
 
-    return found->string();
+    slot = { rv, length, hash };
+    return rv;
 }
 
 }  // namespace
@@ -179,10 +292,29 @@ void cstring::construct_from_literal(const char *string, std::size_t length) {
 }
 
 size_t cstring::cache_size(size_t &count) {
+    cache_stats stats;
+    return cache_size(count, stats);
+}
+
+size_t cstring::cache_size(size_t &count, cache_stats &stats) {
     size_t rv = 0;
-    count = cache().size();
-    for (auto &s : cache())
-        rv += sizeof(s) + s.length();
+    count = 0;
+    stats = cache_stats();
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        auto &shard = shards()[i];
+#ifdef MULTITHREAD
+        std::shared_lock<std::shared_mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+        count += shard.table.size();
+        for (auto &s : shard.table)
+            rv += sizeof(s) + s.length();
+        stats.max_shard_count = std::max(stats.max_shard_count, shard.table.size());
+    }
+    auto &local = thread_cache();
+    stats.local_hits = g_local_hits.load(std::memory_order_relaxed) + local.hits;
+    stats.hits = g_hits.load(std::memory_order_relaxed) + local.table_hits;
+    stats.misses = g_misses.load(std::memory_order_relaxed) + local.misses;
+    stats.shards = shard_count;
     return rv;
 }
 
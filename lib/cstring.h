@@ -51,8 +51,10 @@ limitations under the License.
  *     std::string.
  *   - Interned strings can never be freed, so they'll stick around for the
  *     lifetime of the program.
- *   - The string interning cstring performs is currently not threadsafe, so you
- *     can't safely use cstrings off the main thread.
+ *   - The intern table is sharded and only thread-safe when built with
+ *     MULTITHREAD (-DENABLE_MULTITHREAD=ON); otherwise cstrings must not be
+ *     created off the main thread.  Each thread keeps a small cache of recently
+ *     interned strings, so repeated conversions of the same string are cheap.
  *
  * Given these tradeoffs, the general rule of thumb to follow is that you should
  * try to convert strings to cstrings early and keep them in that form. That
@@ -257,9 +259,22 @@ class cstring {
     template <class T>
     static cstring make_unique(const T &inuse, cstring base, int &counter, char sep = '.');
 
+    /// Statistics about the use of the intern table.
+    struct cache_stats {
+        size_t hits = 0;             // lookups of strings already in the table
+        size_t misses = 0;           // lookups which inserted a new string
+        size_t local_hits = 0;       // lookups satisfied by a per-thread cache
+        size_t shards = 0;           // number of shards of the table
+        size_t max_shard_count = 0;  // number of strings in the fullest shard
+    };
+
     /// @return the total size in bytes of all interned strings. @count is set
     /// to the total number of interned strings.
     static size_t cache_size(size_t &count);
+    /// As above, also filling in @stats.  The counters are kept per thread, so
+    /// those of other threads are only accounted approximately (they are
+    /// flushed periodically).
+    static size_t cache_size(size_t &count, cache_stats &stats);
 
     /// convert the cstring to upper case
     cstring toUpper() const;
@@ -17,6 +17,10 @@ limitations under the License.
 #ifndef _LIB_ERROR_REPORTER_H_
 #define _LIB_ERROR_REPORTER_H_
 
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
 #include "error_helper.h"
 #include "error_catalog.h"
 #include "exceptions.h"
@@ -59,10 +63,20 @@ class ErrorReporter {
     bool error_reported(int err, const Util::SourceInfo source) {
         if (!source.isValid())
             return false;
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
         auto p = errorTracker.emplace(err, source);
         return !p.second;  // if insertion took place, then we have not seen the error.
     }
 
+#ifdef MULTITHREAD
+    /// Serializes diagnostics reported concurrently by passes running in parallel.
+    static std::mutex &lock() {
+        static std::mutex theLock;
+        return theLock; }
+#endif  // MULTITHREAD
+
     /// retrieve the format from the error catalog
     const char *get_error_name(int errorCode) {
         return ErrorCatalog::getCatalog().getName(errorCode);
@@ -133,6 +147,9 @@ class ErrorReporter {
     void diagnose(DiagnosticAction action, const char* diagnosticName,
                   const char* format, const char* suffix, T... args) {
         if (action == DiagnosticAction::Ignore) return;
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
 
         ErrorMessage::MessageType msgType = ErrorMessage::MessageType::None;
         if (action == DiagnosticAction::Warn) {
@@ -169,6 +186,17 @@ class ErrorReporter {
 
     unsigned getWarningCount() const { return warningCount; }
 
+    /// Emit @text, the output of @count warnings reported by an earlier
+    /// compilation whose results are reused, and count them as warnings.
+    void replayWarnings(const std::string &text, unsigned count) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
+        *outputstream << text;
+        outputstream->flush();
+        warningCount += count;
+    }
+
     /// @return the number of diagnostics (warnings and errors) encountered
     /// in the current CompileContext.
     unsigned getDiagnosticCount() const { return errorCount + warningCount; }
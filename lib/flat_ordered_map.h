@@ -0,0 +1,303 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_FLAT_ORDERED_MAP_H_
+#define LIB_FLAT_ORDERED_MAP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace FlatOrderedImpl {
+
+/* Storage shared by flat_ordered_map and flat_ordered_set: the elements in insertion order
+ * in a deque, and an open addressing hash table (linear probing) of their positions.
+ * Erased elements leave a hole in the deque, which iteration skips; the deque is compacted
+ * once holes outnumber elements.
+ *
+ * Inserting never invalidates iterators or references.  Erasing invalidates iterators and
+ * references to the erased element, and to all elements when it compacts. */
+template<class T, class K, class KEYOF, class HASH, class EQ>
+class table {
+ protected:
+    struct entry {
+        std::optional<T>        value;  // empty once erased
+        size_t                  hash;
+        explicit entry(size_t hash) : hash(hash) {}
+    };
+    std::deque<entry>           entries;
+    std::vector<uint32_t>       index;  // positions in entries, EMPTY, or ERASED
+    unsigned                    shift = 64;
+    size_t                      live = 0;   // number of elements
+    size_t                      used = 0;   // number of slots in index which are not EMPTY
+    HASH                        hash_fn;
+    EQ                          equal_fn;
+    static constexpr uint32_t   EMPTY = ~0U;
+    static constexpr uint32_t   ERASED = ~0U - 1;
+    static constexpr size_t     NONE = ~size_t(0);
+
+    // Pointers and interned strings are aligned, so mix the high bits of the hash in.
+    size_t slot(size_t hash) const {
+        return (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> shift; }
+    size_t lookup(const K &k, size_t hash) const {
+        if (index.empty()) return NONE;
+        for (size_t s = slot(hash), mask = index.size() - 1; ; s = (s + 1) & mask) {
+            auto pos = index[s];
+            if (pos == EMPTY) return NONE;
+            if (pos != ERASED && entries[pos].hash == hash &&
+                equal_fn(KEYOF()(*entries[pos].value), k))
+                return pos; } }
+    void rebuild() {
+        size_t size = 8;
+        while (size < (live + 1) * 4) size *= 2;
+        index.assign(size, EMPTY);
+        shift = 64;
+        for (size_t s = size; s > 1; s >>= 1) --shift;
+        used = 0;
+        for (size_t pos = 0; pos < entries.size(); ++pos)
+            if (entries[pos].value) place(pos); }
+    void place(size_t pos) {
+        size_t s = slot(entries[pos].hash), mask = index.size() - 1;
+        while (index[s] != EMPTY && index[s] != ERASED) s = (s + 1) & mask;
+        if (index[s] == EMPTY) ++used;
+        index[s] = pos; }
+    template<typename... A> size_t append(size_t hash, A &&... a) {
+        if ((used + 1) * 2 > index.size()) rebuild();
+        entries.emplace_back(hash);
+        try {
+            entries.back().value.emplace(std::forward<A>(a)...);
+        } catch (...) {
+            entries.pop_back();
+            throw; }
+        ++live;
+        place(entries.size() - 1);
+        return entries.size() - 1; }
+    size_t next_live(size_t pos) const {
+        while (pos < entries.size() && !entries[pos].value) ++pos;
+        return pos; }
+    // Erases the element at pos and returns the position of the next element.
+    size_t erase_at(size_t pos) {
+        size_t s = slot(entries[pos].hash), mask = index.size() - 1;
+        while (index[s] != pos) s = (s + 1) & mask;
+        index[s] = ERASED;
+        entries[pos].value.reset();
+        --live;
+        size_t next = next_live(pos);
+        if (entries.size() - live <= std::max(live, size_t(8)))
+            return next;
+        std::deque<entry> compacted;
+        size_t remapped = live;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i == next) remapped = compacted.size();
+            if (!entries[i].value) continue;
+            compacted.emplace_back(entries[i].hash);
+            compacted.back().value.emplace(std::move(*entries[i].value)); }
+        entries.swap(compacted);
+        rebuild();
+        return remapped; }
+    template<class I, class TABLE> static I make_iter(TABLE *t, size_t pos) { return I(t, pos); }
+    template<class I> static size_t position(const I &i) { return i.pos; }
+
+ public:
+    template<class TABLE, class VALUE>
+    class iter {
+        friend class table;
+        TABLE   *t = nullptr;
+        size_t  pos = 0;
+        iter(TABLE *t, size_t pos) : t(t), pos(pos) {}
+     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef T                               value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef VALUE                           *pointer;
+        typedef VALUE                           &reference;
+        iter() = default;
+        template<class TT, class VV>
+        iter(const iter<TT, VV> &i) : t(i.t), pos(i.pos) {}  // NOLINT(runtime/explicit)
+        reference operator*() const { return *t->entries[pos].value; }
+        pointer operator->() const { return &*t->entries[pos].value; }
+        iter &operator++() { pos = t->next_live(pos + 1); return *this; }
+        iter &operator--() { do --pos; while (!t->entries[pos].value); return *this; }
+        iter operator++(int) { auto copy = *this; ++*this; return copy; }
+        iter operator--(int) { auto copy = *this; --*this; return copy; }
+        template<class TT, class VV>
+        bool operator==(const iter<TT, VV> &i) const { return pos == i.pos; }
+        template<class TT, class VV>
+        bool operator!=(const iter<TT, VV> &i) const { return pos != i.pos; }
+        template<class TT, class VV> friend class iter;
+    };
+
+    typedef size_t      size_type;
+
+    bool        empty() const noexcept { return live == 0; }
+    size_type   size() const noexcept { return live; }
+    size_type   max_size() const noexcept { return ERASED; }
+    void clear() { entries.clear(); index.clear(); live = used = 0; }
+    size_type count(const K &k) const { return lookup(k, hash_fn(k)) != NONE; }
+};
+
+struct first_key {
+    template<class P> auto operator()(const P &p) const -> decltype((p.first)) {
+        return p.first; }
+};
+
+struct identity_key {
+    template<class T> const T &operator()(const T &v) const { return v; }
+};
+
+}  // namespace FlatOrderedImpl
+
+/* Drop-in replacement for ordered_map: iterates in order of element insertion, but keeps
+ * the elements in a deque and finds them through a hash table, so lookups touch a couple of
+ * cache lines rather than walking a tree and inserts do not allocate a node each.
+ *
+ * Keys are hashed rather than compared, so there is no lower_bound/upper_bound, and
+ * elements can only be appended, so there is no insertion at a position and no sort.
+ * See FlatOrderedImpl::table for iterator invalidation. */
+template <class K, class V, class HASH = std::hash<K>, class EQ = std::equal_to<K>>
+class flat_ordered_map : public FlatOrderedImpl::table<std::pair<const K, V>, K,
+                                                         FlatOrderedImpl::first_key, HASH, EQ> {
+    typedef FlatOrderedImpl::table<std::pair<const K, V>, K, FlatOrderedImpl::first_key,
+                                   HASH, EQ> base;
+
+ public:
+    typedef K                           key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<const K, V>       value_type;
+    typedef HASH                        hasher;
+    typedef EQ                          key_equal;
+    typedef value_type                  &reference;
+    typedef const value_type            &const_reference;
+    typedef typename base::template iter<base, value_type>               iterator;
+    typedef typename base::template iter<const base, const value_type>   const_iterator;
+    typedef std::reverse_iterator<iterator>             reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>       const_reverse_iterator;
+    typedef typename base::size_type    size_type;
+
+ private:
+    iterator iter_at(size_t pos) { return base::template make_iter<iterator>(this, pos); }
+    const_iterator iter_at(size_t pos) const {
+        return base::template make_iter<const_iterator>(this, pos); }
+
+ public:
+    flat_ordered_map() {}
+    flat_ordered_map(const std::initializer_list<value_type> &il) { insert(il.begin(), il.end()); }
+
+    iterator                    begin() noexcept { return iter_at(this->next_live(0)); }
+    const_iterator              begin() const noexcept { return iter_at(this->next_live(0)); }
+    iterator                    end() noexcept { return iter_at(this->entries.size()); }
+    const_iterator              end() const noexcept { return iter_at(this->entries.size()); }
+    reverse_iterator            rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator      rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator            rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator      rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_iterator              cbegin() const noexcept { return begin(); }
+    const_iterator              cend() const noexcept { return end(); }
+    const_reverse_iterator      crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator      crend() const noexcept { return rend(); }
+
+    bool operator==(const flat_ordered_map &a) const {
+        return this->size() == a.size() && std::equal(begin(), end(), a.begin()); }
+    bool operator!=(const flat_ordered_map &a) const { return !(*this == a); }
+
+    iterator find(const key_type &k) {
+        auto pos = this->lookup(k, this->hash_fn(k));
+        return pos == base::NONE ? end() : iter_at(pos); }
+    const_iterator find(const key_type &k) const {
+        auto pos = this->lookup(k, this->hash_fn(k));
+        return pos == base::NONE ? end() : iter_at(pos); }
+
+    V& operator[](const K &k) { return emplace(k).first->second; }
+    V& operator[](K &&k) { return emplace(std::move(k)).first->second; }
+    V& at(const K &k) {
+        auto it = find(k);
+        if (it == end()) throw std::out_of_range("flat_ordered_map::at");
+        return it->second; }
+    const V& at(const K &k) const {
+        auto it = find(k);
+        if (it == end()) throw std::out_of_range("flat_ordered_map::at");
+        return it->second; }
+
+    template<typename KK, typename... VV>
+    std::pair<iterator, bool> emplace(KK &&k, VV &&... v) {
+        auto hash = this->hash_fn(k);
+        auto pos = this->lookup(k, hash);
+        if (pos != base::NONE)
+            return std::make_pair(iter_at(pos), false);
+        pos = this->append(hash, std::piecewise_construct, std::forward_as_tuple(k),
+                           std::forward_as_tuple(std::forward<VV>(v)...));
+        return std::make_pair(iter_at(pos), true); }
+    std::pair<iterator, bool> insert(const value_type &v) {
+        auto hash = this->hash_fn(v.first);
+        auto pos = this->lookup(v.first, hash);
+        if (pos != base::NONE)
+            return std::make_pair(iter_at(pos), false);
+        return std::make_pair(iter_at(this->append(hash, v)), true); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        while (b != e) insert(*b++); }
+
+    iterator erase(const_iterator pos) { return iter_at(this->erase_at(base::position(pos))); }
+    size_type erase(const K &k) {
+        auto pos = this->lookup(k, this->hash_fn(k));
+        if (pos == base::NONE) return 0;
+        this->erase_at(pos);
+        return 1; }
+};
+
+namespace GetImpl {
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V get(const flat_ordered_map<K, V, Hash, Eq> &m, T key, V def = V()) {
+    auto it = m.find(key);
+    if (it != m.end()) return it->second;
+    return def; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V *getref(flat_ordered_map<K, V, Hash, Eq> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline const V *getref(const flat_ordered_map<K, V, Hash, Eq> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V get(const flat_ordered_map<K, V, Hash, Eq> *m, T key, V def = V()) {
+    return m ? get(*m, key, def) : def; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V *getref(flat_ordered_map<K, V, Hash, Eq> *m, T key) {
+    return m ? getref(*m, key) : 0; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline const V *getref(const flat_ordered_map<K, V, Hash, Eq> *m, T key) {
+    return m ? getref(*m, key) : 0; }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* LIB_FLAT_ORDERED_MAP_H_ */
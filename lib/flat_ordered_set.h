@@ -0,0 +1,91 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_FLAT_ORDERED_SET_H_
+#define LIB_FLAT_ORDERED_SET_H_
+
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#include "flat_ordered_map.h"
+
+/* Drop-in replacement for ordered_set, with the same layout and restrictions as
+ * flat_ordered_map: no sorted iteration and no insertion at a position. */
+template <class T, class HASH = std::hash<T>, class EQ = std::equal_to<T>>
+class flat_ordered_set : public FlatOrderedImpl::table<T, T, FlatOrderedImpl::identity_key,
+                                                        HASH, EQ> {
+    typedef FlatOrderedImpl::table<T, T, FlatOrderedImpl::identity_key, HASH, EQ> base;
+
+ public:
+    typedef T                   key_type;
+    typedef T                   value_type;
+    typedef HASH                hasher;
+    typedef EQ                  key_equal;
+    typedef const T             &reference;
+    typedef const T             &const_reference;
+    typedef typename base::template iter<const base, const T>   iterator;
+    typedef iterator                                            const_iterator;
+    typedef std::reverse_iterator<iterator>                     reverse_iterator;
+    typedef reverse_iterator                                    const_reverse_iterator;
+    typedef typename base::size_type    size_type;
+
+ private:
+    iterator iter_at(size_t pos) const { return base::template make_iter<iterator>(this, pos); }
+
+ public:
+    flat_ordered_set() {}
+    flat_ordered_set(std::initializer_list<T> init) { insert(init.begin(), init.end()); }
+
+    iterator            begin() const noexcept { return iter_at(this->next_live(0)); }
+    iterator            end() const noexcept { return iter_at(this->entries.size()); }
+    reverse_iterator    rbegin() const noexcept { return reverse_iterator(end()); }
+    reverse_iterator    rend() const noexcept { return reverse_iterator(begin()); }
+    iterator            cbegin() const noexcept { return begin(); }
+    iterator            cend() const noexcept { return end(); }
+    reverse_iterator    crbegin() const noexcept { return rbegin(); }
+    reverse_iterator    crend() const noexcept { return rend(); }
+    const T &front() const { return *begin(); }
+    const T &back() const { return *rbegin(); }
+
+    bool operator==(const flat_ordered_set &a) const {
+        return this->size() == a.size() && std::equal(begin(), end(), a.begin()); }
+    bool operator!=(const flat_ordered_set &a) const { return !(*this == a); }
+
+    iterator find(const T &v) const {
+        auto pos = this->lookup(v, this->hash_fn(v));
+        return pos == base::NONE ? end() : iter_at(pos); }
+
+    template<typename TT> std::pair<iterator, bool> insert(TT &&v) {
+        auto hash = this->hash_fn(v);
+        auto pos = this->lookup(v, hash);
+        if (pos != base::NONE)
+            return std::make_pair(iter_at(pos), false);
+        return std::make_pair(iter_at(this->append(hash, std::forward<TT>(v))), true); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        while (b != e) insert(*b++); }
+    template<typename... A> std::pair<iterator, bool> emplace(A &&... a) {
+        return insert(T(std::forward<A>(a)...)); }
+
+    iterator erase(iterator pos) { return iter_at(this->erase_at(base::position(pos))); }
+    size_type erase(const T &v) {
+        auto pos = this->lookup(v, this->hash_fn(v));
+        if (pos == base::NONE) return 0;
+        this->erase_at(pos);
+        return 1; }
+};
+
+#endif /* LIB_FLAT_ORDERED_SET_H_ */
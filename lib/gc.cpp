@@ -16,6 +16,9 @@ limitations under the License.
 
 #include "config.h"
 #if HAVE_LIBGC
+#ifdef MULTITHREAD
+#define GC_THREADS
+#endif  // MULTITHREAD
 #include <gc/gc_cpp.h>
 #include <gc/gc_mark.h>
 #endif  /* HAVE_LIBGC */
@@ -23,6 +26,7 @@ limitations under the License.
 #include <cstddef>
 #include <cstring>
 #include <new>
+#include "arena.h"
 #include "log.h"
 #include "gc.h"
 #include "cstring.h"
@@ -43,6 +47,9 @@ static char *emergency_ptr;
 
 // One can disable the GC, e.g., to run under Valgrind, by editing config.h
 #if HAVE_LIBGC
+// bytes allocated through operator new by this thread, for profiling
+static thread_local size_t bytes_allocated;
+
 void *operator new(std::size_t size) {
     /* DANGER -- on OSX, can't safely call the garbage collector allocation
      * routines from a static global constructor without manually initializing
@@ -52,6 +59,7 @@ void *operator new(std::size_t size) {
         started_init = true;
         GC_INIT();
         done_init = true; }
+    bytes_allocated += size;
     auto *rv = ::operator new(size, UseGC, 0, 0);
     if (!rv && emergency_ptr && emergency_ptr + size < emergency_pool + sizeof(emergency_pool)) {
         rv = emergency_ptr;
@@ -175,9 +183,14 @@ static int gc_logging_level;
 static void gc_callback() {
     if (gc_logging_level >= 1) {
         std::clog << "****** GC called ****** (heap size " << n4(GC_get_heap_size()) << ")";
-        size_t count, size = cstring::cache_size(count);
-        std::clog << " cstring cache size " << n4(size) << " (count " << n4(count) << ")"
-                  << std::endl;
+        size_t count;
+        cstring::cache_stats stats;
+        size_t size = cstring::cache_size(count, stats);
+        std::clog << " cstring cache size " << n4(size) << " (count " << n4(count) << ")";
+        if (gc_logging_level >= 2)
+            std::clog << " hits " << n4(stats.hits + stats.local_hits) << " (local "
+                      << n4(stats.local_hits) << ") misses " << n4(stats.misses);
+        std::clog << std::endl;
     }
 }
 
@@ -201,6 +214,14 @@ void setup_gc_logging() {
 #endif  /* HAVE_LIBGC */
 }
 
+size_t gc_bytes_allocated() {
+#if HAVE_LIBGC
+    return bytes_allocated + Util::Arena::threadBytesAllocated();
+#else
+    return Util::Arena::threadBytesAllocated();
+#endif
+}
+
 size_t gc_mem_inuse(size_t *max) {
 #if HAVE_LIBGC
     GC_word heapsize, heapfree;
@@ -213,3 +234,23 @@ size_t gc_mem_inuse(size_t *max) {
     return 0;
 #endif
 }
+
+void gc_allow_threads() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    GC_allow_register_threads();
+#endif
+}
+
+void gc_register_thread() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    struct GC_stack_base sb;
+    GC_get_stack_base(&sb);
+    GC_register_my_thread(&sb);
+#endif
+}
+
+void gc_unregister_thread() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    GC_unregister_my_thread();
+#endif
+}
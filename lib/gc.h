@@ -21,5 +21,13 @@ limitations under the License.
 
 void setup_gc_logging();
 size_t gc_mem_inuse(size_t *max = 0);  // trigger GC, return inuse after
+size_t gc_bytes_allocated();  // total bytes allocated by operator new or arenas on this thread
+
+// Threads other than the main one that allocate memory must be registered with
+// the collector (when built with MULTITHREAD).  gc_allow_threads must be called
+// from the main thread before any other thread registers itself.
+void gc_allow_threads();
+void gc_register_thread();
+void gc_unregister_thread();
 
 #endif /* LIB_GC_H_ */
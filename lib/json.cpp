@@ -198,7 +198,7 @@ JsonObject* JsonObject::emplace(cstring label, IJson* value) {
                                      "for a label which already exists ")
                              + label.c_str() + " " + s.c_str());
     }
-    ordered_map<cstring, IJson*>::emplace(label, value);
+    flat_ordered_map<cstring, IJson*>::emplace(label, value);
     return this;
 }
 
@@ -209,4 +209,114 @@ JsonObject* JsonObject::emplace_non_null(cstring label, IJson* value) {
     return this;
 }
 
+void JsonWriter::writeHeld(Level &level) {
+    for (auto &held : level.held) {
+        if (!level.first)
+            out << ",";
+        out << IndentCtl::endl << held;
+        level.first = false; }
+    level.held.clear();
+}
+
+void JsonWriter::beginElement() {
+    if (afterKey || levels.empty()) {
+        afterKey = false;
+        return; }
+    auto &level = levels.back();
+    if (level.object)
+        throw std::logic_error("JsonWriter: value without a key");
+    if (level.small) {
+        // not an array of scalars after all
+        level.small = false;
+        out << IndentCtl::indent;
+        writeHeld(level); }
+    if (!level.first)
+        out << ",";
+    out << IndentCtl::endl;
+    level.first = false;
+}
+
+JsonWriter &JsonWriter::beginObject() {
+    beginElement();
+    out << "{" << IndentCtl::indent;
+    levels.emplace_back(true);
+    return *this;
+}
+
+JsonWriter &JsonWriter::endObject() {
+    if (levels.empty() || !levels.back().object || afterKey)
+        throw std::logic_error("JsonWriter: unexpected end of object");
+    levels.pop_back();
+    out << IndentCtl::unindent << IndentCtl::endl << "}";
+    return *this;
+}
+
+JsonWriter &JsonWriter::beginArray() {
+    beginElement();
+    out << "[";
+    levels.emplace_back(false);
+    return *this;
+}
+
+JsonWriter &JsonWriter::endArray() {
+    if (levels.empty() || levels.back().object)
+        throw std::logic_error("JsonWriter: unexpected end of array");
+    auto &level = levels.back();
+    if (level.small) {
+        bool first = true;
+        for (auto &held : level.held) {
+            if (!first)
+                out << ", ";
+            out << held;
+            first = false; }
+    } else {
+        out << IndentCtl::unindent << IndentCtl::endl; }
+    out << "]";
+    levels.pop_back();
+    return *this;
+}
+
+JsonWriter &JsonWriter::key(cstring label) {
+    if (levels.empty() || !levels.back().object || afterKey)
+        throw std::logic_error("JsonWriter: unexpected key");
+    if (label.isNullOrEmpty())
+        throw std::logic_error("Empty label");
+    auto &level = levels.back();
+    if (!level.first)
+        out << ",";
+    level.first = false;
+    out << IndentCtl::endl << "\"" << label << "\"" << " : ";
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(const JsonValue &v) {
+    if (!afterKey && !levels.empty() && !levels.back().object) {
+        auto &level = levels.back();
+        if (level.small) {
+            level.held.push_back(v.toString().c_str());
+            return *this; } }
+    beginElement();
+    v.serialize(out);
+    return *this;
+}
+
+JsonWriter &JsonWriter::json(const IJson *json) {
+    if (json == nullptr)
+        return value(JsonValue());
+    if (auto v = json->to<JsonValue>())
+        return value(*v);
+    beginElement();
+    json->serialize(out);
+    return *this;
+}
+
+void JsonFragment::serialize(std::ostream& out) const {
+    size_t start = 0;
+    for (size_t nl; (nl = text.find('\n', start)) != std::string::npos; start = nl + 1) {
+        out.write(text.data() + start, nl - start);
+        out << IndentCtl::endl; }
+    out.write(text.data() + start, text.size() - start);
+}
+
 }  // namespace Util
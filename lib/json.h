@@ -19,12 +19,14 @@ limitations under the License.
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <type_traits>
 
 #include "gtest/gtest_prod.h"
 #include "lib/gmputil.h"
 #include "lib/cstring.h"
+#include "lib/flat_ordered_map.h"
 #include "lib/ordered_map.h"
 #include "lib/castable.h"
 
@@ -128,7 +130,7 @@ class JsonArray final : public IJson, public std::vector<IJson*> {
     JsonArray(std::vector<IJson*> &data) : std::vector<IJson*>(data) {} // NOLINT
 };
 
-class JsonObject final : public IJson, public ordered_map<cstring, IJson*> {
+class JsonObject final : public IJson, public flat_ordered_map<cstring, IJson*> {
     friend class Test::TestJson;
 
  public:
@@ -152,6 +154,62 @@ class JsonObject final : public IJson, public ordered_map<cstring, IJson*> {
     IJson* get(cstring label) const { return ::get(*this, label); }
 };
 
+/// Writes JSON directly to a stream, in the same format as IJson::serialize,
+/// without building a tree first.  Scalars in an array are held back until it
+/// is known whether the array contains only scalars, as this changes its layout.
+///
+///     JsonWriter(out).beginObject().field("id", 3).key("list")
+///         .beginArray().value(1).value("x").endArray().endObject();
+class JsonWriter {
+ public:
+    explicit JsonWriter(std::ostream &out) : out(out) {}
+    JsonWriter(const JsonWriter &) = delete;
+
+    JsonWriter &beginObject();
+    JsonWriter &endObject();
+    JsonWriter &beginArray();
+    JsonWriter &endArray();
+    /// Starts the next field of the current object; its value is written next.
+    JsonWriter &key(cstring label);
+    JsonWriter &value(const JsonValue &v);
+    template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    JsonWriter &value(T v) { return value(JsonValue(v)); }
+    JsonWriter &value(big_int v) { return value(JsonValue(v)); }
+    JsonWriter &value(cstring s) { return value(JsonValue(s)); }
+    JsonWriter &value(const std::string &s) { return value(JsonValue(s)); }
+    JsonWriter &value(const char *s) { return value(JsonValue(s)); }
+    /// Writes a tree; nullptr is written as null.
+    JsonWriter &json(const IJson *json);
+    template<typename T> JsonWriter &field(cstring label, T v) { return key(label).value(v); }
+
+ private:
+    struct Level {
+        bool object;
+        bool first = true;
+        bool small = true;              // an array of scalars so far
+        std::vector<std::string> held;  // scalars of a small array
+        explicit Level(bool object) : object(object) {}
+    };
+    std::ostream &out;
+    std::vector<Level> levels;
+    bool afterKey = false;
+
+    /// Writes what precedes a value which is not a scalar.
+    void beginElement();
+    void writeHeld(Level &level);
+};
+
+/// JSON text written separately (e.g. by a JsonWriter into a stringstream),
+/// which is indented to match its position when serialized.  Much smaller
+/// than the equivalent tree of JsonObjects.
+class JsonFragment final : public IJson {
+    std::string text;
+
+ public:
+    explicit JsonFragment(std::string text) : text(std::move(text)) {}
+    void serialize(std::ostream& out) const;
+};
+
 }  // namespace Util
 
 #endif  /* _LIB_JSON_H_ */
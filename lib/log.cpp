@@ -41,6 +41,7 @@ namespace Detail {
 
 int verbosity = 0;
 int maximumLogLevel = 0;
+std::atomic<uint32_t> logLevelGeneration{1};
 
 // The time at which logging was initialized; used so that log messages can have
 // relative rather than absolute timestamps.
@@ -278,6 +279,8 @@ void invalidateCaches(int possibleNewMaxLogLevel) {
     mostRecentInfo = nullptr;
     logLevelCache.clear();
     maximumLogLevel = std::max(maximumLogLevel, possibleNewMaxLogLevel);
+    // Skip 0, which CachedFileLogLevel uses for an empty cache.
+    if (++logLevelGeneration == 0) ++logLevelGeneration;
     for (auto fn : invalidateCallbacks) fn();
 }
 
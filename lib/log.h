@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _LIB_LOG_H_
 #define _LIB_LOG_H_
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <set>
@@ -37,10 +39,31 @@ extern int verbosity;
 // A cache of the maximum log level requested for any file.
 extern int maximumLogLevel;
 
+// Incremented whenever the log levels change (by -T or -v).
+extern std::atomic<uint32_t> logLevelGeneration;
+
 // Look up the log level of @file.
 int fileLogLevel(const char* file);
 std::ostream &fileLogOutput(const char *file);
 
+// The log level of one LOGGING statement, computed once for each generation of
+// the log levels, so that enabling logging for some file costs other files no
+// more than a load and a compare.
+class CachedFileLogLevel {
+    // The generation (never 0) in the high half, the level in the low half,
+    // read and written together.
+    std::atomic<uint64_t> cache{0};
+
+ public:
+    int get(const char* file) {
+        uint64_t value = cache.load(std::memory_order_relaxed);
+        uint32_t generation = logLevelGeneration.load(std::memory_order_relaxed);
+        if (static_cast<uint32_t>(value >> 32) != generation) {
+            value = uint64_t(generation) << 32 | static_cast<uint32_t>(fileLogLevel(file));
+            cache.store(value, std::memory_order_relaxed); }
+        return static_cast<int32_t>(value); }
+};
+
 // A utility class used to prepend file and log level information to logging output.
 // also controls indent control and locking for multithreaded use
 class OutputLogPrefix {
@@ -96,7 +119,15 @@ void increaseVerbosity();
 #define MAX_LOGGING_LEVEL 10
 #endif
 
-#define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL && ::Log::fileLogLevelIsAtLeast(__FILE__, N))
+// Levels above MAX_LOGGING_LEVEL are compiled out.  The others are checked
+// against the maximum level enabled for any file, then against a level cached
+// for each LOGGING statement.
+#define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL &&                                 \
+                    ::Log::Detail::maximumLogLevel >= (N) &&                    \
+                    [] {                                                        \
+                        static ::Log::Detail::CachedFileLogLevel cachedLevel;   \
+                        return cachedLevel.get(__FILE__);                       \
+                    }() >= (N))
 #define LOGN(N, X) (LOGGING(N)                                                  \
                       ? ::Log::Detail::fileLogOutput(__FILE__)                  \
                           << ::Log::Detail::OutputLogPrefix(__FILE__, N)        \
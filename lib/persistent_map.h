@@ -0,0 +1,361 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_PERSISTENT_MAP_H_
+#define LIB_PERSISTENT_MAP_H_
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* An ordered map with value semantics whose copies share their nodes, for dataflow facts
+ * which are copied at every branch and merged at every join of a ControlFlowVisitor.
+ *
+ * It is a treap whose priorities are hashes of the keys, so its shape only depends on the
+ * set of keys.  Copying the map is constant time.  A change copies the path from the root
+ * to the changed node, unless that path is not shared with another map, in which case it is
+ * done in place.  As two maps with a common ancestor share the subtrees neither changed,
+ * merge() skips those subtrees and so costs time proportional to the difference.
+ *
+ * The values cannot be changed through iterators: use operator[], update() or update_all().
+ * Values must be equality comparable, so that unchanged nodes stay shared.  Any change to the
+ * map invalidates its iterators and the references returned by operator[]. */
+template<class K, class V, class COMP = std::less<K>, class HASH = std::hash<K>>
+class persistent_map {
+ public:
+    typedef K                                   key_type;
+    typedef V                                   mapped_type;
+    typedef std::pair<const K, V>               value_type;
+    typedef COMP                                key_compare;
+    typedef size_t                              size_type;
+    typedef const value_type                    &const_reference;
+
+ private:
+    struct node {
+        value_type              value;
+        size_t                  priority;
+        std::shared_ptr<node>   left, right;
+        node(const K &k, size_t priority) : value(k, V()), priority(priority) {}
+    };
+    typedef std::shared_ptr<node>       ptr;
+
+    ptr                 root;
+    size_t              elements = 0;
+    COMP                comp;
+    HASH                hash;
+
+    size_t priority(const K &k) const {
+        // pointer keys (such as cstring) hash to aligned values, so mix the high bits in
+        size_t h = hash(k) * 0x9e3779b97f4a7c15ULL;
+        return h ^ (h >> 29); }
+    /// true if @a goes above @b in the tree; ties are broken by key so that the shape
+    /// is unique
+    bool above(const node &a, const node &b) const {
+        return a.priority > b.priority ||
+               (a.priority == b.priority && comp(a.value.first, b.value.first)); }
+    bool equal(const K &a, const K &b) const { return !comp(a, b) && !comp(b, a); }
+
+    /// make the node @p t points at one which may be changed in place
+    static node &own(ptr &t) {
+        if (t.use_count() > 1) t = std::make_shared<node>(*t);
+        return *t; }
+    static void rotate_right(ptr &t) {
+        ptr l = std::move(t->left);
+        t->left = std::move(l->right);
+        l->right = std::move(t);
+        t = std::move(l); }
+    static void rotate_left(ptr &t) {
+        ptr r = std::move(t->right);
+        t->right = std::move(r->left);
+        r->left = std::move(t);
+        t = std::move(r); }
+
+    V &insert(ptr &t, const K &k, size_t prio) {
+        if (!t) {
+            t = std::make_shared<node>(k, prio);
+            ++elements;
+            return t->value.second; }
+        node &n = own(t);
+        if (comp(k, n.value.first)) {
+            V &rv = insert(n.left, k, prio);
+            if (above(*n.left, n)) rotate_right(t);
+            return rv;
+        } else if (comp(n.value.first, k)) {
+            V &rv = insert(n.right, k, prio);
+            if (above(*n.right, n)) rotate_left(t);
+            return rv; }
+        return n.value.second; }
+
+    /// the treap with the nodes of @p l and @p r, all of whose keys are less than those of @p r
+    ptr join(const ptr &l, const ptr &r) const {
+        if (!l) return r;
+        if (!r) return l;
+        ptr rv;
+        if (above(*l, *r)) {
+            rv = std::make_shared<node>(*l);
+            rv->right = join(l->right, r);
+        } else {
+            rv = std::make_shared<node>(*r);
+            rv->left = join(l, r->left); }
+        return rv; }
+    ptr erase(const ptr &t, const K &k) {
+        if (!t) return t;
+        ptr rv;
+        if (comp(k, t->value.first)) {
+            ptr left = erase(t->left, k);
+            if (left == t->left) return t;
+            rv = std::make_shared<node>(*t);
+            rv->left = std::move(left);
+        } else if (comp(t->value.first, k)) {
+            ptr right = erase(t->right, k);
+            if (right == t->right) return t;
+            rv = std::make_shared<node>(*t);
+            rv->right = std::move(right);
+        } else {
+            --elements;
+            rv = join(t->left, t->right); }
+        return rv; }
+    /// split @p t into the nodes with keys less than @p k, the one with key @p k, if any,
+    /// and those with greater keys, copying only the nodes on the path to @p k
+    void split(const ptr &t, const K &k, ptr &l, const node *&match, ptr &r) const {
+        if (!t) {
+            l = r = nullptr;
+            return; }
+        if (comp(k, t->value.first)) {
+            ptr rest;
+            split(t->left, k, l, match, rest);
+            r = t;
+            if (rest != t->left) {
+                r = std::make_shared<node>(*t);
+                r->left = std::move(rest); }
+        } else if (comp(t->value.first, k)) {
+            ptr rest;
+            split(t->right, k, rest, match, r);
+            l = t;
+            if (rest != t->right) {
+                l = std::make_shared<node>(*t);
+                l->right = std::move(rest); }
+        } else {
+            l = t->left;
+            match = t.get();
+            r = t->right; } }
+
+    /// @returns @p t with @p left, @p right and @p value, reusing @p t if nothing changed,
+    /// and changing it in place if it is not @p shared
+    static ptr rebuild(const ptr &t, ptr &&left, ptr &&right, V &&value, bool shared) {
+        if (left == t->left && right == t->right && value == t->value.second) return t;
+        ptr rv = shared ? std::make_shared<node>(*t) : t;
+        rv->left = std::move(left);
+        rv->right = std::move(right);
+        rv->value.second = std::move(value);
+        return rv; }
+    template<class F> static ptr update_all(const ptr &t, F &fn, bool shared) {
+        if (!t) return t;
+        shared |= t.use_count() > 1;
+        ptr left = update_all(t->left, fn, shared);
+        ptr right = update_all(t->right, fn, shared);
+        V value = t->value.second;
+        fn(t->value.first, value);
+        return rebuild(t, std::move(left), std::move(right), std::move(value), shared); }
+    template<class F> ptr merge(const ptr &a, const ptr &b, F &fn, bool shared) const {
+        if (!a || a == b) return a;
+        if (!b) {
+            auto missing = [&fn](const K &k, V &v) { fn(k, v, nullptr); };
+            return update_all(a, missing, shared); }
+        shared |= a.use_count() > 1;
+        if (above(*b, *a)) {
+            // b's root is not in a, or it would be above a's root; look for a's nodes on
+            // both sides of it
+            ptr al, ar, left, right;
+            const node *match = nullptr;
+            split(a, b->value.first, al, match, ar);
+            left = merge(al, b->left, fn, true);
+            right = merge(ar, b->right, fn, true);
+            if (left == al && right == ar) return a;
+            return join(left, right); }
+        ptr bl, br;
+        const node *match = nullptr;
+        split(b, a->value.first, bl, match, br);
+        ptr left = merge(a->left, bl, fn, shared);
+        ptr right = merge(a->right, br, fn, shared);
+        V value = a->value.second;
+        fn(a->value.first, value, match ? &match->value.second : nullptr);
+        return rebuild(a, std::move(left), std::move(right), std::move(value), shared); }
+    static size_t count_nodes(const node *t) {
+        return t ? 1 + count_nodes(t->left.get()) + count_nodes(t->right.get()) : 0; }
+    template<class F> ptr unite(const ptr &a, const ptr &b, F &fn, bool shared) {
+        if (!a) {
+            elements += count_nodes(b.get());
+            return b; }
+        if (!b || a == b) return a;
+        shared |= a.use_count() > 1;
+        if (above(*b, *a)) {
+            // b's root is not in a, so it becomes the root of the result
+            ptr al, ar;
+            const node *match = nullptr;
+            split(a, b->value.first, al, match, ar);
+            ptr left = unite(al, b->left, fn, true);
+            ptr right = unite(ar, b->right, fn, true);
+            ++elements;
+            if (left == b->left && right == b->right) return b;
+            ptr rv = std::make_shared<node>(*b);
+            rv->left = std::move(left);
+            rv->right = std::move(right);
+            return rv; }
+        ptr bl, br;
+        const node *match = nullptr;
+        split(b, a->value.first, bl, match, br);
+        ptr left = unite(a->left, bl, fn, shared);
+        ptr right = unite(a->right, br, fn, shared);
+        V value = a->value.second;
+        if (match) fn(a->value.first, value, match->value.second);
+        return rebuild(a, std::move(left), std::move(right), std::move(value), shared); }
+
+ public:
+    class const_iterator {
+        friend class persistent_map;
+        std::vector<const node *>       stack;  // the nodes whose left subtrees we are in
+        void descend(const node *n) {
+            for (; n; n = n->left.get()) stack.push_back(n); }
+
+     public:
+        typedef std::forward_iterator_tag       iterator_category;
+        typedef typename persistent_map::value_type     value_type;
+        typedef ptrdiff_t                       difference_type;
+        typedef const value_type                *pointer;
+        typedef const value_type                &reference;
+
+        const_iterator() = default;
+        reference operator*() const { return stack.back()->value; }
+        pointer operator->() const { return &stack.back()->value; }
+        const_iterator &operator++() {
+            const node *n = stack.back();
+            stack.pop_back();
+            descend(n->right.get());
+            return *this; }
+        const_iterator operator++(int) { auto rv = *this; ++*this; return rv; }
+        bool operator==(const const_iterator &a) const {
+            if (stack.empty() || a.stack.empty()) return stack.empty() == a.stack.empty();
+            return stack.back() == a.stack.back(); }
+        bool operator!=(const const_iterator &a) const { return !(*this == a); }
+    };
+    typedef const_iterator iterator;
+
+    persistent_map() = default;
+    persistent_map(std::initializer_list<std::pair<K, V>> il) {
+        for (auto &el : il) (*this)[el.first] = el.second; }
+
+    size_type size() const { return elements; }
+    bool empty() const { return elements == 0; }
+    void clear() { root.reset(); elements = 0; }
+
+    const_iterator begin() const {
+        const_iterator rv;
+        rv.descend(root.get());
+        return rv; }
+    const_iterator end() const { return const_iterator(); }
+    const_iterator lower_bound(const K &k) const {
+        const_iterator rv;
+        for (const node *n = root.get(); n;) {
+            if (comp(n->value.first, k)) {
+                n = n->right.get();
+            } else {
+                rv.stack.push_back(n);
+                n = n->left.get(); } }
+        return rv; }
+    const_iterator upper_bound(const K &k) const {
+        const_iterator rv;
+        for (const node *n = root.get(); n;) {
+            if (comp(k, n->value.first)) {
+                rv.stack.push_back(n);
+                n = n->left.get();
+            } else {
+                n = n->right.get(); } }
+        return rv; }
+    const_iterator find(const K &k) const {
+        auto rv = lower_bound(k);
+        return rv != end() && equal(rv->first, k) ? rv : end(); }
+    size_type count(const K &k) const { return find(k) != end(); }
+    const V &at(const K &k) const {
+        auto it = find(k);
+        if (it == end()) throw std::out_of_range("persistent_map::at");
+        return it->second; }
+
+    /// @returns the value of @p k for modification, inserting a default value if it is not
+    /// in the map
+    V &operator[](const K &k) { return insert(root, k, priority(k)); }
+    size_type erase(const K &k) {
+        size_t before = elements;
+        root = erase(root, k);
+        return before - elements; }
+    /// Changes the value of @p k, if it is in the map, by calling @p fn(V &).
+    /// @returns false if @p k is not in the map.
+    template<class F> bool update(const K &k, F fn) {
+        auto it = find(k);
+        if (it == end()) return false;
+        V value = it->second;
+        fn(value);
+        if (!(value == it->second))
+            (*this)[k] = std::move(value);
+        return true; }
+    /// Changes all values by calling @p fn(const K &, V &) for each of them, in key order.
+    template<class F> void update_all(F fn) { root = update_all(root, fn, false); }
+    /// Merges @p other into this map by calling @p fn(const K &, V &value, const V *other)
+    /// for every key in this map, where @p other is the value of the key in @p other, or
+    /// nullptr if it is not there.  Keys which are only in @p other are not added.  The
+    /// subtrees that the maps share are skipped, so @p fn must leave a value merged with
+    /// itself unchanged.
+    template<class F> void merge(const persistent_map &other, F fn) {
+        root = merge(root, other.root, fn, false); }
+    /// Adds the keys of @p other to this map, calling @p fn(const K &, V &value,
+    /// const V &other) for every key which is in both maps; the keys which are only in one
+    /// of them keep their value.  As for merge(), shared subtrees are skipped.
+    template<class F> void unite(const persistent_map &other, F fn) {
+        root = unite(root, other.root, fn, false); }
+
+    bool operator==(const persistent_map &a) const {
+        if (root == a.root) return true;
+        if (elements != a.elements) return false;
+        for (auto i = begin(), j = a.begin(); i != end(); ++i, ++j)
+            if (!equal(i->first, j->first) || !(i->second == j->second)) return false;
+        return true; }
+    bool operator!=(const persistent_map &a) const { return !(*this == a); }
+};
+
+namespace GetImpl {
+
+template<class K, class T, class V, class Comp, class Hash>
+inline V get(const persistent_map<K, V, Comp, Hash> &m, T key, V def = V()) {
+    auto it = m.find(key);
+    if (it != m.end()) return it->second;
+    return def; }
+
+/* only a const reference, as the values cannot be changed in place */
+template<class K, class T, class V, class Comp, class Hash>
+inline const V *getref(const persistent_map<K, V, Comp, Hash> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* LIB_PERSISTENT_MAP_H_ */
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <string.h>
 #include <sstream>
 
 #include <algorithm>
@@ -58,7 +59,7 @@ cstring SourceInfo::toDebugString() const {
 
 InputSources::InputSources() : sealed(false) {
     mapLine(nullptr, 1);  // the first line read will be line 1 of stdin
-    contents.push_back("");
+    lineStarts.push_back(0);
 }
 
 void InputSources::addComment(SourceInfo srcInfo, bool singleLine, cstring body) {
@@ -78,8 +79,8 @@ void InputSources::seal() {
 }
 
 unsigned InputSources::lineCount() const {
-    int size = contents.size();
-    if (contents.back().empty()) {
+    int size = lineStarts.size();
+    if (lineStarts.back() == length) {
         // do not count the last line if it is empty.
         size -= 1;
         if (size < 0)
@@ -88,58 +89,54 @@ unsigned InputSources::lineCount() const {
     return size;
 }
 
-// Append this text to the last line
-void InputSources::appendToLastLine(StringRef text) {
+void InputSources::useBuffer(const char* text, size_t size) {
+    if (sealed)
+        BUG("Changing the buffer of sealed InputSources");
+    BUG_CHECK(length == 0, "InputSources already has text");
+    buffer = text;
+    bufferSize = size;
+}
+
+void InputSources::useBuffer(std::string&& text) {
+    keptBuffer = std::move(text);
+    useBuffer(keptBuffer.data(), keptBuffer.size());
+}
+
+// Append text, which may contain newlines
+void InputSources::append(StringRef text) {
     if (sealed)
         BUG("Appending to sealed InputSources");
+    if (buffer && (text.len > bufferSize - length ||
+                   memcmp(buffer + length, text.p, text.len) != 0)) {
+        // The lexer did not read the buffer as expected (e.g., it contains a NUL
+        // character), so copy the text read so far and stop using the buffer.
+        contents.assign(buffer, length);
+        buffer = nullptr; }
+    if (!buffer)
+        contents.append(text.p, text.len);
+    const char* end = text.p + text.len;
+    for (const char* nl = text.p; (nl = static_cast<const char*>(memchr(nl, '\n', end - nl))); ++nl)
+        lineStarts.push_back(length + (nl - text.p) + 1);
+    length += text.len;
+}
+
+// Append this text to the last line
+void InputSources::appendToLastLine(StringRef text) {
     // Text should not contain any newline characters
-    for (size_t i = 0; i < text.len; i++) {
-        char c = text[i];
-        if (c == '\n')
-            BUG("Text contains newlines");
-    }
-    contents.back() += text.toString();
+    if (text.find('\n'))
+        BUG("Text contains newlines");
+    append(text);
 }
 
 // Append a newline and start a new line
 void InputSources::appendNewline(StringRef newline) {
-    if (sealed)
-        BUG("Appending to sealed InputSources");
-    contents.back() += newline.toString();
-    contents.push_back("");  // start a new line
+    append(newline);
 }
 
 void InputSources::appendText(const char* text) {
     if (text == nullptr)
         BUG("Null text being appended");
-    StringRef ref = text;
-
-    while (ref.len > 0) {
-        const char* nl = ref.find("\r\n");
-        if (nl == nullptr) {
-            appendToLastLine(ref);
-            break;
-        }
-
-        size_t toCut = nl - ref.p;
-        if (toCut != 0) {
-            StringRef nonnl(ref.p, toCut);
-            appendToLastLine(nonnl);
-            ref += toCut;
-        } else {
-            if (ref[0] == '\n') {
-                appendNewline("\n");
-                ref += 1;
-            } else if (ref.len > 2 && ref[0] == '\r' && ref[1] == '\n') {
-                appendNewline("\r\n");
-                ref += 2;
-            } else {
-                // Just \r
-                appendToLastLine(ref.substr(0, 1));
-                ref += 1;
-            }
-        }
-    }
+    append(text);
 }
 
 cstring InputSources::getLine(unsigned lineNumber) const {
@@ -149,7 +146,9 @@ cstring InputSources::getLine(unsigned lineNumber) const {
         // don't throw: this code may be called by exceptions
         // reporting on elements that have no source position
     }
-    return contents.at(lineNumber - 1);
+    size_t start = lineStarts.at(lineNumber - 1);
+    size_t end = lineNumber < lineStarts.size() ? lineStarts[lineNumber] : length;
+    return cstring(data() + start, end - start);
 }
 
 void InputSources::mapLine(cstring file, unsigned originalSourceLineNo) {
@@ -181,12 +180,12 @@ SourceFileLine InputSources::getSourceLine(unsigned line) const {
 }
 
 unsigned InputSources::getCurrentLineNumber() const {
-    return contents.size();
+    return lineStarts.size();
 }
 
 SourcePosition InputSources::getCurrentPosition() const {
     unsigned line = getCurrentLineNumber();
-    unsigned column = contents.back().size();
+    unsigned column = length - lineStarts.back();
     return SourcePosition(line, column);
 }
 
@@ -267,8 +266,7 @@ cstring InputSources::getBriefSourceFragment(const SourceInfo &position) const {
 
 cstring InputSources::toDebugString() const {
     std::stringstream builder;
-    for (auto line : contents)
-        builder << line;
+    builder.write(data(), length);
     builder << "---------------" << std::endl;
     for (auto lf : line_file_map)
         builder << lf.first << ": " << lf.second.toString() << std::endl;
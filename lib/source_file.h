@@ -21,6 +21,7 @@ limitations under the License.
 #ifndef _LIB_SOURCE_FILE_H_
 #define _LIB_SOURCE_FILE_H_
 
+#include <string>
 #include <vector>
 
 #include "gtest/gtest_prod.h"
@@ -311,6 +312,16 @@ class InputSources final {
     /// Append this text; it is either a newline or a text with no newlines.
     void appendText(const char* text);
 
+    /**
+       The text appended from now on is a copy of the @size bytes at @text, which
+       must stay valid as long as this object: the lines then refer to that buffer
+       (e.g., a file mapped into memory) instead of holding copies of the text. */
+    void useBuffer(const char* text, size_t size);
+    /// Like useBuffer, for a buffer kept by this object.
+    void useBuffer(std::string&& text);
+    /// The buffer passed to useBuffer, if any.
+    StringRef getBuffer() const { return buffer ? StringRef(buffer, bufferSize) : StringRef(); }
+
     /**
         Map the next line in the file to the line with number 'originalSourceLine'
         from file 'file'. */
@@ -333,14 +344,27 @@ class InputSources final {
     void appendToLastLine(StringRef text);
     /// Append a newline and start a new line
     void appendNewline(StringRef newline);
+    /// Append text which may contain newlines
+    void append(StringRef text);
+    /// The text of all the lines
+    const char* data() const { return buffer ? buffer : contents.data(); }
 
     /// Input program that is being currently compiled; there can be only one.
     bool sealed;
 
     std::map<unsigned, SourceFileLine> line_file_map;
 
-    /// Each line also stores the end-of-line character(s)
-    std::vector<std::string> contents;
+    /// The text of the program, unless it is in 'buffer'.  Each line also
+    /// stores the end-of-line character(s).
+    std::string contents;
+    /// The buffer set with useBuffer, and the buffer kept for useBuffer(std::string&&).
+    const char* buffer = nullptr;
+    size_t bufferSize = 0;
+    std::string keptBuffer;
+    /// The length of the text appended so far
+    size_t length = 0;
+    /// The offset of the start of each line in the text
+    std::vector<size_t> lineStarts;
     /// The commends found in the file.
     std::vector<Comment*> comments;
 };
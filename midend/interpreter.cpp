@@ -247,10 +247,16 @@ SymbolicStruct::SymbolicStruct(const IR::Type_StructLike* type, bool uninitializ
     }
 }
 
+void SymbolicStruct::cloneFields(SymbolicStruct* result) const {
+    // The fields are visited in order, so each one is inserted at the end
+    // without searching the map.
+    for (auto &f : fieldValue)
+        result->fieldValue.emplace_hint(result->fieldValue.end(), f.first, f.second->clone());
+}
+
 SymbolicValue* SymbolicStruct::clone() const {
     auto result = new SymbolicStruct(type->to<IR::Type_StructLike>());
-    for (auto f : fieldValue)
-        result->fieldValue[f.first] = f.second->clone();
+    cloneFields(result);
     return result;
 }
 
@@ -347,8 +353,7 @@ void SymbolicHeaderUnion::setAllUnknown() {
 
 SymbolicValue* SymbolicHeaderUnion::clone() const {
     auto result = new SymbolicHeaderUnion(type->to<IR::Type_HeaderUnion>());
-    for (auto f : fieldValue)
-        result->fieldValue[f.first] = f.second->clone();
+    cloneFields(result);
     return result;
 }
 
@@ -411,8 +416,7 @@ void SymbolicHeader::setAllUnknown() {
 
 SymbolicValue* SymbolicHeader::clone() const {
     auto result = new SymbolicHeader(type->to<IR::Type_Header>());
-    for (auto f : fieldValue)
-        result->fieldValue[f.first] = f.second->clone();
+    cloneFields(result);
     result->valid = valid->clone()->to<SymbolicBool>();
     return result;
 }
@@ -565,8 +569,9 @@ void SymbolicArray::setAllUnknown() {
 
 SymbolicValue* SymbolicArray::clone() const {
     auto result = new SymbolicArray(type->to<IR::Type_Stack>());
-    for (unsigned i=0; i < values.size(); i++)
-        result->values.push_back(get(nullptr, i)->clone()->to<SymbolicStruct>());
+    result->values.reserve(values.size());
+    for (auto v : values)
+        result->values.push_back(v->clone()->to<SymbolicStruct>());
     return result;
 }
 
@@ -651,8 +656,9 @@ void SymbolicTuple::setAllUnknown() {
 
 SymbolicValue* SymbolicTuple::clone() const {
     auto result = new SymbolicTuple(type->to<IR::Type_Tuple>());
-    for (unsigned i=0; i < values.size(); i++)
-        result->values.push_back(get(i)->clone());
+    result->values.reserve(values.size());
+    for (auto v : values)
+        result->values.push_back(v->clone());
     return result;
 }
 
@@ -1160,8 +1166,8 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression* expression)
                 auto arg0 = expression->arguments->at(0);
                 auto argType = typeMap->getType(arg0, true);
                 auto hdr = get(arg0->expression);
-                bool fixed = factory->isFixedWidth(argType);
-                unsigned width = factory->getWidth(argType);
+                bool fixed = factory.isFixedWidth(argType);
+                unsigned width = factory.getWidth(argType);
                 // For variable-sized objects width is the "minimum" width.
 
                 if (expression->arguments->size() == 1) {
@@ -1221,7 +1227,7 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression* expression)
             } else if (em->method->name.name == P4CoreLibrary::instance.packetIn.lookahead.name) {
                 // If lookahead returns a header, it is always valid.
                 auto type = typeMap->getTypeType(mi->actualMethodType->returnType, true);
-                auto res = factory->create(type, false);
+                auto res = factory.create(type, false);
                 if (auto sh = res->to<SymbolicHeader>()) {
                     sh->setValid(true);
                 }
@@ -1246,7 +1252,7 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression* expression)
         set(expression, SymbolicVoid::get());
     } else {
         auto type = typeMap->getTypeType(mi->actualMethodType->returnType, true);
-        auto res = factory->create(type, false);
+        auto res = factory.create(type, false);
         set(expression, res);
     }
 }
@@ -79,8 +79,8 @@ class ValueMap final : public IHasDbPrint {
     std::map<const IR::IDeclaration*, SymbolicValue*> map;
     ValueMap* clone() const {
         auto result = new ValueMap();
-        for (auto v : map)
-            result->map.emplace(v.first, v.second->clone());
+        for (auto &v : map)
+            result->map.emplace_hint(result->map.end(), v.first, v.second->clone());
         return result;
     }
     ValueMap* filter(std::function<bool(const IR::IDeclaration*, const SymbolicValue*)> filter) {
@@ -130,7 +130,7 @@ class ExpressionEvaluator : public Inspector {
     ReferenceMap*       refMap;
     TypeMap*            typeMap;  // updated if constant folding happens
     ValueMap*           valueMap;
-    const SymbolicValueFactory* factory;
+    const SymbolicValueFactory factory;
     bool evaluatingLeftValue = false;
 
     std::map<const IR::Expression*, SymbolicValue*> value;
@@ -159,9 +159,8 @@ class ExpressionEvaluator : public Inspector {
 
  public:
     ExpressionEvaluator(ReferenceMap* refMap, TypeMap* typeMap, ValueMap* valueMap) :
-            refMap(refMap), typeMap(typeMap), valueMap(valueMap) {
+            refMap(refMap), typeMap(typeMap), valueMap(valueMap), factory(typeMap) {
         CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(valueMap);
-        factory = new SymbolicValueFactory(typeMap);
     }
 
     // May mutate the valueMap, when evaluating expression with side-effects.
@@ -396,6 +395,10 @@ class SymbolicStruct : public SymbolicValue {
     bool merge(const SymbolicValue* other) override;
     bool equals(const SymbolicValue* other) const override;
     bool hasUninitializedParts() const override;
+
+ protected:
+    /// Adds clones of all fields to @p result, which has none.
+    void cloneFields(SymbolicStruct* result) const;
 };
 
 class SymbolicHeader : public SymbolicStruct {
@@ -161,14 +161,14 @@ class DoLocalCopyPropagation::RewriteTableKeys : public Transform {
 void DoLocalCopyPropagation::flow_merge(Visitor &a_) {
     auto &a = dynamic_cast<DoLocalCopyPropagation &>(a_);
     BUG_CHECK(working == a.working, "inconsitent DoLocalCopyPropagation state on merge");
-    for (auto &var : available) {
-        if (auto merge = ::getref(a.available, var.first)) {
-            if (merge->val != var.second.val)
-                var.second.val = nullptr;
+    available.merge(a.available, [](cstring, VarInfo &var, const VarInfo *merge) {
+        if (merge) {
+            if (merge->val != var.val)
+                var.val = nullptr;
             if (merge->live)
-                var.second.live = true;
+                var.live = true;
         } else {
-            var.second.val = nullptr; } }
+            var.val = nullptr; } });
     need_key_rewrite |= a.need_key_rewrite;
 }
 
@@ -184,29 +184,33 @@ bool DoLocalCopyPropagation::name_overlap(cstring name1, cstring name2) {
 
 void DoLocalCopyPropagation::forOverlapAvail(cstring name,
                                              std::function<void(cstring, VarInfo *)> fn) {
+    std::vector<cstring> overlap;
     for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
         pfx += strcspn(pfx, ".[");
         auto it = available.find(name.before(pfx));
         if (it != available.end())
-            fn(it->first, &it->second); }
+            overlap.push_back(it->first); }
     for (auto it = available.upper_bound(name); it != available.end(); ++it) {
         if (!it->first.startsWith(name) || !strchr(".[", it->first.get(name.size())))
             break;
-        fn(it->first, &it->second); }
+        overlap.push_back(it->first); }
+    // the values are only changed after the search, as that invalidates the iterators
+    for (auto var : overlap)
+        available.update(var, [var, &fn](VarInfo &info) { fn(var, &info); });
 }
 
 void DoLocalCopyPropagation::dropValuesUsing(cstring name) {
     LOG6("dropValuesUsing(" << name << ")");
-    for (auto &var : available) {
-        LOG7("  checking " << var.first << " = " << var.second.val);
-        if (name_overlap(var.first, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << "as " << name <<
+    available.update_all([this, name](cstring var, VarInfo &info) {
+        LOG7("  checking " << var << " = " << info.val);
+        if (name_overlap(var, name)) {
+            LOG4("   dropping " << (info.val ? "" : "(nop) ") << "as " << name <<
                  " is being assigned to");
-            var.second.val = nullptr;
-        } else if (var.second.val && exprUses(var.second.val, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << var.first <<
+            info.val = nullptr;
+        } else if (info.val && exprUses(info.val, name)) {
+            LOG4("   dropping " << (info.val ? "" : "(nop) ") << var <<
                  " as it uses " << name);
-            var.second.val = nullptr; } }
+            info.val = nullptr; } });
 }
 
 void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *var) {
@@ -269,7 +273,7 @@ const IR::Expression *DoLocalCopyPropagation::copyprop_name(
             LOG3("  policy rejects propagation of " << name << ": " << var->val);
         } else {
             LOG4("  using " << name << " with no propagated value"); }
-        var->live = true; }
+        available.update(name, [](VarInfo &info) { info.live = true; }); }
     forOverlapAvail(name, [name](cstring, VarInfo *var) {
         LOG4("  using part of " << name);
         var->live = true; });
@@ -458,14 +462,14 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
             // maybe should have annotations if it does
             return mc; } }
     LOG3("unknown method call " << mc->method << " clears all nonlocal saved values");
-    for (auto &var : available) {
-        if (!var.second.local) {
-            LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-            var.second.live = true;
+    available.update_all([this](cstring var, VarInfo &info) {
+        if (!info.local) {
+            LOG7("    may access non-local " << var);
+            info.val = nullptr;
+            info.live = true;
             if (inferForFunc) {
-                inferForFunc->reads.insert(var.first);
-                inferForFunc->writes.insert(var.first); } } }
+                inferForFunc->reads.insert(var);
+                inferForFunc->writes.insert(var); } } });
     return mc;
 }
 
@@ -590,8 +594,11 @@ void DoLocalCopyPropagation::apply_table(DoLocalCopyPropagation::TableInfo *tbl)
         forOverlapAvail(key, [&remaps_seen, key, tbl, this](cstring vname, VarInfo *var) {
             remaps_seen.insert(vname);
             if (var->val && lvalue_out(var->val)->is<IR::PathExpression>()) {
+                // the values used in earlier applies are compared on every apply, so
+                // compare their hashes first
                 if (tbl->apply_count > 1 &&
-                    (!tbl->key_remap.count(vname) || !tbl->key_remap.at(vname)->equiv(*var->val))) {
+                    (!tbl->key_remap.count(vname) ||
+                     !IR::equivHashed(tbl->key_remap.at(vname), var->val))) {
                     LOG3("  different values used in different applies for key " << key);
                     tbl->key_remap.erase(vname);
                     var->live = true;
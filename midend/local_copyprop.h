@@ -17,6 +17,7 @@ limitations under the License.
 #define MIDEND_LOCAL_COPYPROP_H_
 
 #include "ir/ir.h"
+#include "lib/persistent_map.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "has_side_effects.h"
@@ -57,6 +58,8 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
         bool                    local = false;
         bool                    live = false;
         const IR::Expression    *val = nullptr;
+        bool operator==(const VarInfo &a) const {
+            return local == a.local && live == a.live && val == a.val; }
     };
     struct TableInfo {
         std::set<cstring>       keyreads, actions;
@@ -73,7 +76,8 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
         /// values on the left and the right side, the assignment becomes a self-assignment
         bool                    is_first_write_insert = false;
     };
-    std::map<cstring, VarInfo>          available;
+    /// Copied by every flow_clone, so shared between the branches until they change it.
+    persistent_map<cstring, VarInfo>    available;
     std::map<cstring, TableInfo>        &tables;
     std::map<cstring, FuncInfo>         &actions;
     std::map<cstring, FuncInfo>         &methods;
@@ -308,6 +308,9 @@ class ParserSymbolicInterpreter {
     bool                unroll;
     StatesVisitedMap    visitedStates;
     bool&               wasError;
+    /// Statistics of the symbolic evaluation.
+    size_t              statesEvaluated = 0;
+    size_t              statesSkipped = 0;
 
     ValueMap* initializeVariables() {
         wasError = false;
@@ -356,8 +359,8 @@ class ParserSymbolicInterpreter {
             stateName == IR::ParserState::reject)
             return nullptr;
         auto state = structure->get(stateName);
-        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values->clone(),
-                                      index);
+        // The successors share the values: evaluateState() clones them before changing them.
+        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values, index);
         synthesizedParser->add(pi);
         return pi;
     }
@@ -676,15 +679,18 @@ class ParserSymbolicInterpreter {
     EvaluationStateResult evaluateState(ParserStateInfo* state,
                                         std::unordered_set<cstring> &newStates) {
         LOG1("Analyzing " << dbp(state->state));
-        auto valueMap = state->before->clone();
         IR::IndexedVector<IR::StatOrDecl> components;
         IR::ID newName;
         if (unroll) {
             newName = getNewName(state);
-            if (newStates.count(newName))
+            if (newStates.count(newName)) {
+                ++statesSkipped;
                 return EvaluationStateResult(nullptr, false);
+            }
             newStates.insert(newName);
         }
+        ++statesEvaluated;
+        auto valueMap = state->before->clone();
         for (auto s : state->state->components) {
             auto* newComponent = executeStatement(state, s, valueMap);
             if (!newComponent)
@@ -798,6 +804,9 @@ class ParserSymbolicInterpreter {
             toRun.insert(toRun.end(), nextStates.first->begin(), nextStates.first->end());
         }
 
+        LOG1("Parser " << parser->externalName() << ": evaluated " << statesEvaluated <<
+             " states, skipped " << statesSkipped << " already generated states, generated " <<
+             newStates.size() << " states");
         return synthesizedParser;
     }
 };
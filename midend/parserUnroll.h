@@ -74,7 +74,7 @@ struct ParserStateInfo {
     const IR::P4Parser*             parser;
     const IR::ParserState*          state;  // original state this is produced from
     const ParserStateInfo*          predecessor;     // how we got here in the symbolic evaluation
-    ValueMap*                       before;
+    ValueMap*                       before;          // shared with the siblings; do not modify
     ValueMap*                       after;
     IR::ParserState*                newState;        // pointer to a new state
     size_t                          currentIndex;
@@ -0,0 +1,148 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "lib/arena.h"
+
+namespace Test {
+
+TEST(Arena, allocate) {
+    Util::Arena arena(4096);
+    auto *a = static_cast<char *>(arena.allocate(10));
+    auto *b = static_cast<char *>(arena.allocate(100));
+    auto *big = static_cast<char *>(arena.allocate(10000));
+    std::memset(a, 1, 10);
+    std::memset(big, 2, 10000);
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0u);
+    EXPECT_EQ(b, a + 16);
+    EXPECT_TRUE(arena.contains(a));
+    EXPECT_TRUE(arena.contains(big + 9999));
+    EXPECT_FALSE(arena.contains(&arena));
+    EXPECT_EQ(Util::Arena::owner(b), &arena);
+
+    auto stats = arena.stats();
+    EXPECT_EQ(stats.allocations, 3u);
+    EXPECT_EQ(stats.bytes, 16u + 112u + 10000u);
+    EXPECT_EQ(stats.chunks, 2u);
+    EXPECT_EQ(stats.reserved, 4096u + 10000u);
+
+    arena.release();
+    stats = arena.stats();
+    EXPECT_FALSE(arena.contains(a));
+    EXPECT_EQ(Util::Arena::owner(b), nullptr);
+    EXPECT_EQ(stats.chunks, 0u);
+    EXPECT_EQ(stats.released, 4096u + 10000u);
+
+    // the arena can be used again after a release
+    auto *c = static_cast<char *>(arena.allocate(10));
+    EXPECT_TRUE(arena.contains(c));
+    EXPECT_EQ(arena.stats().chunks, 1u);
+}
+
+TEST(Arena, owner) {
+    std::vector<Util::Arena *> arenas;
+    std::vector<void *> objects;
+    for (int i = 0; i < 100; ++i) {
+        arenas.push_back(new Util::Arena(4096));
+        objects.push_back(arenas.back()->allocate(100));
+        objects.push_back(arenas.back()->allocate(4000)); }
+    for (size_t i = 0; i < objects.size(); ++i)
+        EXPECT_EQ(Util::Arena::owner(objects[i]), arenas[i / 2]);
+    int local;
+    EXPECT_EQ(Util::Arena::owner(&local), nullptr);
+    for (auto *arena : arenas)
+        delete arena;
+    EXPECT_EQ(Util::Arena::owner(objects.front()), nullptr);
+}
+
+TEST(Arena, scope) {
+    Util::Arena outer, inner;
+    auto *prev = Util::Arena::current();
+    {
+        Util::Arena::Scope s1(&outer);
+        EXPECT_EQ(Util::Arena::current(), &outer);
+        {
+            Util::Arena::Scope s2(&inner);
+            EXPECT_EQ(Util::Arena::current(), &inner);
+        }
+        EXPECT_EQ(Util::Arena::current(), &outer);
+    }
+    EXPECT_EQ(Util::Arena::current(), prev);
+}
+
+TEST(Arena, nodes) {
+    Util::Arena arena;
+    const IR::Constant *outside = new IR::Constant(1);
+    const IR::Constant *inside;
+    const IR::Node *copy;
+    const IR::Type *type;
+    {
+        Util::Arena::Scope allocateIn(&arena);
+        inside = new IR::Constant(2);
+        copy = outside->clone();
+        type = IR::Type_Bits::get(13);
+        auto *temp = new IR::Constant(3);
+        EXPECT_TRUE(arena.contains(temp));
+        delete temp;  // a no-op for nodes in an arena
+    }
+    EXPECT_EQ(Util::Arena::owner(outside), nullptr);
+    EXPECT_EQ(Util::Arena::owner(inside), &arena);
+    EXPECT_EQ(Util::Arena::owner(copy), &arena);
+    EXPECT_TRUE(copy->equiv(*outside));
+    EXPECT_EQ(inside->value, 2);
+    // shared types outlive the arena
+    EXPECT_EQ(Util::Arena::owner(type), nullptr);
+    EXPECT_GE(arena.stats().allocations, 3u);
+    arena.release();
+    EXPECT_EQ(IR::Type_Bits::get(13), type);
+}
+
+#ifdef MULTITHREAD
+TEST(Arena, threads) {
+    constexpr int threads = 8, perThread = 10000;
+    Util::Arena arena(4096);
+    std::vector<std::vector<char *>> allocated(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < perThread; ++i) {
+                auto *p = static_cast<char *>(arena.allocate(32));
+                std::memset(p, t, 32);
+                allocated[t].push_back(p); } });
+    for (auto &worker : workers)
+        worker.join();
+
+    std::set<char *> all;
+    for (int t = 0; t < threads; ++t) {
+        for (auto *p : allocated[t]) {
+            EXPECT_EQ(*p, t);
+            EXPECT_EQ(Util::Arena::owner(p), &arena);
+            all.insert(p); } }
+    // no object was handed out twice
+    EXPECT_EQ(all.size(), size_t(threads * perThread));
+    auto stats = arena.stats();
+    EXPECT_EQ(stats.allocations, size_t(threads * perThread));
+    EXPECT_EQ(stats.bytes, size_t(threads * perThread * 32));
+}
+#endif  // MULTITHREAD
+
+}  // namespace Test
@@ -0,0 +1,75 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "ir/binary_loader.h"
+#include "ir/ir.h"
+#include "lib/exceptions.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+
+namespace Test {
+
+class P4CBinaryIR : public P4CTest { };
+
+TEST_F(P4CBinaryIR, roundTrip) {
+    std::string source = P4_SOURCE(R"(
+        header H { bit<8> f; bit<100> big; }
+        struct S { H h; H[2] stack; }
+        enum bit<2> E { A = 1, B = 2 }
+        control c(inout S s) {
+            action a(bit<8> v) { s.h.f = v; s.h.big = 100w0x1234567890abcdef0123; }
+            table t {
+                key = { s.h.f : exact; }
+                actions = { a; }
+                const entries = { 8w1 : a(8w2); }
+            }
+            apply { t.apply(); }
+        }
+    )");
+    auto program = parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    std::stringstream binary;
+    BinaryGenerator(binary, true).emit(program);
+    std::string bytes = binary.str();
+    BinaryLoader loader(bytes.data(), bytes.size());
+    ASSERT_TRUE(loader.valid());
+    const IR::Node *node = nullptr;
+    loader >> node;
+    ASSERT_TRUE(node != nullptr && node->is<IR::P4Program>());
+    EXPECT_EQ(program->id, node->id);
+    EXPECT_EQ(program->srcInfo.toPositionString(), node->srcInfo.toPositionString());
+
+    // The reloaded IR must be the same as the original one.
+    std::stringstream expected, actual;
+    JSONGenerator(expected, true) << program;
+    JSONGenerator(actual, true) << node;
+    EXPECT_EQ(expected.str(), actual.str());
+
+    // Truncated or foreign input is detected.
+    BinaryLoader truncated(bytes.data(), bytes.size() / 2);
+    EXPECT_THROW(truncated >> node, Util::CompilationError);
+    std::string text = expected.str();
+    BinaryLoader json(text.data(), text.size());
+    EXPECT_FALSE(json.valid());
+}
+
+}  // namespace Test
@@ -16,6 +16,12 @@ limitations under the License.
 */
 
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/bitvec.h"
 
@@ -141,4 +147,154 @@ TEST(Bitvec, io) {
     EXPECT_EQ(a, b);
 }
 
+namespace {
+
+/// A bitvec with bits set at random below @p bits, and the same bits as a vector<bool>.
+std::pair<bitvec, std::vector<bool>> randomBits(std::mt19937 &gen, size_t bits) {
+    std::pair<bitvec, std::vector<bool>> rv;
+    rv.second.resize(bits);
+    for (size_t i = 0; i < bits; ++i) {
+        if (gen() % 3 == 0) {
+            rv.first.setbit(i);
+            rv.second[i] = true; } }
+    return rv;
+}
+
+void expectSame(const bitvec &bv, const std::vector<bool> &bits) {
+    std::vector<bool> actual(bits.size());
+    for (auto i : bv) {
+        ASSERT_LT(size_t(i), bits.size());
+        actual[i] = true; }
+    EXPECT_EQ(actual, bits);
+    EXPECT_EQ(bv.popcount(), std::count(bits.begin(), bits.end(), true));
+}
+
+}  // namespace
+
+TEST(Bitvec, bulkOperations) {
+    std::mt19937 gen(1);
+    // Sizes around the inline capacity and the vectorized loops.
+    for (size_t abits : { 30, 200, 256, 300, 1000, 5000 }) {
+        for (size_t bbits : { 40, 256, 700, 5000 }) {
+            auto a = randomBits(gen, abits), b = randomBits(gen, bbits);
+            size_t bits = std::max(abits, bbits);
+            a.second.resize(bits);
+            b.second.resize(bits);
+            std::vector<bool> expected(bits);
+
+            bitvec t = a.first;
+            for (size_t i = 0; i < bits; ++i) expected[i] = a.second[i] || b.second[i];
+            EXPECT_EQ(t |= b.first, expected != a.second);
+            expectSame(t, expected);
+            EXPECT_FALSE(t |= b.first);
+
+            t = a.first;
+            for (size_t i = 0; i < bits; ++i) expected[i] = a.second[i] && b.second[i];
+            EXPECT_EQ(t &= b.first, expected != a.second);
+            expectSame(t, expected);
+            EXPECT_EQ(t, a.first & b.first);
+            EXPECT_FALSE(t &= b.first);
+            EXPECT_EQ(a.first.intersects(b.first), !t.empty());
+
+            t = a.first;
+            for (size_t i = 0; i < bits; ++i) expected[i] = a.second[i] && !b.second[i];
+            EXPECT_EQ(t -= b.first, expected != a.second);
+            expectSame(t, expected);
+            EXPECT_FALSE(t -= b.first);
+            EXPECT_TRUE(a.first.contains(t));
+
+            t = a.first;
+            for (size_t i = 0; i < bits; ++i) expected[i] = a.second[i] != b.second[i];
+            t ^= b.first;
+            expectSame(t, expected);
+            t ^= b.first;
+            EXPECT_EQ(t, a.first);
+
+            for (size_t shift : { 1, 63, 64, 200, 1000 }) {
+                t = a.first << shift;
+                EXPECT_EQ(t >> shift, a.first);
+                EXPECT_EQ(t.getslice(shift, abits), a.first); } } }
+}
+
+TEST(Bitvec, inlineAndAllocated) {
+    bitvec small(0, bitvec::inline_units * bitvec::bits_per_unit);
+    bitvec large(0, bitvec::inline_units * bitvec::bits_per_unit + 1);
+    EXPECT_EQ(small.max().index(), int(bitvec::inline_units * bitvec::bits_per_unit - 1));
+    EXPECT_EQ(large.max().index(), int(bitvec::inline_units * bitvec::bits_per_unit));
+
+    bitvec moved(std::move(large));
+    EXPECT_TRUE(large.empty());
+    EXPECT_EQ(moved - small, bitvec(bitvec::inline_units * bitvec::bits_per_unit, 1));
+    moved >>= bitvec::bits_per_unit;
+    EXPECT_EQ(moved, bitvec(0, (bitvec::inline_units - 1) * bitvec::bits_per_unit + 1));
+    std::swap(small, moved);
+    EXPECT_EQ(moved.popcount(), int(bitvec::inline_units * bitvec::bits_per_unit));
+}
+
+namespace {
+
+/// The bulk operations as the words of a bitvec were handled before they were vectorized,
+/// one word at a time, recording whether each changed.
+struct WordLoop {
+    std::vector<uintptr_t> words;
+    explicit WordLoop(const bitvec &bv, size_t bits) : words(bits / bitvec::bits_per_unit) {
+        for (size_t i = 0; i < words.size(); ++i)
+            words[i] = bv.getrange(i * bitvec::bits_per_unit, bitvec::bits_per_unit); }
+    bool operator|=(const WordLoop &a) {
+        bool rv = false;
+        for (size_t i = 0; i < words.size(); i++) {
+            rv |= ((words[i] | a.words[i]) != words[i]);
+            words[i] |= a.words[i]; }
+        return rv; }
+    bool operator&=(const WordLoop &a) {
+        bool rv = false;
+        for (size_t i = 0; i < words.size(); i++) {
+            rv |= ((words[i] & a.words[i]) != words[i]);
+            words[i] &= a.words[i]; }
+        return rv; }
+    bool operator-=(const WordLoop &a) {
+        bool rv = false;
+        for (size_t i = 0; i < words.size(); i++) {
+            rv |= ((words[i] & ~a.words[i]) != words[i]);
+            words[i] &= ~a.words[i]; }
+        return rv; }
+    int popcount() const {
+        int rv = 0;
+        for (auto w : words) rv += bv::popcount(w);
+        return rv; }
+};
+
+/// The kind of work done on the large bitvecs of a dataflow analysis.
+template<class Set> double bulkWorkload(std::vector<Set> sets, int rounds) {
+    auto start = std::chrono::steady_clock::now();
+    size_t changed = 0, bits = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 1; i < sets.size(); ++i) {
+            auto &set = sets[i];
+            changed += set |= sets[i - 1];
+            changed += set &= sets[(i * 7) % sets.size()];
+            changed += set -= sets[(i * 3) % sets.size()];
+            bits += set.popcount(); } }
+    EXPECT_GT(changed + bits, 0u);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+// Run with --gtest_also_run_disabled_tests to compare with the word-by-word loops.
+TEST(Bitvec, DISABLED_benchmark) {
+    std::mt19937 gen(1);
+    for (size_t bits : { 256, 4096, 65536 }) {
+        std::vector<bitvec> sets;
+        std::vector<WordLoop> loops;
+        for (int i = 0; i < 64; ++i) {
+            sets.push_back(randomBits(gen, bits).first);
+            loops.emplace_back(sets.back(), bits); }
+        int rounds = (1 << 24) / bits;
+        auto oldTime = bulkWorkload(loops, rounds);
+        auto newTime = bulkWorkload(sets, rounds);
+        std::cout << bits << " bits: word loop " << oldTime << "s, bitvec " << newTime << "s"
+                  << std::endl; }
+}
+
 }  // namespace Test
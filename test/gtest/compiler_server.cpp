@@ -0,0 +1,186 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/compilerServer.h"
+#include "frontends/common/options.h"
+
+namespace Test {
+
+namespace {
+
+/// A compilation which prints its working directory and arguments
+int echo(int argc, char *const argv[]) {
+    char cwd[PATH_MAX];
+    std::cout << getcwd(cwd, sizeof(cwd));
+    for (int i = 1; i < argc; ++i)
+        std::cout << ' ' << argv[i];
+    std::cout << std::endl;
+    return argc;
+}
+
+/// The number of zombie children of @parent
+int zombies(pid_t parent) {
+    int count = 0;
+    if (auto *proc = opendir("/proc")) {
+        while (auto *entry = readdir(proc)) {
+            if (!isdigit(entry->d_name[0])) continue;
+            std::ifstream stat(std::string("/proc/") + entry->d_name + "/stat");
+            std::string text((std::istreambuf_iterator<char>(stat)),
+                             std::istreambuf_iterator<char>());
+            // pid (command) state ppid ...
+            auto pos = text.rfind(')');
+            if (pos == std::string::npos) continue;
+            char state;
+            int ppid;
+            if (sscanf(text.c_str() + pos + 1, " %c %d", &state, &ppid) == 2 &&
+                ppid == parent && state == 'Z')
+                ++count; }
+        closedir(proc); }
+    return count;
+}
+
+}  // namespace
+
+class CompilerServerTest : public P4CTest {
+ protected:
+    std::string dir;
+    std::string socket;
+    pid_t server = -1;
+
+    void SetUp() override {
+        char tmpl[] = "/tmp/p4c-compiler-server-XXXXXX";
+        ASSERT_TRUE(mkdtemp(tmpl) != nullptr);
+        dir = tmpl;
+        socket = dir + "/socket";
+        server = fork();
+        ASSERT_GE(server, 0);
+        if (server == 0) {
+            CompilerOptions options;
+            _exit(P4::CompilerServer::serve(options, socket.c_str(), echo)); }
+        // wait until the server accepts connections (after preloading the headers)
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, socket.c_str(), sizeof(addr.sun_path) - 1);
+        bool listening = false;
+        for (int i = 0; i < 3000 && !listening; ++i) {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            listening = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+            close(fd);
+            if (!listening) usleep(10000); }
+        ASSERT_TRUE(listening);
+    }
+    void TearDown() override {
+        if (server > 0) {
+            kill(server, SIGTERM);
+            waitpid(server, nullptr, 0); }
+        std::string cmd = "rm -rf " + dir;
+        EXPECT_EQ(system(cmd.c_str()), 0);
+    }
+
+    /// Send @args to the server, with the standard output of the compilation
+    /// going to @output.  @returns the exit status of the compilation.
+    int request(std::vector<std::string> args, std::string &output) {
+        std::string file = dir + "/output";
+        int fd = open(file.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+        EXPECT_GE(fd, 0);
+        std::cout.flush();
+        int saved = dup(1);
+        dup2(fd, 1);
+        close(fd);
+        std::vector<char *> argv;
+        for (auto &arg : args)
+            argv.push_back(&arg[0]);
+        int status = P4::CompilerServer::request(socket.c_str(), argv.size(), argv.data());
+        dup2(saved, 1);
+        close(saved);
+        std::ifstream in(file);
+        output.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return status;
+    }
+};
+
+TEST_F(CompilerServerTest, Request) {
+    char cwd[PATH_MAX];
+    ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != nullptr);
+    std::string output;
+    // requests are compiled with the built-in preprocessor
+    EXPECT_EQ(request({ "p4test", "--one", "two" }, output), 4);
+    EXPECT_EQ(output, std::string(cwd) + " --builtin-preprocessor --one two\n");
+    EXPECT_EQ(request({ "p4test" }, output), 2);
+    EXPECT_EQ(output, std::string(cwd) + " --builtin-preprocessor\n");
+}
+
+TEST_F(CompilerServerTest, SocketIsPrivate) {
+    struct stat st;
+    ASSERT_EQ(stat(socket.c_str(), &st), 0);
+    EXPECT_TRUE(S_ISSOCK(st.st_mode));
+    EXPECT_EQ(st.st_mode & 0777, 0600u);
+}
+
+TEST_F(CompilerServerTest, OtherUserIsRejected) {
+    // only root can make a request as another user
+    if (geteuid() != 0) return;
+    // let anybody reach the socket, so that the server has to check the peer
+    ASSERT_EQ(chmod(dir.c_str(), 0755), 0);
+    ASSERT_EQ(chmod(socket.c_str(), 0666), 0);
+    pid_t client = fork();
+    ASSERT_GE(client, 0);
+    if (client == 0) {
+        if (setgid(65534) != 0 || setuid(65534) != 0) _exit(2);
+        char p4test[] = "p4test";
+        char *argv[] = { p4test, nullptr };
+        _exit(P4::CompilerServer::request(socket.c_str(), 1, argv)); }
+    int status;
+    ASSERT_EQ(waitpid(client, &status, 0), client);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 1);
+}
+
+TEST_F(CompilerServerTest, RequestsAreReaped) {
+    std::string output;
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(request({ "p4test", "x" }, output), 3);
+    // the process handling a request exits after replying, and is reaped by
+    // the server without waiting for the next request
+    int left = zombies(server);
+    for (int i = 0; i < 200 && left > 0; ++i) {
+        usleep(10000);
+        left = zombies(server); }
+    EXPECT_EQ(left, 0);
+}
+
+}  // namespace Test
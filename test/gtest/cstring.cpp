@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/cstring.h"
 
@@ -120,4 +124,54 @@ TEST(cstring, replace) {
     EXPECT_EQ(c.replace("i", ""), "Orgnal");
 }
 
+TEST(cstring, intern) {
+    std::string s = "intern_test_string";
+    cstring c1(s);
+    cstring c2(s.c_str());
+    cstring c3(s.data(), s.size());
+    EXPECT_EQ(c1.c_str(), c2.c_str());
+    EXPECT_EQ(c1.c_str(), c3.c_str());
+    EXPECT_EQ(cstring::literal("intern_test_string").c_str(), c1.c_str());
+
+    char *owned = new char[s.size() + 1];
+    memcpy(owned, s.c_str(), s.size() + 1);
+    EXPECT_EQ(cstring::own(owned, s.size()).c_str(), c1.c_str());
+
+    // short strings are stored inline in the table
+    EXPECT_EQ(cstring(std::string("ab")).c_str(), cstring("ab").c_str());
+}
+
+TEST(cstring, cache_stats) {
+    size_t count = 0;
+    cstring::cache_stats before, after;
+    cstring::cache_size(count, before);
+    cstring fresh = "cache_stats_test_string";
+    for (int i = 0; i < 10; ++i) {
+        cstring again(std::string("cache_stats_test_string"));
+        EXPECT_EQ(again.c_str(), fresh.c_str());
+    }
+    size_t count_after = 0;
+    size_t size = cstring::cache_size(count_after, after);
+    EXPECT_EQ(count_after, count + 1);
+    EXPECT_GT(size, 0u);
+    EXPECT_EQ(after.misses, before.misses + 1);
+    EXPECT_EQ(after.hits + after.local_hits, before.hits + before.local_hits + 10);
+    EXPECT_GT(after.shards, 0u);
+}
+
+#ifdef MULTITHREAD
+TEST(cstring, threads) {
+    constexpr int threads = 8, strings = 1000;
+    std::vector<std::vector<const char *>> results(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([t, &results] {
+            for (int i = 0; i < strings; ++i)
+                results[t].push_back(cstring("thread_str_" + std::to_string(i)).c_str()); });
+    for (auto &w : workers) w.join();
+    for (int t = 1; t < threads; ++t)
+        EXPECT_EQ(results[t], results[0]);
+}
+#endif  // MULTITHREAD
+
 }  // namespace Test
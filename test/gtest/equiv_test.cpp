@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "gtest/gtest.h"
+#include "ir/hash_cons.h"
 #include "ir/ir.h"
 #include "ir/visitor.h"
 #include "lib/exceptions.h"
@@ -70,3 +71,54 @@ TEST(IR, Equiv) {
     pr2->add("listb", list1);
     EXPECT_FALSE(pr1->equiv(*pr2));
 }
+
+TEST(IR, StructuralHash) {
+    auto *t = IR::Type::Bits::get(16);
+    auto *d1m = new IR::Member(new IR::PathExpression("d"), "m");
+    auto *d2m = new IR::Member(new IR::PathExpression("d"), "m");
+    auto *d1f = new IR::Member(new IR::PathExpression("d"), "f");
+    auto *a1 = new IR::Add(d1m, new IR::Constant(t, 10));
+    auto *a2 = new IR::Add(d2m, new IR::Constant(t, 10));
+    auto *a3 = new IR::Add(d1m, new IR::Constant(t, 11));
+
+    EXPECT_EQ(d1m->structuralHash(), d2m->structuralHash());
+    EXPECT_NE(d1m->structuralHash(), d1f->structuralHash());
+    EXPECT_EQ(a1->structuralHash(), a2->structuralHash());
+    EXPECT_NE(a1->structuralHash(), a3->structuralHash());
+    EXPECT_TRUE(a1->equiv(*a2));
+    EXPECT_FALSE(a1->equiv(*a3));
+
+    // clones do not keep the cached hash
+    auto *a4 = a1->clone();
+    a4->right = new IR::Constant(t, 11);
+    EXPECT_EQ(a4->structuralHash(), a3->structuralHash());
+    EXPECT_TRUE(a4->equiv(*a3));
+
+    // a Transform which changes a node that was hashed returns a node with the new hash
+    struct Rename : public Transform {
+        const IR::Node *postorder(IR::Member *m) override {
+            m->member = "m";
+            return m; }
+    };
+    auto *renamed = d1f->apply(Rename());
+    EXPECT_NE(renamed, d1f);
+    EXPECT_EQ(renamed->structuralHash(), d1m->structuralHash());
+    EXPECT_TRUE(renamed->equiv(*d1m));
+
+    // nodes already hashed are told apart without comparing them
+    EXPECT_TRUE(d1f->hashMismatch(*d1m));
+    EXPECT_FALSE(d1m->hashMismatch(*d2m));
+    EXPECT_FALSE(IR::equivHashed(a1, a3));
+    EXPECT_TRUE(IR::equivHashed(a1, a2));
+
+    IR::HashCons nodes;
+    auto *c1 = nodes.get<IR::Constant>(t, 10);
+    auto *c2 = nodes.get<IR::Constant>(t, 10);
+    auto *c3 = nodes.get<IR::Constant>(t, 11);
+    EXPECT_EQ(c1, c2);
+    EXPECT_NE(c1, c3);
+    EXPECT_EQ(nodes.intern(d1m), d1m);
+    EXPECT_EQ(nodes.intern(d2m), d1m);
+    EXPECT_EQ(nodes.size(), 3u);
+    EXPECT_EQ(nodes.hitCount(), 2u);
+}
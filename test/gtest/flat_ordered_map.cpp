@@ -0,0 +1,165 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/cstring.h"
+#include "lib/flat_ordered_map.h"
+#include "lib/flat_ordered_set.h"
+#include "lib/ordered_map.h"
+
+namespace Test {
+
+TEST(flat_ordered_map, insertion_order) {
+    flat_ordered_map<unsigned, unsigned> m;
+    for (unsigned i = 100; i > 0; --i)
+        m[i * 7 % 101] = i;
+    EXPECT_EQ(m.size(), 100u);
+
+    unsigned i = 100;
+    for (auto &el : m) {
+        EXPECT_EQ(el.first, i * 7 % 101);
+        EXPECT_EQ(el.second, i);
+        --i; }
+    EXPECT_EQ(m.rbegin()->first, 7u);
+    EXPECT_EQ(m.at(7), 1u);
+    EXPECT_THROW(m.at(0), std::out_of_range);
+    EXPECT_EQ(get(m, 7u), 1u);
+    EXPECT_EQ(getref(m, 0u), nullptr);
+
+    EXPECT_FALSE(m.emplace(7, 5).second);
+    EXPECT_EQ(m[7], 1u);
+}
+
+TEST(flat_ordered_map, erase) {
+    flat_ordered_map<unsigned, unsigned> a, b;
+    for (unsigned i = 0; i < 1000; ++i) {
+        a[i] = i;
+        b[i] = i; }
+    // Erase enough elements to compact the storage, while iterating.
+    for (auto it = a.begin(); it != a.end();) {
+        if (it->first % 3 != 0)
+            it = a.erase(it);
+        else
+            ++it; }
+    EXPECT_EQ(a.size(), 334u);
+    unsigned expected = 0;
+    for (auto &el : a) {
+        EXPECT_EQ(el.first, expected);
+        expected += 3; }
+
+    for (unsigned i = 0; i < 1000; ++i) {
+        if (i % 3 != 0) {
+            EXPECT_EQ(b.erase(i), 1u); } }
+    EXPECT_EQ(b.erase(1), 0u);
+    EXPECT_TRUE(a == b);
+    b[1] = 1;
+    EXPECT_TRUE(a != b);
+    EXPECT_EQ(b.rbegin()->first, 1u);
+    EXPECT_EQ(b.count(1), 1u);
+    EXPECT_EQ(b.count(2), 0u);
+
+    a.clear();
+    EXPECT_TRUE(a.empty());
+    EXPECT_TRUE(a.begin() == a.end());
+}
+
+TEST(flat_ordered_map, references_are_stable) {
+    flat_ordered_map<cstring, std::vector<int>> m;
+    auto &first = m["first"];
+    first.push_back(1);
+    for (int i = 0; i < 1000; ++i)
+        m[cstring::to_cstring(i)].push_back(i);
+    first.push_back(2);
+    EXPECT_EQ(m["first"].size(), 2u);
+    EXPECT_EQ(m.begin()->first, "first");
+}
+
+TEST(flat_ordered_set, basic) {
+    flat_ordered_set<int> s = { 3, 1, 2 };
+    EXPECT_FALSE(s.insert(1).second);
+    EXPECT_TRUE(s.insert(0).second);
+    std::vector<int> order(s.begin(), s.end());
+    EXPECT_EQ(order, std::vector<int>({ 3, 1, 2, 0 }));
+    EXPECT_EQ(s.erase(1), 1u);
+    EXPECT_EQ(s.front(), 3);
+    EXPECT_EQ(s.back(), 0);
+    EXPECT_TRUE(s.find(1) == s.end());
+    EXPECT_EQ(s.count(2), 1u);
+}
+
+namespace {
+
+struct FakeNode { int id; };
+
+/// Mimics TypeMap: types are set once for each node and then looked up many times,
+/// with some lookups for nodes which have no type yet.
+template<class Map> double typeMapWorkload(const std::vector<const FakeNode *> &nodes) {
+    auto start = std::chrono::steady_clock::now();
+    Map map;
+    size_t found = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        map.emplace(nodes[i], nodes[i / 2]);
+        for (size_t j = i; j > i / 2; j /= 2)
+            found += map.count(nodes[j]);
+        found += map.count(nodes[nodes.size() - 1 - i / 2]); }
+    for (auto &el : map)
+        found += el.second != nullptr;
+    EXPECT_GT(found, nodes.size());
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Mimics JsonObject: many small maps with interned string keys.
+template<class Map> double jsonWorkload(const std::vector<cstring> &keys, size_t objects) {
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (size_t i = 0; i < objects; ++i) {
+        Map map;
+        for (size_t k = 0; k < keys.size(); ++k)
+            map.emplace(keys[(i + k) % keys.size()], k);
+        for (auto &key : keys)
+            found += map.count(key); }
+    EXPECT_EQ(found, keys.size() * objects);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+// Run with --gtest_also_run_disabled_tests to compare with ordered_map.
+TEST(flat_ordered_map, DISABLED_benchmark) {
+    std::vector<const FakeNode *> nodes;
+    for (int i = 0; i < 200000; ++i)
+        nodes.push_back(new FakeNode{i});
+    auto oldTime = typeMapWorkload<ordered_map<const FakeNode *, const FakeNode *>>(nodes);
+    auto newTime = typeMapWorkload<flat_ordered_map<const FakeNode *, const FakeNode *>>(nodes);
+    std::cout << "TypeMap workload: ordered_map " << oldTime << "s, flat_ordered_map "
+              << newTime << "s" << std::endl;
+
+    std::vector<cstring> keys;
+    for (auto key : { "name", "id", "source_info", "type", "match_key", "action_entry",
+                      "priority", "key" })
+        keys.push_back(key);
+    oldTime = jsonWorkload<ordered_map<cstring, size_t>>(keys, 100000);
+    newTime = jsonWorkload<flat_ordered_map<cstring, size_t>>(keys, 100000);
+    std::cout << "JsonObject workload: ordered_map " << oldTime << "s, flat_ordered_map "
+              << newTime << "s" << std::endl;
+}
+
+}  // namespace Test
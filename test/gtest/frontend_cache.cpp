@@ -0,0 +1,135 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/parseInput.h"
+#include "frontends/p4/frontend.h"
+#include "frontends/p4/frontendCache.h"
+
+namespace Test {
+
+class P4CFrontEndCache : public P4CTest {
+ protected:
+    std::string dir;
+    CompilerOptions options;
+
+    void SetUp() override {
+        char tmpl[] = "/tmp/p4c-frontend-cache-XXXXXX";
+        ASSERT_TRUE(mkdtemp(tmpl) != nullptr);
+        dir = tmpl;
+        configure(options);
+    }
+    void configure(CompilerOptions &opts) const {
+        opts.langVersion = CompilerOptions::FrontendVersion::P4_16;
+        opts.frontendCacheDir = dir;
+        opts.file = "frontend_cache.p4";
+    }
+    void TearDown() override {
+        std::string cmd = "rm -rf " + dir;
+        EXPECT_EQ(system(cmd.c_str()), 0);
+    }
+
+    static const IR::P4Program *parse(int shift) {
+        // shifting a 4-bit value by more than 4 bits makes the front-end warn
+        auto source = P4_SOURCE(P4Headers::CORE, R"(
+            control c(out bit<4> x) { apply { x = 4w1 << SHIFT; } }
+        )");
+        source.replace(source.find("SHIFT"), 5, std::to_string(shift));
+        return P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    }
+};
+
+TEST_F(P4CFrontEndCache, MissThenHit) {
+    auto *program = parse(6);
+    ASSERT_TRUE(program != nullptr);
+    EXPECT_TRUE(P4::FrontEndCache::enabled(options));
+    EXPECT_EQ(P4::FrontEndCache(options, program, true).load(options), nullptr);
+
+    auto &reporter = BaseCompileContext::get().errorReporter();
+    std::stringstream miss;
+    reporter.setOutputStream(&miss);
+    auto *result = P4::FrontEnd().run(options, program, true);
+    ASSERT_TRUE(result != nullptr);
+    EXPECT_EQ(::errorCount(), 0u);
+    unsigned warnings = reporter.getWarningCount();
+    EXPECT_GT(warnings, 0u);
+    EXPECT_NE(miss.str().find("Shifting"), std::string::npos) << miss.str();
+
+    // a program parsed again has different node ids, but the same hash; the
+    // warnings of the front-end are reported again on a hit
+    std::stringstream hit;
+    reporter.setOutputStream(&hit);
+    auto *cached = P4::FrontEnd().run(options, parse(6), true);
+    reporter.setOutputStream(&std::cerr);
+    ASSERT_TRUE(cached != nullptr);
+    EXPECT_TRUE(cached->equiv(*result));
+    EXPECT_EQ(hit.str(), miss.str());
+    EXPECT_EQ(reporter.getWarningCount(), 2 * warnings);
+}
+
+TEST_F(P4CFrontEndCache, Invalidation) {
+    auto *program = parse(6);
+    ASSERT_TRUE(program != nullptr);
+    std::stringstream diagnostics;
+    BaseCompileContext::get().errorReporter().setOutputStream(&diagnostics);
+    ASSERT_TRUE(P4::FrontEnd().run(options, program, true) != nullptr);
+    BaseCompileContext::get().errorReporter().setOutputStream(&std::cerr);
+    EXPECT_NE(P4::FrontEndCache(options, parse(6), true).load(options), nullptr);
+
+    // a different program
+    EXPECT_EQ(P4::FrontEndCache(options, parse(7), true).load(options), nullptr);
+    // options that change the front-end output
+    EXPECT_EQ(P4::FrontEndCache(options, parse(6), false).load(options), nullptr);
+    CompilerOptions inlining;
+    configure(inlining);
+    inlining.optimizeParserInlining = !options.optimizeParserInlining;
+    EXPECT_EQ(P4::FrontEndCache(inlining, parse(6), true).load(inlining), nullptr);
+    CompilerOptions version;
+    configure(version);
+    version.compilerVersion = "0.0.0-test";
+    EXPECT_EQ(P4::FrontEndCache(version, parse(6), true).load(version), nullptr);
+    // a corrupt entry is ignored
+    std::string corrupt = "for f in " + dir + "/*.ir; do echo garbage > $f; done";
+    ASSERT_EQ(system(corrupt.c_str()), 0);
+    EXPECT_EQ(P4::FrontEndCache(options, parse(6), true).load(options), nullptr);
+}
+
+TEST_F(P4CFrontEndCache, SharingIsHashed) {
+    // two programs that differ only in whether a node is shared
+    auto *shared = new IR::Constant(IR::Type_Bits::get(8), 1);
+    auto *sharing = new IR::P4Program(IR::Vector<IR::Node>({
+        new IR::Declaration_Constant(IR::ID("a"), IR::Type_Bits::get(8), shared),
+        new IR::Declaration_Constant(IR::ID("b"), IR::Type_Bits::get(8), shared) }));
+    auto *distinct = new IR::P4Program(IR::Vector<IR::Node>({
+        new IR::Declaration_Constant(IR::ID("a"), IR::Type_Bits::get(8),
+                                     new IR::Constant(IR::Type_Bits::get(8), 1)),
+        new IR::Declaration_Constant(IR::ID("b"), IR::Type_Bits::get(8),
+                                     new IR::Constant(IR::Type_Bits::get(8), 1)) }));
+    P4::FrontEndCache(options, sharing, true).store(sharing, P4::FrontEndCache::Recorder());
+    EXPECT_NE(P4::FrontEndCache(options, sharing->clone(), true).load(options), nullptr);
+    EXPECT_EQ(P4::FrontEndCache(options, distinct, true).load(options), nullptr);
+}
+
+}  // namespace Test
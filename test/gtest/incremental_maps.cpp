@@ -0,0 +1,166 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+using namespace P4;
+
+namespace Test {
+
+namespace {
+
+/// Changes the constants in control 'd' only.
+class ChangeConstants : public Transform {
+    const IR::Node *postorder(IR::Constant *constant) override {
+        auto control = findContext<IR::P4Control>();
+        if (control != nullptr && control->name.name == "d")
+            constant->value = constant->value + 1;
+        return constant;
+    }
+};
+
+/// Changes header 'H', which the other declarations depend on.
+class ChangeHeader : public Transform {
+    const IR::Node *postorder(IR::Type_Header *header) override {
+        header->annotations = header->annotations->add(
+            new IR::Annotation(IR::Annotation::hiddenAnnotation, {}));
+        return header;
+    }
+};
+
+/// Replaces all bit<> types with the shared ones returned by Type_Bits::get.
+class ShareTypes : public Transform {
+    const IR::Node *postorder(IR::Type_Bits *type) override {
+        return IR::Type_Bits::get(type->size, type->isSigned);
+    }
+};
+
+/// Gives the constants in control 'd' a bit<8> type of their own.
+class RetypeConstants : public Transform {
+    const IR::Node *postorder(IR::Constant *constant) override {
+        auto control = findContext<IR::P4Control>();
+        if (control != nullptr && control->name.name == "d")
+            constant->type = new IR::Type_Bits(8, false);
+        return constant;
+    }
+};
+
+/// Checks that incrementally maintained maps for @p program match maps computed from scratch.
+void checkMaps(const IR::P4Program *program, ReferenceMap &refMap, TypeMap &typeMap) {
+    ReferenceMap fullRefMap;
+    TypeMap fullTypeMap;
+    TypeChecking full(&fullRefMap, &fullTypeMap);
+    ASSERT_EQ(program, program->apply(full));
+
+    forAllMatching<IR::Path>(program, [&](const IR::Path *path) {
+        EXPECT_EQ(fullRefMap.getDeclaration(path), refMap.getDeclaration(path)) << path;
+    });
+    forAllMatching<IR::Expression>(program, [&](const IR::Expression *expression) {
+        auto expected = fullTypeMap.getType(expression);
+        auto actual = typeMap.getType(expression);
+        ASSERT_EQ(expected == nullptr, actual == nullptr) << expression;
+        if (expected != nullptr)
+            EXPECT_TRUE(typeMap.equivalent(expected, actual)) << expression;
+    });
+    forAllMatching<IR::Type>(program, [&](const IR::Type *type) {
+        EXPECT_EQ(fullTypeMap.contains(type), typeMap.contains(type)) << type;
+    });
+}
+
+}  // namespace
+
+class P4CIncrementalMaps : public P4CTest { };
+
+TEST_F(P4CIncrementalMaps, sameAsFull) {
+    std::string source = P4_SOURCE(R"(
+        header H { bit<8> f; }
+        struct S { H h; }
+        control c(inout S s) {
+            action a(bit<8> v) { s.h.f = v; }
+            apply { a(8w1); }
+        }
+        control d(inout S s) {
+            apply { s.h.f = s.h.f + 8w1; }
+        }
+    )");
+    auto program = parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    refMap.setIncremental(true);
+    typeMap.setIncremental(true);
+    TypeChecking typeChecking(&refMap, &typeMap);
+    program = program->apply(typeChecking);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    ChangeConstants changeConstants;
+    auto changed = program->apply(changeConstants);
+    ASSERT_NE(program, changed);
+    EXPECT_EQ(program->objects.size(), changed->objects.size());
+    program = changed->apply(typeChecking);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    checkMaps(program, refMap, typeMap);
+
+    ChangeHeader changeHeader;
+    program = program->apply(changeHeader)->apply(typeChecking);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    checkMaps(program, refMap, typeMap);
+}
+
+TEST_F(P4CIncrementalMaps, sharedType) {
+    std::string source = P4_SOURCE(R"(
+        header H { bit<8> f; }
+        struct S { H h; }
+        control c(inout S s) {
+            apply { s.h.f = 8w1; }
+        }
+        control d(inout S s) {
+            apply { s.h.f = 8w2; }
+        }
+    )");
+    auto program = parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    ShareTypes shareTypes;
+    program = program->apply(shareTypes);
+    auto shared = IR::Type_Bits::get(8);
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    refMap.setIncremental(true);
+    typeMap.setIncremental(true);
+    TypeChecking typeChecking(&refMap, &typeMap);
+    program = program->apply(typeChecking);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    ASSERT_TRUE(typeMap.contains(shared));
+
+    // Only 'd' changes, and no longer uses the shared type; 'H' and 'c' still do.
+    RetypeConstants retypeConstants;
+    program = program->apply(retypeConstants)->apply(typeChecking);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    EXPECT_TRUE(typeMap.contains(shared));
+    checkMaps(program, refMap, typeMap);
+}
+
+}  // namespace Test
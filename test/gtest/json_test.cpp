@@ -71,4 +71,49 @@ TEST(Util, Json) {
               obj->toString());
 }
 
+TEST(Util, JsonWriter) {
+    auto inner = new JsonArray();
+    inner->append(true);
+    auto arr = new JsonArray();
+    arr->append(5);
+    arr->append("5");
+    arr->append(inner);
+    auto obj = new JsonObject();
+    obj->emplace("x", "x");
+    obj->emplace("y", arr);
+    obj->emplace("z", new JsonArray());
+    obj->emplace("n", static_cast<IJson*>(nullptr));
+
+    std::stringstream ss;
+    JsonWriter(ss).beginObject()
+        .field("x", "x")
+        .key("y").beginArray().value(5).value("5").beginArray().value(true).endArray().endArray()
+        .key("z").beginArray().endArray()
+        .key("n").json(nullptr)
+        .endObject();
+    EXPECT_EQ(obj->toString(), ss.str());
+
+    std::stringstream small;
+    JsonWriter(small).beginArray().value(1).value(cstring("a")).json(new JsonValue(2)).endArray();
+    EXPECT_EQ("[1, \"a\", 2]", small.str());
+
+    // A fragment is indented to its position.
+    std::stringstream entries;
+    JsonWriter(entries).beginArray().beginObject().field("id", 1).endObject().endArray();
+    auto outer = new JsonObject();
+    outer->emplace("entries", new JsonFragment(entries.str()));
+    auto expected = new JsonObject();
+    auto entry = new JsonObject();
+    entry->emplace("id", 1);
+    auto list = new JsonArray();
+    list->append(entry);
+    expected->emplace("entries", list);
+    EXPECT_EQ(expected->toString(), outer->toString());
+
+    std::stringstream bad;
+    JsonWriter writer(bad);
+    writer.beginObject();
+    EXPECT_THROW(writer.value(1), std::logic_error);
+}
+
 }  // namespace Util
@@ -0,0 +1,49 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "lib/log.h"
+
+namespace Test {
+
+namespace {
+
+bool logging3() { return LOGGING(3); }
+bool logging5() { return LOGGING(5); }
+
+}  // namespace
+
+TEST(Log, cachedLevelsFollowSpecs) {
+    // The levels are cached by the first checks, and must change with the specs.
+    EXPECT_FALSE(logging3());
+    EXPECT_FALSE(logging5());
+    Log::addDebugSpec("some_other_file:5");
+    EXPECT_FALSE(logging3());
+    EXPECT_FALSE(logging5());
+    Log::addDebugSpec("log_test:3");
+    EXPECT_TRUE(logging3());
+    EXPECT_FALSE(logging5());
+    EXPECT_EQ(Log::Detail::fileLogLevel(__FILE__), 3);
+
+    std::stringstream out;
+    if (LOGGING(3)) out << "logged";
+    if (LOGGING(4)) out << " too much";
+    EXPECT_EQ(out.str(), "logged");
+}
+
+}  // namespace Test
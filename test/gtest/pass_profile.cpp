@@ -0,0 +1,187 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+#include "ir/pass_profile.h"
+
+namespace Test {
+
+namespace {
+
+/// Minimal strict JSON syntax checker, to make sure the trace can be loaded.
+class JsonSyntax {
+    const std::string &text;
+    size_t pos = 0;
+
+    void ws() { while (pos < text.size() && isspace(text[pos])) ++pos; }
+    bool eat(char ch) {
+        ws();
+        if (pos < text.size() && text[pos] == ch) { ++pos; return true; }
+        return false; }
+    bool string() {
+        if (!eat('"')) return false;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\') ++pos;
+            ++pos; }
+        return eat('"'); }
+    bool number() {
+        ws();
+        static const std::regex re("-?(0|[1-9][0-9]*)(\\.[0-9]+)?([eE][-+]?[0-9]+)?");
+        std::smatch m;
+        if (!std::regex_search(text.begin() + pos, text.end(), m, re,
+                               std::regex_constants::match_continuous))
+            return false;
+        pos += m.length();
+        return true; }
+    bool value() {
+        ws();
+        if (pos >= text.size()) return false;
+        switch (text[pos]) {
+        case '{':
+            ++pos;
+            if (eat('}')) return true;
+            do {
+                if (!string() || !eat(':') || !value()) return false;
+            } while (eat(','));
+            return eat('}');
+        case '[':
+            ++pos;
+            if (eat(']')) return true;
+            do {
+                if (!value()) return false;
+            } while (eat(','));
+            return eat(']');
+        case '"':
+            return string();
+        default:
+            for (auto *word : { "true", "false", "null" })
+                if (text.compare(pos, strlen(word), word) == 0) {
+                    pos += strlen(word);
+                    return true; }
+            return number(); } }
+
+ public:
+    explicit JsonSyntax(const std::string &text) : text(text) {}
+    bool valid() {
+        if (!value()) return false;
+        ws();
+        return pos == text.size(); }
+};
+
+struct TraceEvent {
+    std::string name;
+    int tid;
+    int64_t start, end;  // nsec
+    std::map<std::string, uint64_t> args;
+};
+
+/// Extract the events written by PassProfile::write, which puts one per line.
+std::vector<TraceEvent> traceEvents(const std::string &trace) {
+    static const std::regex eventRe(
+        "\\{\"name\": \"([^\"]*)\", \"cat\": \"pass\", \"ph\": \"X\", \"pid\": 1, "
+        "\"tid\": ([0-9]+), \"ts\": ([0-9.]+), \"dur\": ([0-9.]+), \"args\": \\{(.*)\\}\\}");
+    static const std::regex argRe("\"([^\"]*)\": ([0-9]+)");
+    std::vector<TraceEvent> events;
+    std::istringstream lines(trace);
+    for (std::string line; std::getline(lines, line);) {
+        std::smatch m;
+        if (!std::regex_search(line, m, eventRe)) continue;
+        TraceEvent ev;
+        ev.name = m[1];
+        ev.tid = std::stoi(m[2]);
+        ev.start = std::llround(std::stod(m[3]) * 1000);
+        ev.end = ev.start + std::llround(std::stod(m[4]) * 1000);
+        std::string args = m[5];
+        for (std::sregex_iterator it(args.begin(), args.end(), argRe), end; it != end; ++it)
+            ev.args[(*it)[1]] = std::stoull((*it)[2]);
+        events.push_back(ev); }
+    return events;
+}
+
+bool nestedIn(const TraceEvent &inner, const TraceEvent &outer) {
+    return inner.tid == outer.tid && outer.start <= inner.start && inner.end <= outer.end;
+}
+
+}  // namespace
+
+TEST(PassProfile, trace) {
+    struct CountConstants : public Inspector {
+        CountConstants() { setName("ProfileTestCount"); }
+        void postorder(const IR::Constant *) override { PassProfile::annotate("constants", 1); }
+    };
+    // increments constants up to 3, so PassRepeated iterates 3 times
+    struct Increment : public Transform {
+        Increment() { setName("ProfileTestIncrement"); }
+        const IR::Node *postorder(IR::Constant *c) override {
+            if (c->value >= 3) return c;
+            return new IR::Constant(c->value + 1); }
+    };
+
+    PassProfile::enable("/dev/null");
+    ASSERT_TRUE(PassProfile::enabled());
+    PassManager passes({
+        new PassRepeated({ new CountConstants, new Increment }),
+    });
+    passes.setName("ProfileTestOuter");
+    auto *expr = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+    expr->apply(passes);
+
+    std::ostringstream out;
+    PassProfile::write(out);
+    std::string trace = out.str();
+    EXPECT_TRUE(JsonSyntax(trace).valid()) << trace;
+
+    std::map<std::string, std::vector<TraceEvent>> byName;
+    for (auto &ev : traceEvents(trace))
+        byName[ev.name].push_back(ev);
+    ASSERT_EQ(byName["ProfileTestOuter"].size(), 1u) << trace;
+    auto &outer = byName["ProfileTestOuter"].front();
+    ASSERT_EQ(byName["PassRepeated"].size(), 1u) << trace;
+    auto &repeated = byName["PassRepeated"].front();
+    EXPECT_TRUE(nestedIn(repeated, outer));
+    EXPECT_EQ(repeated.args["iterations"], 3u);
+
+    auto &counts = byName["ProfileTestCount"];
+    auto &increments = byName["ProfileTestIncrement"];
+    ASSERT_EQ(counts.size(), 3u) << trace;
+    ASSERT_EQ(increments.size(), 3u) << trace;
+    for (auto &ev : counts) {
+        EXPECT_TRUE(nestedIn(ev, repeated));
+        EXPECT_EQ(ev.args["constants"], 2u);
+        EXPECT_GE(ev.args["nodes_visited"], 3u); }
+    for (auto &ev : increments) {
+        EXPECT_TRUE(nestedIn(ev, repeated));
+        EXPECT_EQ(ev.args.count("constants"), 0u); }
+    // the passes of each iteration run one after the other
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_LE(counts[i].end, increments[i].start);
+        if (i > 0) {
+            EXPECT_LE(increments[i - 1].end, counts[i].start); } }
+    EXPECT_GT(increments[0].args["nodes_cloned"], 0u);
+}
+
+}  // namespace Test
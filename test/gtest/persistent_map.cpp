@@ -0,0 +1,211 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/cstring.h"
+#include "lib/ordered_map.h"
+#include "lib/persistent_map.h"
+
+namespace Test {
+
+namespace {
+
+template<class K, class V>
+std::map<K, V> contents(const persistent_map<K, V> &m) {
+    return std::map<K, V>(m.begin(), m.end()); }
+
+/// Mimics ComputeWriteSet: the Definitions of every program point are kept, each one a copy
+/// of the previous one with a couple of locations written, and the two branches of every
+/// conditional are joined.  @returns the time taken.
+template<class Map, class Join>
+double definitionsWorkload(unsigned locations, unsigned statements, Join join) {
+    auto start = std::chrono::steady_clock::now();
+    std::mt19937 random(1);
+    std::vector<Map *> points;
+    auto *current = new Map;
+    for (unsigned l = 0; l < locations; ++l)
+        (*current)[l] = 0;
+    for (unsigned s = 1; s <= statements; ++s) {
+        auto *branch = new Map(*current);
+        for (int w = 0; w < 2; ++w) {
+            current = new Map(*current);
+            (*current)[random() % locations] = s;
+            points.push_back(current);
+            (*branch)[random() % locations] = s; }
+        if (s % 10 == 0) {
+            current = join(*current, *branch);
+            points.push_back(current); } }
+    size_t entries = 0;
+    for (auto *p : points)
+        entries += p->size();
+    EXPECT_EQ(entries, points.size() * locations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+// Run with --gtest_also_run_disabled_tests to compare with the ordered_map Definitions used
+// before.  This only measures the map; the analysis still visits every program point.
+TEST(persistent_map, DISABLED_benchmark) {
+    using Old = ordered_map<unsigned, unsigned>;
+    using New = persistent_map<unsigned, unsigned>;
+    for (unsigned locations : { 100, 1000, 5000 }) {
+        auto oldTime = definitionsWorkload<Old>(locations, 2000, [](const Old &a, const Old &b) {
+            auto *result = new Old();
+            for (auto &d : b) {
+                auto it = a.find(d.first);
+                auto v = it == a.end() ? d.second : std::max(it->second, d.second);
+                result->emplace(d.first, v); }
+            for (auto &d : a)
+                if (!b.count(d.first)) result->emplace(d.first, d.second);
+            return result; });
+        auto newTime = definitionsWorkload<New>(locations, 2000, [](const New &a, const New &b) {
+            auto *result = new New(a);
+            result->unite(b, [](unsigned, unsigned &v, const unsigned &o) { v = std::max(v, o); });
+            return result; });
+        std::cout << locations << " locations: ordered_map " << oldTime << "s, persistent_map "
+                  << newTime << "s" << std::endl; }
+}
+
+TEST(persistent_map, same_as_map) {
+    std::mt19937 random(1);
+    persistent_map<unsigned, unsigned> m;
+    std::map<unsigned, unsigned> expected;
+    for (unsigned i = 0; i < 5000; ++i) {
+        unsigned key = random() % 1000;
+        if (random() % 4 == 0) {
+            EXPECT_EQ(m.erase(key), expected.erase(key));
+        } else {
+            m[key] = i;
+            expected[key] = i; } }
+    EXPECT_EQ(m.size(), expected.size());
+    EXPECT_EQ(contents(m), expected);
+
+    for (unsigned key = 0; key <= 1000; ++key) {
+        EXPECT_EQ(m.count(key), expected.count(key));
+        auto lb = m.lower_bound(key);
+        auto elb = expected.lower_bound(key);
+        if (elb == expected.end()) {
+            EXPECT_TRUE(lb == m.end());
+        } else {
+            EXPECT_EQ(lb->first, elb->first); }
+        auto ub = m.upper_bound(key);
+        auto eub = expected.upper_bound(key);
+        if (eub == expected.end()) {
+            EXPECT_TRUE(ub == m.end());
+        } else {
+            EXPECT_EQ(ub->first, eub->first); } }
+    EXPECT_THROW(m.at(1000), std::out_of_range);
+    EXPECT_EQ(getref(m, 1000u), nullptr);
+}
+
+TEST(persistent_map, copies_are_independent) {
+    persistent_map<cstring, int> a;
+    for (int i = 0; i < 100; ++i)
+        a[cstring::to_cstring(i)] = i;
+    auto b = a;
+    EXPECT_EQ(a, b);
+    b["5"] = -5;
+    b.erase("6");
+    b["new"] = 1;
+    a.update("7", [](int &v) { v = -7; });
+    EXPECT_EQ(a.at("5"), 5);
+    EXPECT_EQ(a.count("6"), 1u);
+    EXPECT_EQ(a.count("new"), 0u);
+    EXPECT_EQ(a.at("7"), -7);
+    EXPECT_EQ(b.at("5"), -5);
+    EXPECT_EQ(b.count("6"), 0u);
+    EXPECT_EQ(b.at("7"), 7);
+    EXPECT_EQ(a.size(), 100u);
+    EXPECT_EQ(b.size(), 100u);
+    EXPECT_NE(a, b);
+
+    auto c = a;
+    c.update_all([](cstring, int &v) { v *= 2; });
+    EXPECT_EQ(c.at("10"), 20);
+    EXPECT_EQ(a.at("10"), 10);
+}
+
+TEST(persistent_map, merge) {
+    persistent_map<unsigned, unsigned> base;
+    for (unsigned i = 0; i < 1000; ++i)
+        base[i] = i;
+    auto a = base, b = base;
+    a[10] = 0;
+    a[2000] = 1;
+    b[20] = 0;
+    b.erase(30);
+    b[3000] = 1;
+
+    // keep the values which are the same in both, and clear the others
+    unsigned calls = 0;
+    a.merge(b, [&calls](unsigned, unsigned &v, const unsigned *other) {
+        ++calls;
+        if (!other || *other != v) v = ~0U; });
+    EXPECT_EQ(a.size(), 1001u);
+    EXPECT_EQ(a.at(10), ~0U);
+    EXPECT_EQ(a.at(20), ~0U);
+    EXPECT_EQ(a.at(30), ~0U);
+    EXPECT_EQ(a.at(2000), ~0U);
+    EXPECT_EQ(a.count(3000), 0u);
+    for (unsigned i = 0; i < 1000; ++i) {
+        if (i != 10 && i != 20 && i != 30) {
+            EXPECT_EQ(a.at(i), i); } }
+    // only the parts which differ were looked at
+    EXPECT_LT(calls, 200u);
+    EXPECT_EQ(b.at(10), 10u);
+    EXPECT_EQ(base.at(20), 20u);
+}
+
+TEST(persistent_map, unite) {
+    persistent_map<unsigned, unsigned> base;
+    for (unsigned i = 0; i < 1000; ++i)
+        base[i] = i;
+    auto a = base, b = base;
+    a[10] = 0;
+    a.erase(20);
+    b[10] = 1;
+    b[30] = 1;
+    b[2000] = 1;
+
+    unsigned calls = 0;
+    a.unite(b, [&calls](unsigned, unsigned &v, const unsigned &other) {
+        ++calls;
+        v += other; });
+    EXPECT_EQ(a.size(), 1001u);
+    EXPECT_EQ(a.at(10), 1u);
+    EXPECT_EQ(a.at(20), 20u);
+    EXPECT_EQ(a.at(30), 31u);
+    EXPECT_EQ(a.at(2000), 1u);
+    EXPECT_EQ(b.size(), 1001u);
+    EXPECT_EQ(b.at(10), 1u);
+    EXPECT_EQ(b.at(30), 1u);
+    EXPECT_LT(calls, 200u);
+
+    persistent_map<unsigned, unsigned> empty;
+    empty.unite(b, [](unsigned, unsigned &, const unsigned &) {});
+    EXPECT_EQ(empty, b);
+}
+
+}  // namespace Test
@@ -0,0 +1,224 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "frontends/common/preprocessor.h"
+#include "helpers.h"
+#include "lib/error.h"
+#include "test/gtest/env.h"
+
+namespace Test {
+
+namespace {
+
+/// A file in a temporary directory, removed with it.
+class TempDir {
+    std::string dir;
+    std::vector<std::string> files;
+
+ public:
+    TempDir() {
+        char name[] = "/tmp/p4c-preprocessorXXXXXX";
+        dir = mkdtemp(name); }
+    ~TempDir() {
+        for (auto& file : files) unlink(file.c_str());
+        rmdir(dir.c_str()); }
+    std::string write(const std::string& name, const std::string& contents) {
+        auto path = dir + "/" + name;
+        std::ofstream(path) << contents;
+        files.push_back(path);
+        return path; }
+    const std::string& path() const { return dir; }
+};
+
+/// The tokens of preprocessed @text, with the file and line they come from
+/// according to the line markers, ignoring comments and spacing.
+std::vector<std::string> tokensWithLines(const std::string& text) {
+    std::vector<std::string> result;
+    std::string file;
+    unsigned line = 1;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        size_t end = pos + 1;
+        if (c == '\n') {
+            line++;
+        } else if (c == '#' && (pos == 0 || text[pos - 1] == '\n') &&
+                   text.compare(pos, 2, "# ") == 0 && isdigit(text[pos + 2])) {
+            // A line marker.
+            end = text.find('\n', pos);
+            std::istringstream marker(text.substr(pos + 2, end - pos - 2));
+            marker >> line >> file;
+            file = file.substr(1, file.size() - 2);
+            end++;
+        } else if (text.compare(pos, 2, "//") == 0) {
+            end = text.find('\n', pos);
+        } else if (text.compare(pos, 2, "/*") == 0) {
+            end = text.find("*/", pos + 2) + 2;
+            line += std::count(text.begin() + pos, text.begin() + end, '\n');
+        } else if (!isspace(c)) {
+            if (isalnum(c) || c == '_') {
+                while (end < text.size() && (isalnum(text[end]) || text[end] == '_')) end++;
+            } else if (c == '"') {
+                while (end < text.size() && text[end] != '"' && text[end] != '\n')
+                    end += text[end] == '\\' ? 2 : 1;
+                end++; }
+            result.push_back(file + ":" + std::to_string(line) + ": " +
+                             text.substr(pos, end - pos)); }
+        pos = end; }
+    return result;
+}
+
+std::string runCpp(const std::string& options, const std::string& file) {
+    std::string cmd = "cpp -C -undef -nostdinc -x assembler-with-cpp " + options + " " + file +
+                      " 2>/dev/null";
+    FILE* in = popen(cmd.c_str(), "r");
+    if (in == nullptr) return std::string();
+    std::string text;
+    char buffer[4096];
+    while (size_t size = fread(buffer, 1, sizeof(buffer), in))
+        text.append(buffer, size);
+    return pclose(in) == 0 ? text : std::string();
+}
+
+}  // namespace
+
+class P4CPreprocessor : public P4CTest {
+ protected:
+    TempDir dir;
+
+    /// @returns the preprocessed @source, without the line marker of the main file.
+    std::string preprocess(const std::string& source, const char* options = "") {
+        P4::Preprocessor preprocessor;
+        EXPECT_TRUE(preprocessor.addOptions(options));
+        std::string out;
+        preprocessor.process(dir.write("test.p4", source), out);
+        return out.substr(out.find('\n') + 1); }
+};
+
+TEST_F(P4CPreprocessor, macros) {
+    EXPECT_EQ(preprocess(
+        "#define ONE 1\n"
+        "#define ADD(a, b) ((a) + (b))\n"
+        "#define STR(x) #x\n"
+        "#define CAT(a, b) a ## b\n"
+        "#define LOG(fmt, ...) log(fmt, ## __VA_ARGS__)\n"
+        "#define SELF SELF + ONE\n"
+        "bit<8> x = ADD(ONE, ADD(2,\n"
+        "    3)); // keep\n"
+        "STR(a  \"b\" c) CAT(bit, 16) CAT(, x) LOG(f) LOG(f, a, b)\n"
+        "SELF ADD 8w0xFF ONE\n"),
+        "\n\n\n\n\n\n"
+        "bit<8> x = ((1) + (((2) + (3)))); // keep\n"
+        "\n"
+        "\"a \\\"b\\\" c\" bit16 x log(f) log(f,a, b)\n"
+        "SELF + 1 ADD 8w0xFF 1\n");
+}
+
+TEST_F(P4CPreprocessor, conditionals) {
+    EXPECT_EQ(preprocess(
+        "#if defined(A) && A > 1\n"
+        "a\n"
+        "#elif defined B || (1 << 2) != 4\n"
+        "b\n"
+        "#else\n"
+        "#ifndef B\n"
+        "c\n"
+        "#endif\n"
+        "#endif\n"
+        "/* #else\n"
+        "*/ d\n", "-DA=1 -DB -UB"),
+        "\n\n\n\n\n\nc\n\n\n"
+        "/* #else\n"
+        "*/ d\n");
+}
+
+TEST_F(P4CPreprocessor, includes) {
+    dir.write("local.p4", "#pragma once\nlocal\n");
+    std::string include = dir.path() + "/include";
+    mkdir(include.c_str(), 0755);
+    auto header = dir.write("include/header.p4", "#define H 1\nheader H\n");
+    EXPECT_EQ(preprocess(
+        "#include \"local.p4\"\n"
+        "#include <header.p4>\n"
+        "#include \"local.p4\"\n"
+        "end __LINE__\n", ("-I" + include).c_str()),
+        "# 1 \"" + dir.path() + "/local.p4\" 1\n"
+        "\n"
+        "local\n"
+        "# 2 \"" + dir.path() + "/test.p4\" 2\n"
+        "# 1 \"" + header + "\" 1\n"
+        "\n"
+        "header 1\n"
+        "# 3 \"" + dir.path() + "/test.p4\" 2\n"
+        "\n"
+        "end 4\n");
+    unlink(header.c_str());
+    rmdir(include.c_str());
+}
+
+TEST_F(P4CPreprocessor, errors) {
+    auto errors = ::errorCount();
+    preprocess("#include \"missing.p4\"\n");
+    preprocess("#error stop\n");
+    preprocess("#if 1 +\n#endif\n");
+    preprocess("#if 1\n");
+    preprocess("#define F(x) x\nF(1, 2)\n");
+    EXPECT_EQ(::errorCount(), errors + 5);
+
+    P4::Preprocessor preprocessor;
+    EXPECT_FALSE(preprocessor.addOptions("-MD -I."));
+}
+
+/// The output must have the same tokens on the same lines as that of cpp.
+TEST_F(P4CPreprocessor, sameAsCpp) {
+    std::string samples = std::string(sourcePath) + "testdata/p4_16_samples/";
+    std::string options = std::string("-I") + sourcePath + "p4include -I" + sourcePath +
+                          "p4include/bmv2";
+    DIR* directory = opendir(samples.c_str());
+    ASSERT_TRUE(directory != nullptr);
+    std::vector<std::string> files;
+    while (auto entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name.size() > 3 && name.substr(name.size() - 3) == ".p4")
+            files.push_back(samples + name); }
+    closedir(directory);
+    std::sort(files.begin(), files.end());
+
+    unsigned compared = 0;
+    for (auto& file : files) {
+        auto expected = runCpp(options, file);
+        if (expected.empty()) continue;  // e.g., #error
+        P4::Preprocessor preprocessor;
+        ASSERT_TRUE(preprocessor.addOptions(options));
+        std::string out;
+        EXPECT_TRUE(preprocessor.process(file, out)) << file;
+        EXPECT_EQ(tokensWithLines(expected), tokensWithLines(out)) << file;
+        compared++; }
+    std::cout << "Compared the output of cpp for " << compared << " programs" << std::endl;
+}
+
+}  // namespace Test
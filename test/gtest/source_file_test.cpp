@@ -76,6 +76,31 @@ TEST(UtilSourceFile, InputSources) {
     EXPECT_EQ(5u, original.sourceLine);
 }
 
+TEST(UtilSourceFile, InputSourcesBuffer) {
+    const char text[] = "header h {\n    bit<8> f;\r\n}\n";
+    Util::InputSources sources;
+    sources.useBuffer(text, sizeof(text) - 1);
+    for (auto token : { "header", " ", "h", " ", "{", "\n", "    ", "bit", "<", "8", ">", " ",
+                        "f", ";", "\r\n", "}", "\n" })
+        sources.appendText(token);
+    EXPECT_EQ(3u, sources.lineCount());
+    EXPECT_EQ("    bit<8> f;\r\n", sources.getLine(2));
+    EXPECT_EQ(text, sources.getBuffer().p);
+    SourcePosition position = sources.getCurrentPosition();
+    EXPECT_EQ(4u, position.getLineNumber());
+    EXPECT_EQ(0u, position.getColumnNumber());
+
+    // Text which is not in the buffer is copied.
+    Util::InputSources copied;
+    copied.useBuffer(text, sizeof(text) - 1);
+    copied.appendText("header h");
+    copied.appendText(" {}\n");
+    copied.appendText("x");
+    EXPECT_EQ(2u, copied.lineCount());
+    EXPECT_EQ("header h {}\n", copied.getLine(1));
+    EXPECT_EQ("x", copied.getLine(2));
+}
+
 TEST(UtilSourceFile, SourceInfo) {
     Util::InputSources sources;
 
@@ -17,7 +17,9 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "helpers.h"
 #include "ir/ir.h"
+#include "ir/pass_manager.h"
 #include "ir/visitor.h"
+#include "frontends/common/parseInput.h"
 #include "lib/source_file.h"
 
 namespace Test {
@@ -43,4 +45,195 @@ TEST_F(P4C_IR, Transform) {
     EXPECT_EQ(e, n);
 }
 
+TEST_F(P4C_IR, ParallelForEachDeclaration) {
+    auto program = P4::parseP4String(P4_SOURCE(P4Headers::NONE, R"(
+        const bit<8> k = 8w1;
+        control c1() { apply { bit<8> x = 8w2; } }
+        parser p() { state start { transition accept; } }
+        control c2() { apply { bit<8> y = 8w3; } }
+    )"), CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr);
+
+    struct Increment : public Transform {
+        const IR::Node *postorder(IR::Constant *c) override {
+            return new IR::Constant(c->srcInfo, c->type, c->value + 1); }
+    };
+    struct Nothing : public Inspector {};
+
+    EXPECT_EQ(program, program->apply(ParallelForEachDeclaration([] { return new Nothing; }, 4)));
+
+    auto result = program->apply(ParallelForEachDeclaration([] { return new Increment; }, 4));
+    ASSERT_TRUE(result != nullptr);
+    ASSERT_NE(program, result);
+    ASSERT_EQ(program->objects.size(), result->objects.size());
+    // declarations without constants are left alone
+    EXPECT_EQ(program->objects.at(2), result->objects.at(2));
+    std::vector<big_int> values;
+    forAllMatching<IR::Constant>(result, [&](const IR::Constant *c) {
+        values.push_back(c->value); });
+    EXPECT_EQ(values, (std::vector<big_int>{ 2, 3, 4 }));
+}
+
+TEST_F(P4C_IR, ParallelForEachDeclarationStress) {
+    // many declarations whose visitors all create nodes, declarations and bit types
+    std::string source;
+    for (int c = 0; c < 64; ++c) {
+        source += "control c" + std::to_string(c) + "() { apply {\n";
+        for (int i = 0; i < 32; ++i)
+            source += "  bit<8> x" + std::to_string(i) + " = 8w" + std::to_string(i) + ";\n";
+        source += "} }\n"; }
+    auto program = P4::parseP4String(P4_SOURCE(P4Headers::NONE, source.c_str()),
+                                     CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr);
+
+    struct Rewrite : public Transform {
+        const IR::Node *postorder(IR::Declaration_Variable *d) override {
+            return new IR::Declaration_Variable(d->srcInfo, IR::ID(d->name.name + "_r"),
+                                                d->annotations, d->type, d->initializer); }
+        const IR::Node *postorder(IR::Constant *c) override {
+            auto control = findContext<IR::P4Control>();
+            // widths not requested before, so the Type_Bits cache is updated concurrently
+            int width = 100 + control->name.name.size() * 50 + static_cast<int>(c->asInt());
+            return new IR::Constant(c->srcInfo, IR::Type_Bits::get(width), c->value + 1); }
+    };
+
+    auto sequential = program->apply(ParallelForEachDeclaration([] { return new Rewrite; }, 1));
+    auto parallel = program->apply(ParallelForEachDeclaration([] { return new Rewrite; }, 8));
+    ASSERT_TRUE(sequential != nullptr);
+    ASSERT_TRUE(parallel != nullptr);
+
+    // the result does not depend on the number of threads...
+    std::vector<std::pair<cstring, cstring>> seqDecls, parDecls;
+    forAllMatching<IR::Declaration_Variable>(sequential, [&](const IR::Declaration_Variable *d) {
+        seqDecls.emplace_back(d->name, d->initializer->toString()); });
+    forAllMatching<IR::Declaration_Variable>(parallel, [&](const IR::Declaration_Variable *d) {
+        parDecls.emplace_back(d->name, d->initializer->toString()); });
+    EXPECT_EQ(seqDecls.size(), 64u * 32u);
+    EXPECT_EQ(seqDecls, parDecls);
+
+    // ...and nodes and declarations created concurrently get distinct ids
+    std::map<int, const IR::Node *> nodes;
+    std::map<int, const IR::Declaration *> decls;
+    forAllMatching<IR::Node>(parallel, [&](const IR::Node *n) {
+        EXPECT_EQ(n, nodes.emplace(n->id, n).first->second);
+        if (auto *d = n->to<IR::Declaration>())
+            EXPECT_EQ(d, decls.emplace(d->declid, d).first->second); });
+    // Type_Bits are shared by all their users
+    forAllMatching<IR::Constant>(parallel, [&](const IR::Constant *c) {
+        auto *type = c->type->to<IR::Type_Bits>();
+        ASSERT_TRUE(type != nullptr);
+        EXPECT_EQ(type, IR::Type_Bits::get(type->size)); });
+}
+
+TEST_F(P4C_IR, CopyOnWriteVector) {
+    auto *decls = new IR::IndexedVector<IR::Node>();
+    for (auto name : { "a", "b", "c", "d" })
+        decls->push_back(new IR::Declaration_Constant(
+            IR::ID(name), IR::Type_Bits::get(8), new IR::Constant(0)));
+    const IR::IndexedVector<IR::Node> *original = decls;
+
+    // a clone shares the elements until it is changed
+    auto *clone = decls->clone();
+    EXPECT_EQ(original->VectorBase_begin(), clone->VectorBase_begin());
+    clone->push_back(new IR::Declaration_Constant(
+        IR::ID("e"), IR::Type_Bits::get(8), new IR::Constant(0)));
+    EXPECT_NE(original->VectorBase_begin(), clone->VectorBase_begin());
+    EXPECT_EQ(4u, original->size());
+    EXPECT_EQ(nullptr, original->getDeclaration("e"));
+    EXPECT_NE(nullptr, clone->getDeclaration("e"));
+
+    struct Nothing : public Transform {};
+    EXPECT_EQ(original, original->apply(Nothing()));
+
+    struct Change : public Transform {
+        const IR::Node *postorder(IR::Declaration_Constant *d) override {
+            if (d->name.name == "b") return nullptr;
+            if (d->name.name == "c") d->initializer = new IR::Constant(1);
+            return d; }
+    };
+    auto *result = original->apply(Change());
+    ASSERT_NE(original, result);
+    result->validate();
+    ASSERT_EQ(3u, result->size());
+    EXPECT_EQ(original->at(0), result->at(0));
+    EXPECT_EQ(nullptr, result->getDeclaration("b"));
+    EXPECT_EQ(1, result->getDeclaration<IR::Declaration_Constant>("c")
+                 ->initializer->to<IR::Constant>()->asInt());
+    // the original is unchanged
+    original->validate();
+    EXPECT_EQ(4u, original->size());
+    EXPECT_NE(nullptr, original->getDeclaration("b"));
+    EXPECT_EQ(0, original->getDeclaration<IR::Declaration_Constant>("c")
+                 ->initializer->to<IR::Constant>()->asInt());
+}
+
+TEST_F(P4C_IR, PassRepeatedSkipsUnchanged) {
+    // Increments constants up to a limit, counting how often it runs.
+    struct Increment : public Transform {
+        int limit;
+        bool noop;
+        int *runs;
+        Increment(int limit, bool noop, int *runs) : limit(limit), noop(noop), runs(runs) {}
+        profile_t init_apply(const IR::Node *root) override {
+            ++*runs;
+            return Transform::init_apply(root); }
+        const IR::Node *postorder(IR::Constant *c) override {
+            if (c->asInt() < limit)
+                return new IR::Constant(c->srcInfo, c->type, c->value + 1);
+            return c; }
+        bool rerun_is_noop() const override { return noop; }
+        Increment *clone() const override { return new Increment(*this); }
+    };
+
+    auto *vec = new IR::Vector<IR::Expression>({ new IR::Constant(0) });
+    int first = 0, second = 0, third = 0;
+    PassRepeated repeated({ new Increment(3, true, &first), new Increment(0, true, &second),
+                            new Increment(0, false, &third) });
+    unsigned hooks = 0;
+    repeated.addDebugHook([&hooks](const char *, unsigned, const char *, const IR::Node *) {
+        ++hooks; });
+    auto *result = vec->apply(repeated);
+    ASSERT_EQ(1u, result->size());
+    EXPECT_EQ(3, result->at(0)->to<IR::Constant>()->asInt());
+    // The last iteration gives the second pass the program it left unchanged
+    // in the previous one, so it is skipped; the third pass cannot be skipped.
+    EXPECT_EQ(4, first);
+    EXPECT_EQ(3, second);
+    EXPECT_EQ(4, third);
+    EXPECT_EQ(12u, hooks);
+}
+
+TEST_F(P4C_IR, PassRepeatedSkipsWithoutNewNodes) {
+    // Increments constants up to 3.
+    struct Increment : public Transform {
+        const IR::Node *postorder(IR::Constant *c) override {
+            if (c->asInt() < 3)
+                return new IR::Constant(c->srcInfo, c->type, c->value + 1);
+            return c; }
+    };
+    // Counts how often it runs; only the new nodes accepted by needed need it to run again.
+    struct Count : public Inspector {
+        int runs = 0;
+        std::function<bool(const IR::Node *)> needed;
+        explicit Count(std::function<bool(const IR::Node *)> needed) : needed(needed) {}
+        profile_t init_apply(const IR::Node *root) override {
+            ++runs;
+            return Inspector::init_apply(root); }
+        bool rerun_is_noop() const override { return true; }
+        bool rerun_needed_for(const IR::Node *n) const override { return needed(n); }
+    };
+
+    auto *vec = new IR::Vector<IR::Expression>({ new IR::Constant(0) });
+    auto *casts = new Count([](const IR::Node *n) { return n->is<IR::Cast>(); });
+    auto *constants = new Count([](const IR::Node *n) { return !isGroupingNode(n); });
+    PassRepeated repeated({ new Increment, casts, constants });
+    auto *result = vec->apply(repeated);
+    ASSERT_EQ(1u, result->size());
+    EXPECT_EQ(3, result->at(0)->to<IR::Constant>()->asInt());
+    // No cast is ever created, so only the first iteration runs the first
+    // counter; new constants are created in the first three iterations.
+    EXPECT_EQ(1, casts->runs);
+    EXPECT_EQ(3, constants->runs);
+}
+
 }  // namespace Test
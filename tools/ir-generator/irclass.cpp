@@ -108,31 +108,39 @@ void IrDefinitions::generate(std::ostream &t, std::ostream &out, std::ostream &i
 
     impl << "#include \"ir/ir.h\"\n"
          << "#include \"ir/visitor.h\"\n"
-         << "#include \"ir/json_loader.h\"\n" << std::endl;
+         << "#include \"ir/json_loader.h\"\n"
+         << "#include \"ir/binary_loader.h\"\n" << std::endl;
 
     out << "#include <map>\n"
         << "#include <functional>\n" << std::endl
         << "class JSONLoader;\n"
         << "using NodeFactoryFn = IR::Node*(*)(JSONLoader&);\n"
+        << "class BinaryLoader;\n"
+        << "using BinaryNodeFactoryFn = IR::Node*(*)(BinaryLoader&);\n"
         << std::endl
         << "namespace IR {\n"
         << "extern std::map<cstring, NodeFactoryFn> unpacker_table;\n"
+        << "extern std::map<cstring, BinaryNodeFactoryFn> binary_unpacker_table;\n"
         << "}\n";
 
-    impl << "std::map<cstring, NodeFactoryFn> IR::unpacker_table = {\n";
-
-    bool first = true;
-    for (auto cls : *getClasses()) {
-        if (cls->kind == NodeKind::Concrete) {
-            if (first)
-                first = false;
-            else
-                impl << ",\n";
-            impl << "{\"" << cls->name << "\", NodeFactoryFn(&IR::";
-            if (cls->containedIn && cls->containedIn->name)
-                impl << cls->containedIn->name << "::";
-            impl << cls->name << "::fromJSON)}"; } }
-    impl << " };\n" << std::endl;
+    for (auto factory : { "fromJSON", "fromBinary" }) {
+        bool binary = factory == std::string("fromBinary");
+        cstring fnType = binary ? "BinaryNodeFactoryFn" : "NodeFactoryFn";
+        impl << "std::map<cstring, " << fnType << "> IR::"
+             << (binary ? "binary_unpacker_table" : "unpacker_table") << " = {\n";
+
+        bool first = true;
+        for (auto cls : *getClasses()) {
+            if (cls->kind == NodeKind::Concrete) {
+                if (first)
+                    first = false;
+                else
+                    impl << ",\n";
+                impl << "{\"" << cls->name << "\", " << fnType << "(&IR::";
+                if (cls->containedIn && cls->containedIn->name)
+                    impl << cls->containedIn->name << "::";
+                impl << cls->name << "::" << factory << ")}"; } }
+        impl << " };\n" << std::endl; }
 
     for (auto e : elements) {
         e->generate_hdr(out);
@@ -74,6 +74,7 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
             if (parent->name == "Node") {
                 buf << cl->indent << cl->indent << "if (typeid(*this) != typeid(a_)) "
                                                    "return false;\n";
+                buf << cl->indent << cl->indent << "if (hashMismatch(a_)) return false;\n";
             } else {
                 buf << cl->indent << cl->indent << "if (!"
                     << parent->qualified_name(cl->containedIn)
@@ -107,6 +108,40 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
             buf << ";" << std::endl; }
         buf << cl->indent << "}";
         return buf.str(); } } },
+{ "computeStructuralHash", { &NamedType::Size_t(), {}, CONST + IN_IMPL + OVERRIDE,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        // The hash must agree with equiv, so a class with a user-defined (or
+        // suppressed) equiv only hashes what its base classes hash
+        bool userEquiv = Util::Enumerator<IrElement*>::createEnumerator(cl->elements)
+            ->where([] (IrElement *el) {
+                if (auto *m = el->to<IrMethod>()) return m->name == "equiv" && m->isUser;
+                if (auto *no = el->to<IrNo>()) return no->text == "equiv";
+                return false; })
+            ->any();
+        auto parent = cl->getParent();
+        if (userEquiv || !parent)
+            return cstring();
+        std::stringstream buf;
+        bool needed = false;
+        buf << "{" << std::endl;
+        buf << cl->indent << cl->indent << "size_t h_ = "
+            << parent->qualified_name(cl->containedIn) << "::computeStructuralHash();\n";
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;  // not compared by equiv
+            if (dynamic_cast<const ArrayType *>(f->type)) continue;
+            buf << cl->indent << cl->indent << "h_ = IR::hash_combine(h_, ";
+            if (f->type->resolve(cl->containedIn) == nullptr)
+                // This is not an IR pointer
+                buf << "IR::hashValue(" << f->name << ")";
+            else if (f->isInline)
+                buf << f->name << ".structuralHash()";
+            else
+                buf << f->name << " ? " << f->name << "->structuralHash() : 0";
+            buf << ");" << std::endl;
+            needed = true; }
+        buf << cl->indent << cl->indent << "return h_;" << std::endl;
+        buf << cl->indent << "}";
+        return needed ? buf.str() : cstring(); } } },
 { "operator<<", { &ReferenceType::OstreamRef, { new IrField(&ReferenceType::OstreamRef, "out") },
   EXTEND + IN_IMPL + NOT_DEFAULT + INCL_NESTED + CLASSREF + FRIEND,
     [](IrClass *cl, Util::SourceInfo srcInfo, cstring body) -> cstring {
@@ -223,6 +258,41 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
         buf << "{ return new " << cl->name << "(json); }";
         return buf.str();
     } } },
+{ "toBinary", { &NamedType::Void(), {
+        new IrField(new ReferenceType(&NamedType::BinaryGenerator()), "binary")
+    }, CONST + IN_IMPL + OVERRIDE + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{" << std::endl;
+        if (auto parent = cl->getParent())
+            buf << cl->indent << parent->qualified_name(cl->containedIn)
+                << "::toBinary(binary);" << std::endl;
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;  // FIXME -- deal with SourcInfo
+            buf << cl->indent << "binary << this->" << f->name << ";" << std::endl; }
+        buf << "}";
+        return buf.str(); } } },
+{ "binary constructor", { nullptr, {
+        new IrField(new ReferenceType(&NamedType::BinaryLoader()), "binary")
+    }, IN_IMPL + CONSTRUCTOR + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        if (auto parent = cl->getParent())
+            buf << ": " << parent->qualified_name(cl->containedIn) << "(binary)";
+        buf << " {" << std::endl;
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;  // FIXME -- deal with SourcInfo
+            buf << cl->indent << "binary.load(" << f->name << ");" << std::endl; }
+        buf << "}";
+        return buf.str(); } } },
+{ "fromBinary", { nullptr, {
+        new IrField(new ReferenceType(&NamedType::BinaryLoader()), "binary"),
+    }, FACTORY + IN_IMPL + CONCRETE_ONLY + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{ return new " << cl->name << "(binary); }";
+        return buf.str();
+    } } },
 { "toString", { &NamedType::Cstring(), {}, CONST + IN_IMPL + OVERRIDE + NOT_DEFAULT,
     [](IrClass *, Util::SourceInfo, cstring) -> cstring { return cstring(); } } },
 };
@@ -293,7 +363,7 @@ void IrClass::generateMethods() {
         if (!IrMethod::Generate.count(m->name))
             throw Util::CompilationError("Unrecognized predefined method %1%", m->name);
         auto &info = IrMethod::Generate.at(m->name);
-        if (m->name) {
+        if (!(info.flags & CONSTRUCTOR)) {
             if (info.rtype) {
                 // This predefined method has an explicit return type.
                 m->rtype = info.rtype;
@@ -65,6 +65,11 @@ NamedType& NamedType::Int() {
     return nt;
 }
 
+NamedType& NamedType::Size_t() {
+    static NamedType nt("size_t");
+    return nt;
+}
+
 NamedType& NamedType::Void() {
     static NamedType nt("void");
     return nt;
@@ -100,6 +105,16 @@ NamedType& NamedType::JSONLoader() {
     return nt;
 }
 
+NamedType& NamedType::BinaryGenerator() {
+    static NamedType nt("BinaryGenerator");
+    return nt;
+}
+
+NamedType& NamedType::BinaryLoader() {
+    static NamedType nt("BinaryLoader");
+    return nt;
+}
+
 NamedType& NamedType::JSONObject() {
     static NamedType nt("JSONObject");
     return nt;